@@ -24,6 +24,11 @@
 #include <stdlib.h>
 #include "studio/project.h"
 
+static bool writeFile(const void* buffer, s32 size, void* data)
+{
+	return fwrite(buffer, size, 1, data) == 1;
+}
+
 int main(int argc, char** argv)
 {
 	int res = -1;
@@ -53,20 +58,11 @@ int main(int argc, char** argv)
 
 				if(project)
 				{
-					unsigned char* out = (unsigned char*)malloc(sizeof(tic_cartridge) * 3);
-
-					if(out)
-					{
-						s32 outSize = tic_project_save(argv[2], out, cart);
-
-						fwrite(out, outSize, 1, project);
-
-						free(out);
-					}
+					if(tic_project_write_stream(argv[2], cart, writeFile, project) >= 0)
+						res = 0;
+					else printf("cannot write project file\n");
 
 					fclose(project);
-
-					res = 0;
 				}
 				else printf("cannot open project file\n");
 
@@ -137,8 +137,30 @@ typedef struct
 TIC80_API tic80* tic80_create(s32 samplerate);
 TIC80_API void tic80_load(tic80* tic, void* cart, s32 size);
 TIC80_API void tic80_tick(tic80* tic, const tic80_input* input);
+
+// same as tic80_tick, but the frame isn't rendered to tic->screen, tic80_blit renders it
+TIC80_API void tic80_update(tic80* tic, const tic80_input* input);
+
+// renders the frame in tic->screen_format straight to the caller's buffer, 'pitch' is the row size in bytes,
+// only the TIC80_WIDTH x TIC80_HEIGHT area is written unless 'border' is set
+TIC80_API void tic80_blit(tic80* tic, void* pixels, s32 pitch, bool border);
 TIC80_API void tic80_delete(tic80* tic);
 
+TIC80_API s32 tic80_state_size(tic80* tic);
+TIC80_API s32 tic80_state_save(tic80* tic, void* buffer, s32 size);
+TIC80_API bool tic80_state_load(tic80* tic, const void* buffer, s32 size);
+
+// keeps up to 'size' bytes of history, each tick pushes a frame and tic80_rewind steps one frame back,
+// 0 turns it off, loading a cart clears the history
+TIC80_API void tic80_rewind_init(tic80* tic, s32 size);
+TIC80_API bool tic80_rewind(tic80* tic);
+
+typedef void(*tic80_sound_write)(const s16* samples, s32 count, void* data);
+
+// renders a music track of the first bank without running the cart, returns the frames count,
+// 0 if the track is empty and -1 if the track doesn't exist or the cart can't be loaded
+TIC80_API s32 tic80_music(const void* cart, s32 size, s32 track, s32 samplerate, s32 frames, tic80_sound_write write, void* data);
+
 #ifdef __cplusplus
 }
 #endif
@@ -43,6 +43,10 @@ typedef struct
     u64 (*freq)(void*);
     u64 start;
 
+    // optional, keep the Lua compiled from the MoonScript and Fennel carts between sessions
+    void* (*cacheLoad)(void*, const char* name, s32* size);
+    void (*cacheSave)(void*, const char* name, const void* buffer, s32 size);
+
     void* data;
 } tic_tick_data;
 
@@ -128,7 +132,7 @@ typedef struct
     macro(time,         0,  double,     tic_mem*) \
     macro(tstamp,       0,  s32,        tic_mem*) \
     macro(exit,         0,  void,       tic_mem*) \
-    macro(font,         8,  s32,        tic_mem*, const char* text, s32 x, s32 y, u8 chromakey, s32 w, s32 h, bool fixed, s32 scale, bool alt) \
+    macro(font,         9,  s32,        tic_mem*, const char* text, s32 x, s32 y, u8 chromakey, s32 w, s32 h, bool fixed, s32 scale, bool alt) \
     macro(mouse,        0,  tic_point,  tic_mem*) \
     macro(circ,         4,  void,       tic_mem*, s32 x, s32 y, s32 radius, u8 color) \
     macro(circb,        4,  void,       tic_mem*, s32 x, s32 y, s32 radius, u8 color) \
@@ -149,6 +153,37 @@ typedef struct
 TIC_API_LIST(TIC_API_DEF)
 #undef TIC_API_DEF
 
+#define TIC_API_ID_DEF(name, ...) tic_api_id_##name,
+typedef enum
+{
+    TIC_API_LIST(TIC_API_ID_DEF)
+    tic_api_count
+} tic_api_id;
+#undef TIC_API_ID_DEF
+
+typedef enum
+{
+    tic_perf_tic,
+    tic_perf_scn,
+    tic_perf_ovr,
+    tic_perf_sound,
+    tic_perf_blit,
+    tic_perf_phases_count
+} tic_perf_phase;
+
+typedef struct
+{
+    u64 calls;
+    u64 ns;
+} tic_perf_counter;
+
+typedef struct
+{
+    u64 frames;
+    tic_perf_counter phases[tic_perf_phases_count];
+    tic_perf_counter api[tic_api_count];
+} tic_perf_stats;
+
 struct tic_mem
 {
     tic_ram             ram;
@@ -168,6 +203,8 @@ struct tic_mem
         u8 data;
     } input;
 
+    // sound of the last frame, the size varies by a sample when the
+    // samplerate isn't a multiple of the framerate
     struct
     {
         s16* buffer;
@@ -182,15 +219,60 @@ struct tic_mem
     tic80_pixel_color_format screen_format;
 };
 
+typedef void(*tic_sound_write)(const s16* samples, s32 count, void* data);
+
+typedef struct
+{
+    const tic_sfx* sfx;
+    const tic_music* music;
+    s32 track;
+    bool sustain;
+
+    // bit per channel
+    u8 mute;
+
+    // frames limit, tracks can loop forever with the jump command
+    s32 frames;
+
+    s32 samplerate;
+    tic_sound_write write;
+    void* data;
+} tic_music_render;
+
 tic_mem* tic_core_create(s32 samplerate);
 void tic_core_close(tic_mem* memory);
+// loads the first bank, code and cover, the other banks are paged in by tic_api_sync
+void tic_core_load_cart(tic_mem* memory, const void* buffer, s32 size);
 void tic_core_pause(tic_mem* memory);
 void tic_core_resume(tic_mem* memory);
+u32 tic_core_state_size(tic_mem* memory);
+u32 tic_core_state_length(tic_mem* memory);
+u32 tic_core_state_save(tic_mem* memory, void* buffer, u32 size);
+bool tic_core_state_load(tic_mem* memory, const void* buffer, u32 size);
+void tic_core_rewind_init(tic_mem* memory, u32 limit);
+void tic_core_rewind_close(tic_mem* memory);
+void tic_core_rewind_reset(tic_mem* memory);
+bool tic_core_rewind_push(tic_mem* memory);
+bool tic_core_rewind_step(tic_mem* memory);
+u32 tic_core_rewind_frames(tic_mem* memory);
 void tic_core_tick_start(tic_mem* memory);
 void tic_core_tick(tic_mem* memory, tic_tick_data* data);
 void tic_core_tick_end(tic_mem* memory);
+s32 tic_core_sound_render(tic_mem* memory, s16* buffer, s32 count);
+s32 tic_core_render_music(const tic_music_render* params);
 void tic_core_blit(tic_mem* tic, tic80_pixel_color_format fmt);
 void tic_core_blit_ex(tic_mem* tic, tic80_pixel_color_format fmt, tic_scanline scanline, tic_overline overline, void* data);
+// renders the frame straight to the caller's buffer, 'pitch' is the row size in bytes,
+// only the TIC80_WIDTH x TIC80_HEIGHT area is written unless 'border' is set
+void tic_core_blit_to(tic_mem* tic, tic80_pixel_color_format fmt, void* pixels, s32 pitch, bool border);
+s32 tic_core_dirty_rects(tic_mem* tic, tic_rect* rects, s32 count);
+void tic_core_invalidate_rows(tic_mem* tic, s32 y, s32 height);
+void tic_core_perf_enable(tic_mem* memory, bool enable);
+void tic_core_perf_reset(tic_mem* memory);
+const tic_perf_stats* tic_core_perf_stats(tic_mem* memory);
+char* tic_core_perf_trace(tic_mem* memory, s32* size);
+const char* tic_core_perf_phase_name(tic_perf_phase phase);
+const char* tic_core_perf_api_name(tic_api_id id);
 const tic_script_config* tic_core_script_config(tic_mem* memory);
 
 typedef struct
@@ -147,7 +147,7 @@ static duk_ret_t duk_rectb(duk_context* duk)
 
 static duk_ret_t duk_spr(duk_context* duk)
 {
-    static u8 colors[TIC_PALETTE_SIZE];
+    u8 colors[TIC_PALETTE_SIZE];
     s32 count = 0;
 
     s32 index = duk_opt_int(duk, 0, 0);
@@ -418,7 +418,7 @@ static duk_ret_t duk_map(duk_context* duk)
     s32 sy = duk_opt_int(duk, 5, 0);
     s32 scale = duk_opt_int(duk, 7, 1);
 
-    static u8 colors[TIC_PALETTE_SIZE];
+    u8 colors[TIC_PALETTE_SIZE];
     s32 count = 0;
 
     {
@@ -729,7 +729,7 @@ static duk_ret_t duk_textri(duk_context* duk)
     tic_mem* tic = (tic_mem*)getDukCore(duk);
     bool use_map = duk_opt_boolean(duk, 12, false);
 
-    static u8 colors[TIC_PALETTE_SIZE];
+    u8 colors[TIC_PALETTE_SIZE];
     s32 count = 0;
     {
         if(!duk_is_null_or_undefined(duk, 13))
@@ -859,21 +859,46 @@ static duk_ret_t duk_fset(duk_context* duk)
     return 0;
 }
 
-static u64 ForceExitCounter = 0;
-
 s32 duk_timeout_check(void* udata)
 {
     tic_core* core = (tic_core*)udata;
     tic_tick_data* tick = core->data;
 
-    return ForceExitCounter++ > 1000 ? tick->forceExit && tick->forceExit(tick->data) : false;
+    return core->jsTimeoutCounter++ > 1000 ? tick->forceExit && tick->forceExit(tick->data) : false;
+}
+
+static void* dukAlloc(void* udata, duk_size_t size)
+{
+    return heap_realloc(((tic_core*)udata)->heap, NULL, size);
 }
 
+static void* dukRealloc(void* udata, void* ptr, duk_size_t size)
+{
+    return heap_realloc(((tic_core*)udata)->heap, ptr, size);
+}
+
+static void dukFree(void* udata, void* ptr)
+{
+    heap_realloc(((tic_core*)udata)->heap, ptr, 0);
+}
+
+#define API_FUNC_DEF(name, ...)                                 \
+    static duk_ret_t duk_perf_ ## name(duk_context* duk)        \
+    {                                                           \
+        tic_core* core = getDukCore(duk);                       \
+        u64 start = tic_core_perf_start(core);                  \
+        duk_ret_t result = duk_ ## name(duk);                   \
+        tic_core_perf_api(core, tic_api_id_ ## name, start);    \
+        return result;                                          \
+    }
+TIC_API_LIST(API_FUNC_DEF)
+#undef API_FUNC_DEF
+
 static void initDuktape(tic_core* core)
 {
     closeJavascript((tic_mem*)core);
 
-    duk_context* duk = core->js = duk_create_heap(NULL, NULL, NULL, core, NULL);
+    duk_context* duk = core->js = duk_create_heap(dukAlloc, dukRealloc, dukFree, core, NULL);
 
     {
         duk_push_global_stash(duk);
@@ -882,13 +907,13 @@ static void initDuktape(tic_core* core)
         duk_pop(duk);
     }
 
-#define API_FUNC_DEF(name, paramsCount, ...) {duk_ ## name, paramsCount, #name},
-    static const struct{duk_c_function func; s32 params; const char* name;} ApiItems[] = {TIC_API_LIST(API_FUNC_DEF)};
+#define API_FUNC_DEF(name, paramsCount, ...) {duk_ ## name, duk_perf_ ## name, paramsCount, #name},
+    static const struct{duk_c_function func; duk_c_function perf; s32 params; const char* name;} ApiItems[] = {TIC_API_LIST(API_FUNC_DEF)};
 #undef API_FUNC_DEF
 
     for (s32 i = 0; i < COUNT_OF(ApiItems); i++)
     {
-        duk_push_c_function(core->js, ApiItems[i].func, ApiItems[i].params);
+        duk_push_c_function(core->js, core->perf ? ApiItems[i].perf : ApiItems[i].func, ApiItems[i].params);
         duk_put_global_string(core->js, ApiItems[i].name);
     }
 }
@@ -910,12 +935,47 @@ static bool initJavascript(tic_mem* tic, const char* code)
     return true;
 }
 
-static void callJavascriptTick(tic_mem* tic)
+// SCN, legacy scanline and OVR functions are kept in the global stash at these indices
+enum
+{
+    JsScnRef,
+    JsScanlineRef,
+    JsOvrRef,
+};
+
+static void callJavascriptScanline(tic_mem* tic, s32 row, void* data);
+static void callJavascriptOverline(tic_mem* tic, void* data);
+
+// SCN and OVR are resolved once a frame after TIC, which is where carts (re)define them,
+// so the blit doesn't look them up by name for every scanline
+static void updateJavascriptCallbacks(tic_core* core)
 {
-    ForceExitCounter = 0;
+    static const char* const Names[] = {SCN_FN, "scanline", OVR_FN};
 
+    duk_context* duk = core->js;
+    bool defined[COUNT_OF(Names)];
+
+    duk_push_global_stash(duk);
+
+    for(s32 i = 0; i < COUNT_OF(Names); i++)
+    {
+        duk_get_global_string(duk, Names[i]);
+        defined[i] = duk_is_function(duk, -1);
+        duk_put_prop_index(duk, -2, i);
+    }
+
+    duk_pop(duk);
+
+    core->state.scanline = defined[JsScnRef] || defined[JsScanlineRef] ? callJavascriptScanline : NULL;
+    core->state.ovr.callback = defined[JsOvrRef] ? callJavascriptOverline : NULL;
+}
+
+static void callJavascriptTick(tic_mem* tic)
+{
     tic_core* core = (tic_core*)tic;
 
+    core->jsTimeoutCounter = 0;
+
     duk_context* duk = core->js;
 
     if(duk)
@@ -930,15 +990,19 @@ static void callJavascriptTick(tic_mem* tic)
         else core->data->error(core->data->data, "'function TIC()...' isn't found :(");
 
         duk_pop(duk);
+
+        updateJavascriptCallbacks(core);
     }
 }
 
-static void callJavascriptScanlineName(tic_mem* tic, s32 row, void* data, const char* name)
+static void callJavascriptScanlineRef(tic_mem* tic, s32 row, duk_uarridx_t ref)
 {
     tic_core* core = (tic_core*)tic;
     duk_context* duk = core->js;
 
-    if(duk_get_global_string(duk, name))
+    duk_push_global_stash(duk);
+
+    if(duk_get_prop_index(duk, -1, ref) && duk_is_function(duk, -1))
     {
         duk_push_int(duk, row);
 
@@ -946,15 +1010,15 @@ static void callJavascriptScanlineName(tic_mem* tic, s32 row, void* data, const
             core->data->error(core->data->data, duk_safe_to_stacktrace(duk, -1));
     }
 
-    duk_pop(duk);
+    duk_pop_2(duk);
 }
 
 static void callJavascriptScanline(tic_mem* tic, s32 row, void* data)
 {
-    callJavascriptScanlineName(tic, row, data, SCN_FN);
+    callJavascriptScanlineRef(tic, row, JsScnRef);
 
     // try to call old scanline
-    callJavascriptScanlineName(tic, row, data, "scanline");
+    callJavascriptScanlineRef(tic, row, JsScanlineRef);
 }
 
 static void callJavascriptOverline(tic_mem* tic, void* data)
@@ -962,13 +1026,15 @@ static void callJavascriptOverline(tic_mem* tic, void* data)
     tic_core* core = (tic_core*)tic;
     duk_context* duk = core->js;
 
-    if(duk_get_global_string(duk, OVR_FN))
+    duk_push_global_stash(duk);
+
+    if(duk_get_prop_index(duk, -1, JsOvrRef) && duk_is_function(duk, -1))
     {
         if(duk_pcall(duk, 0) != 0)
             core->data->error(core->data->data, duk_safe_to_stacktrace(duk, -1));
     }
 
-    duk_pop(duk);
+    duk_pop_2(duk);
 }
 
 static const char* const JsKeywords [] =
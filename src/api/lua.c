@@ -25,6 +25,7 @@
 #if defined(TIC_BUILD_WITH_LUA)
 
 #include <stdlib.h>
+#include <stdio.h>
 #include <string.h>
 #include <lua.h>
 #include <lauxlib.h>
@@ -33,28 +34,50 @@
 
 #define LUA_LOC_STACK 100000000
 
-static const char TicCore[] = "_TIC80";
-
 s32 luaopen_lpeg(lua_State *lua);
 
-// !TODO: get rid of this wrap
+// integers are taken as they are, the rest is converted like lua_tonumber does and truncated
 static s32 getLuaNumber(lua_State* lua, s32 index)
 {
-    return (s32)lua_tonumber(lua, index);
+    return lua_isinteger(lua, index)
+        ? (s32)lua_tointeger(lua, index)
+        : (s32)lua_tonumber(lua, index);
 }
 
+// the argument is decoded only if the call passes at least `top` ones, `value` is used otherwise,
+// the ones with zero `top` (tables, functions, booleans) are decoded by the API function itself
+typedef struct
+{
+    s32 value;
+    s32 top;
+} LuaArg;
+
+#define API_PARAMS_DEF(name, paramsCount, ...) LuaParams_ ## name = paramsCount,
+enum {TIC_API_LIST(API_PARAMS_DEF)};
+#undef API_PARAMS_DEF
+
+static void getLuaArgs(lua_State* lua, s32 top, const LuaArg* spec, s32* args, s32 count)
+{
+    for(s32 i = 0; i < count; i++)
+        args[i] = spec[i].top && top >= spec[i].top ? getLuaNumber(lua, i + 1) : spec[i].value;
+}
+
+// the API functions are light C functions, the core is found in the state extra space
 static void registerLuaFunction(tic_core* core, lua_CFunction func, const char *name)
 {
     lua_pushcfunction(core->lua, func);
     lua_setglobal(core->lua, name);
 }
 
+static void setLuaCore(lua_State* lua, tic_core* core)
+{
+    // coroutines get a copy of it when they are created
+    *(tic_core**)lua_getextraspace(lua) = core;
+}
+
 static tic_core* getLuaCore(lua_State* lua)
 {
-    lua_getglobal(lua, TicCore);
-    tic_core* core = lua_touserdata(lua, -1);
-    lua_pop(lua, 1);
-    return core;
+    return *(tic_core**)lua_getextraspace(lua);
 }
 
 static s32 lua_peek(lua_State* lua)
@@ -125,11 +148,12 @@ static s32 lua_poke4(lua_State* lua)
 
 static s32 lua_cls(lua_State* lua)
 {
-    s32 top = lua_gettop(lua);
+    static const LuaArg Args[LuaParams_cls] = {{0, 1}};
 
-    tic_mem* tic = (tic_mem*)getLuaCore(lua);
+    s32 args[LuaParams_cls];
+    getLuaArgs(lua, lua_gettop(lua), Args, args, LuaParams_cls);
 
-    tic_api_cls(tic, top == 1 ? getLuaNumber(lua, 1) : 0);
+    tic_api_cls((tic_mem*)getLuaCore(lua), args[0]);
 
     return 0;
 }
@@ -303,7 +327,7 @@ static s32 lua_textri(lua_State* lua)
             pt[i] = (float)lua_tonumber(lua, i + 1);
 
         tic_mem* tic = (tic_mem*)getLuaCore(lua);
-        static u8 colors[TIC_PALETTE_SIZE];
+        u8 colors[TIC_PALETTE_SIZE];
         s32 count = 0;
         bool use_map = false;
 
@@ -436,83 +460,62 @@ static s32 lua_btn(lua_State* lua)
     return 1;
 }
 
-static s32 lua_spr(lua_State* lua)
+static void getLuaColors(lua_State* lua, s32 index, u8* colors, s32* count)
 {
-    s32 top = lua_gettop(lua);
-
-    s32 index = 0;
-    s32 x = 0;
-    s32 y = 0;
-    s32 w = 1;
-    s32 h = 1;
-    s32 scale = 1;
-    tic_flip flip = tic_no_flip;
-    tic_rotate rotate = tic_no_rotate;
-    static u8 colors[TIC_PALETTE_SIZE];
-    s32 count = 0;
-
-    if(top >= 1) 
+    if(lua_istable(lua, index))
     {
-        index = getLuaNumber(lua, 1);
-
-        if(top >= 3)
+        for(s32 i = 1; i <= TIC_PALETTE_SIZE; i++)
         {
-            x = getLuaNumber(lua, 2);
-            y = getLuaNumber(lua, 3);
-
-            if(top >= 4)
+            lua_rawgeti(lua, index, i);
+            if(lua_isnumber(lua, -1))
             {
-                if(lua_istable(lua, 4))
-                {
-                    for(s32 i = 1; i <= TIC_PALETTE_SIZE; i++)
-                    {
-                        lua_rawgeti(lua, 4, i);
-                        if(lua_isnumber(lua, -1))
-                        {
-                            colors[i-1] = getLuaNumber(lua, -1);
-                            count++;
-                            lua_pop(lua, 1);
-                        }
-                        else
-                        {
-                            lua_pop(lua, 1);
-                            break;
-                        }
-                    }
-                }
-                else 
-                {
-                    colors[0] = getLuaNumber(lua, 4);
-                    count = 1;
-                }
+                colors[i-1] = getLuaNumber(lua, -1);
+                (*count)++;
+                lua_pop(lua, 1);
+            }
+            else
+            {
+                lua_pop(lua, 1);
+                break;
+            }
+        }
+    }
+    else 
+    {
+        colors[0] = getLuaNumber(lua, index);
+        *count = 1;
+    }
+}
 
-                if(top >= 5)
-                {
-                    scale = getLuaNumber(lua, 5);
+static s32 lua_spr(lua_State* lua)
+{
+    enum {Index, X, Y, Colorkey, Scale, Flip, Rotate, W, H};
 
-                    if(top >= 6)
-                    {
-                        flip = getLuaNumber(lua, 6);
+    static const LuaArg Args[LuaParams_spr] =
+    {
+        [Index]     = {0, 1},
+        [X]         = {0, 3},
+        [Y]         = {0, 3},
+        [Scale]     = {1, 5},
+        [Flip]      = {tic_no_flip, 6},
+        [Rotate]    = {tic_no_rotate, 7},
+        [W]         = {1, 9},
+        [H]         = {1, 9},
+    };
 
-                        if(top >= 7)
-                        {
-                            rotate = getLuaNumber(lua, 7);
+    s32 top = lua_gettop(lua);
+    s32 args[LuaParams_spr];
+    getLuaArgs(lua, top, Args, args, LuaParams_spr);
 
-                            if(top >= 9)
-                            {
-                                w = getLuaNumber(lua, 8);
-                                h = getLuaNumber(lua, 9);
-                            }
-                        }
-                    }
-                }
-            }
-        }
-    }
+    u8 colors[TIC_PALETTE_SIZE];
+    s32 count = 0;
+
+    if(top > Colorkey)
+        getLuaColors(lua, Colorkey + 1, colors, &count);
 
     tic_mem* tic = (tic_mem*)getLuaCore(lua);
 
-    tic_api_spr(tic, index, x, y, w, h, colors, count, scale, flip, rotate);
+    tic_api_spr(tic, args[Index], args[X], args[Y], args[W], args[H], colors, count, args[Scale], args[Flip], args[Rotate]);
 
     return 0;
 }
@@ -571,98 +574,54 @@ static void remapCallback(void* data, s32 x, s32 y, RemapResult* result)
     lua_pushinteger(lua, result->index);
     lua_pushinteger(lua, x);
     lua_pushinteger(lua, y);
-    lua_pcall(lua, 3, 3, 0);
 
-    result->index = getLuaNumber(lua, -3);
-    result->flip = getLuaNumber(lua, -2);
-    result->rotate = getLuaNumber(lua, -1);
+    if(lua_pcall(lua, 3, 3, 0) == LUA_OK)
+    {
+        result->index = getLuaNumber(lua, -3);
+        result->flip = getLuaNumber(lua, -2);
+        result->rotate = getLuaNumber(lua, -1);
+        lua_pop(lua, 3);
+    }
+    else lua_pop(lua, 1);
 }
 
 static s32 lua_map(lua_State* lua)
 {
-    s32 x = 0;
-    s32 y = 0;
-    s32 w = TIC_MAP_SCREEN_WIDTH;
-    s32 h = TIC_MAP_SCREEN_HEIGHT;
-    s32 sx = 0;
-    s32 sy = 0;
-    s32 scale = 1;
-    static u8 colors[TIC_PALETTE_SIZE];
-    s32 count = 0;
-
-    s32 top = lua_gettop(lua);
+    enum {X, Y, W, H, Sx, Sy, Colorkey, Scale, Remap};
 
-    if(top >= 2) 
+    static const LuaArg Args[LuaParams_map] =
     {
-        x = getLuaNumber(lua, 1);
-        y = getLuaNumber(lua, 2);
-
-        if(top >= 4)
-        {
-            w = getLuaNumber(lua, 3);
-            h = getLuaNumber(lua, 4);
-
-            if(top >= 6)
-            {
-                sx = getLuaNumber(lua, 5);
-                sy = getLuaNumber(lua, 6);
-
-                if(top >= 7)
-                {
-                    if(lua_istable(lua, 7))
-                    {
-                        for(s32 i = 1; i <= TIC_PALETTE_SIZE; i++)
-                        {
-                            lua_rawgeti(lua, 7, i);
-                            if(lua_isnumber(lua, -1))
-                            {
-                                colors[i-1] = getLuaNumber(lua, -1);
-                                count++;
-                                lua_pop(lua, 1);
-                            }
-                            else
-                            {
-                                lua_pop(lua, 1);
-                                break;
-                            }
-                        }
-                    }
-                    else 
-                    {
-                        colors[0] = getLuaNumber(lua, 7);
-                        count = 1;
-                    }
+        [X]         = {0, 2},
+        [Y]         = {0, 2},
+        [W]         = {TIC_MAP_SCREEN_WIDTH, 4},
+        [H]         = {TIC_MAP_SCREEN_HEIGHT, 4},
+        [Sx]        = {0, 6},
+        [Sy]        = {0, 6},
+        [Scale]     = {1, 8},
+    };
 
-                    if(top >= 8)
-                    {
-                        scale = getLuaNumber(lua, 8);
+    s32 top = lua_gettop(lua);
+    s32 args[LuaParams_map];
+    getLuaArgs(lua, top, Args, args, LuaParams_map);
 
-                        if(top >= 9)
-                        {
-                            if (lua_isfunction(lua, 9))
-                            {
-                                s32 remap = luaL_ref(lua, LUA_REGISTRYINDEX);
+    u8 colors[TIC_PALETTE_SIZE];
+    s32 count = 0;
 
-                                RemapData data = {lua, remap};
+    if(top > Colorkey)
+        getLuaColors(lua, Colorkey + 1, colors, &count);
 
-                                tic_mem* tic = (tic_mem*)getLuaCore(lua);
+    tic_mem* tic = (tic_mem*)getLuaCore(lua);
 
-                                tic_api_map(tic, x, y, w, h, sx, sy, colors, count, scale, remapCallback, &data);
+    if(top > Remap && lua_isfunction(lua, Remap + 1))
+    {
+        lua_settop(lua, Remap + 1);
+        RemapData data = {lua, luaL_ref(lua, LUA_REGISTRYINDEX)};
 
-                                luaL_unref(lua, LUA_REGISTRYINDEX, data.reg);
+        tic_api_map(tic, args[X], args[Y], args[W], args[H], args[Sx], args[Sy], colors, count, args[Scale], remapCallback, &data);
 
-                                return 0;
-                            }                           
-                        }
-                    }
-                }
-            }
-        }
+        luaL_unref(lua, LUA_REGISTRYINDEX, data.reg);
     }
-
-    tic_mem* tic = (tic_mem*)getLuaCore(lua);
-
-    tic_api_map((tic_mem*)getLuaCore(lua), x, y, w, h, sx, sy, colors, count, scale, NULL, NULL);
+    else tic_api_map(tic, args[X], args[Y], args[W], args[H], args[Sx], args[Sy], colors, count, args[Scale], NULL, NULL);
 
     return 0;
 }
@@ -945,76 +904,48 @@ static s32 lua_memset(lua_State* lua)
     return 0;
 }
 
+// strings are taken in place, the rest is converted by the tostring rules
+// and stays on the stack until the API function returns
 static const char* printString(lua_State* lua, s32 index)
 {
-    lua_getglobal(lua, "tostring");
-    lua_pushvalue(lua, -1);
-    lua_pushvalue(lua, index);
-    lua_call(lua, 1, 1);
-
-    const char* text = lua_tostring(lua, -1);
-
-    lua_pop(lua, 2);
-
-    return text;
+    return lua_type(lua, index) == LUA_TSTRING
+        ? lua_tostring(lua, index)
+        : luaL_tolstring(lua, index, NULL);
 }
 
 static s32 lua_font(lua_State* lua)
 {
+    enum {Text, X, Y, Chromakey, Width, Height, Fixed, Scale, Alt};
+
+    static const LuaArg Args[LuaParams_font] =
+    {
+        [X]         = {0, 3},
+        [Y]         = {0, 3},
+        [Chromakey] = {0, 4},
+        [Width]     = {TIC_SPRITESIZE, 6},
+        [Height]    = {TIC_SPRITESIZE, 6},
+        [Scale]     = {1, 8},
+    };
+
     tic_mem* tic = (tic_mem*)getLuaCore(lua);
     s32 top = lua_gettop(lua);
 
     if(top >= 1)
     {
-        const char* text = printString(lua, 1);
-        s32 x = 0;
-        s32 y = 0;
-        s32 width = TIC_SPRITESIZE;
-        s32 height = TIC_SPRITESIZE;
-        u8 chromakey = 0;
-        bool fixed = false;
-        s32 scale = 1;
-        bool alt = false;
-
-        if(top >= 3)
-        {
-            x = getLuaNumber(lua, 2);
-            y = getLuaNumber(lua, 3);
-
-            if(top >= 4)
-            {
-                chromakey = getLuaNumber(lua, 4);
-
-                if(top >= 6)
-                {
-                    width = getLuaNumber(lua, 5);
-                    height = getLuaNumber(lua, 6);
-
-                    if(top >= 7)
-                    {
-                        fixed = lua_toboolean(lua, 7);
+        s32 args[LuaParams_font];
+        getLuaArgs(lua, top, Args, args, LuaParams_font);
 
-                        if(top >= 8)
-                        {
-                            scale = getLuaNumber(lua, 8);
+        bool fixed = top > Fixed && lua_toboolean(lua, Fixed + 1);
+        bool alt = top > Alt && lua_toboolean(lua, Alt + 1);
 
-                            if(top >= 9)
-                            {
-                                alt = lua_toboolean(lua, 9);
-                            }
-                        }
-                    }
-                }
-            }
-        }
-
-        if(scale == 0)
+        if(args[Scale] == 0)
         {
             lua_pushinteger(lua, 0);
             return 1;
         }
 
-        s32 size = tic_api_font(tic, text, x, y, chromakey, width, height, fixed, scale, alt);
+        const char* text = printString(lua, Text + 1);
+        s32 size = tic_api_font(tic, text, args[X], args[Y], args[Chromakey], args[Width], args[Height], fixed, args[Scale], alt);
 
         lua_pushinteger(lua, size);
 
@@ -1026,54 +957,36 @@ static s32 lua_font(lua_State* lua)
 
 static s32 lua_print(lua_State* lua)
 {
+    enum {Text, X, Y, Color, Fixed, Scale, Alt};
+
+    static const LuaArg Args[LuaParams_print] =
+    {
+        [X]         = {0, 3},
+        [Y]         = {0, 3},
+        [Color]     = {TIC_DEFAULT_COLOR, 4},
+        [Scale]     = {1, 6},
+    };
+
     s32 top = lua_gettop(lua);
 
     if(top >= 1) 
     {
         tic_mem* tic = (tic_mem*)getLuaCore(lua);
 
-        s32 x = 0;
-        s32 y = 0;
-        s32 color = TIC_DEFAULT_COLOR;
-        bool fixed = false;
-        s32 scale = 1;
-        bool alt = false;
+        s32 args[LuaParams_print];
+        getLuaArgs(lua, top, Args, args, LuaParams_print);
 
-        const char* text = printString(lua, 1);
+        bool fixed = top > Fixed && lua_toboolean(lua, Fixed + 1);
+        bool alt = top > Alt && lua_toboolean(lua, Alt + 1);
 
-        if(top >= 3)
-        {
-            x = getLuaNumber(lua, 2);
-            y = getLuaNumber(lua, 3);
-
-            if(top >= 4)
-            {
-                color = getLuaNumber(lua, 4) % TIC_PALETTE_SIZE;
-
-                if(top >= 5)
-                {
-                    fixed = lua_toboolean(lua, 5);
-
-                    if(top >= 6)
-                    {
-                        scale = getLuaNumber(lua, 6);
-
-                        if(top >= 7)
-                        {
-                            alt = lua_toboolean(lua, 7);
-                        }
-                    }
-                }
-            }
-        }
-
-        if(scale == 0)
+        if(args[Scale] == 0)
         {
             lua_pushinteger(lua, 0);
             return 1;
         }
 
-        s32 size = tic_api_print(tic, text ? text : "nil", x, y, color, fixed, scale, alt);
+        const char* text = printString(lua, Text + 1);
+        s32 size = tic_api_print(tic, text ? text : "nil", args[X], args[Y], args[Color] % TIC_PALETTE_SIZE, fixed, args[Scale], alt);
 
         lua_pushinteger(lua, size);
 
@@ -1277,17 +1190,31 @@ static void checkForceExit(lua_State *lua, lua_Debug *luadebug)
         luaL_error(lua, "script execution was interrupted");
 }
 
+#define API_FUNC_DEF(name, ...)                                 \
+    static s32 lua_perf_ ## name(lua_State* lua)                \
+    {                                                           \
+        tic_core* core = getLuaCore(lua);                       \
+        u64 start = tic_core_perf_start(core);                  \
+        s32 result = lua_ ## name(lua);                         \
+        tic_core_perf_api(core, tic_api_id_ ## name, start);    \
+        return result;                                          \
+    }
+TIC_API_LIST(API_FUNC_DEF)
+#undef API_FUNC_DEF
+
 static void initAPI(tic_core* core)
 {
-    lua_pushlightuserdata(core->lua, core);
-    lua_setglobal(core->lua, TicCore);
+    setLuaCore(core->lua, core);
+
+    core->luaRefs.scn = core->luaRefs.scanline = core->luaRefs.ovr = LUA_NOREF;
 
-#define API_FUNC_DEF(name, ...) {lua_ ## name, #name},
-    static const struct{lua_CFunction func; const char* name;} ApiItems[] = {TIC_API_LIST(API_FUNC_DEF)};
+#define API_FUNC_DEF(name, ...) {lua_ ## name, lua_perf_ ## name, #name},
+    static const struct{lua_CFunction func; lua_CFunction perf; const char* name;} ApiItems[] = {TIC_API_LIST(API_FUNC_DEF)};
 #undef API_FUNC_DEF
 
+    // profiled wrappers are bound only if the profiler is on when the VM starts
     for (s32 i = 0; i < COUNT_OF(ApiItems); i++)
-        registerLuaFunction(core, ApiItems[i].func, ApiItems[i].name);
+        registerLuaFunction(core, core->perf ? ApiItems[i].perf : ApiItems[i].func, ApiItems[i].name);
 
     registerLuaFunction(core, lua_dofile, "dofile");
     registerLuaFunction(core, lua_loadfile, "loadfile");
@@ -1295,6 +1222,89 @@ static void initAPI(tic_core* core)
     lua_sethook(core->lua, &checkForceExit, LUA_MASKCOUNT, LUA_LOC_STACK);
 }
 
+static void* luaAlloc(void* ud, void* ptr, size_t osize, size_t nsize)
+{
+    return heap_realloc((Heap*)ud, ptr, nsize);
+}
+
+// lua_newstate() leaves the panic and warning handlers unset, these are the
+// ones luaL_newstate() installs (from lauxlib.c)
+static s32 luaPanic(lua_State* lua)
+{
+    const char* msg = lua_tostring(lua, -1);
+
+    if (msg == NULL)
+        msg = "error object is not a string";
+
+    lua_writestringerror("PANIC: unprotected error in call to Lua API (%s)\n", msg);
+    return 0;
+}
+
+#if LUA_VERSION_NUM >= 504
+
+static void luaWarnOn(void* ud, const char* message, s32 tocont);
+static void luaWarnOff(void* ud, const char* message, s32 tocont);
+
+static bool luaWarnControl(lua_State* lua, const char* message, s32 tocont)
+{
+    if (tocont || *(message++) != '@')
+        return false;
+
+    if (strcmp(message, "off") == 0)
+        lua_setwarnf(lua, luaWarnOff, lua);
+    else if (strcmp(message, "on") == 0)
+        lua_setwarnf(lua, luaWarnOn, lua);
+
+    return true;
+}
+
+static void luaWarnOff(void* ud, const char* message, s32 tocont)
+{
+    luaWarnControl((lua_State*)ud, message, tocont);
+}
+
+static void luaWarnCont(void* ud, const char* message, s32 tocont)
+{
+    lua_State* lua = (lua_State*)ud;
+
+    lua_writestringerror("%s", message);
+
+    if (tocont)
+        lua_setwarnf(lua, luaWarnCont, lua);
+    else
+    {
+        lua_writestringerror("%s", "\n");
+        lua_setwarnf(lua, luaWarnOn, lua);
+    }
+}
+
+static void luaWarnOn(void* ud, const char* message, s32 tocont)
+{
+    if (luaWarnControl((lua_State*)ud, message, tocont))
+        return;
+
+    lua_writestringerror("%s", "Lua warning: ");
+    luaWarnCont(ud, message, tocont);
+}
+
+#endif
+
+static lua_State* newLuaState(tic_core* core)
+{
+    lua_State* lua = lua_newstate(luaAlloc, core->heap);
+
+    if (lua)
+    {
+        lua_atpanic(lua, luaPanic);
+
+#if LUA_VERSION_NUM >= 504
+        lua_setwarnf(lua, luaWarnOff, lua);
+#endif
+    }
+
+    return lua;
+}
+
 static void closeLua(tic_mem* tic)
 {
     tic_core* core = (tic_core*)tic;
@@ -1312,7 +1322,7 @@ static bool initLua(tic_mem* tic, const char* code)
 
     closeLua(tic);
 
-    lua_State* lua = core->lua = luaL_newstate();
+    lua_State* lua = core->lua = newLuaState(core);
     lua_open_builtins(lua);
 
     initAPI(core);
@@ -1367,6 +1377,42 @@ static s32 docall (lua_State *lua, s32 narg, s32 nres)
     return status;
 }
 
+static void callLuaScanline(tic_mem* tic, s32 row, void* data);
+static void callLuaOverline(tic_mem* tic, void* data);
+
+static void updateLuaRef(lua_State* lua, s32* ref, const char* name)
+{
+    lua_getglobal(lua, name);
+
+    if(lua_isfunction(lua, -1))
+    {
+        if(*ref == LUA_NOREF)
+            *ref = luaL_ref(lua, LUA_REGISTRYINDEX);
+        else lua_rawseti(lua, LUA_REGISTRYINDEX, *ref);
+    }
+    else
+    {
+        lua_pop(lua, 1);
+        luaL_unref(lua, LUA_REGISTRYINDEX, *ref);
+        *ref = LUA_NOREF;
+    }
+}
+
+// SCN and OVR are resolved once a frame after TIC, which is where carts (re)define them,
+// so the blit doesn't look them up by name for every scanline
+static void updateLuaCallbacks(tic_core* core)
+{
+    lua_State* lua = core->lua;
+
+    updateLuaRef(lua, &core->luaRefs.scn, SCN_FN);
+    updateLuaRef(lua, &core->luaRefs.scanline, "scanline");
+    updateLuaRef(lua, &core->luaRefs.ovr, OVR_FN);
+
+    core->state.scanline = core->luaRefs.scn != LUA_NOREF || core->luaRefs.scanline != LUA_NOREF
+        ? callLuaScanline : NULL;
+    core->state.ovr.callback = core->luaRefs.ovr != LUA_NOREF ? callLuaOverline : NULL;
+}
+
 static void callLuaTick(tic_mem* tic)
 {
     tic_core* core = (tic_core*)tic;
@@ -1386,33 +1432,33 @@ static void callLuaTick(tic_mem* tic)
             lua_pop(lua, 1);
             core->data->error(core->data->data, "'function TIC()...' isn't found :(");
         }
+
+        updateLuaCallbacks(core);
     }
 }
 
-static void callLuaScanlineName(tic_mem* tic, s32 row, void* data, const char* name)
+static void callLuaScanlineRef(tic_mem* tic, s32 row, s32 ref)
 {
     tic_core* core = (tic_core*)tic;
     lua_State* lua = core->lua;
 
-    if (lua)
+    if (lua && ref != LUA_NOREF)
     {
-        lua_getglobal(lua, name);
-        if(lua_isfunction(lua, -1))
-        {
-            lua_pushinteger(lua, row);
-            if(docall(lua, 1, 0) != LUA_OK)
-                core->data->error(core->data->data, lua_tostring(lua, -1));
-        }
-        else lua_pop(lua, 1);
+        lua_rawgeti(lua, LUA_REGISTRYINDEX, ref);
+        lua_pushinteger(lua, row);
+        if(docall(lua, 1, 0) != LUA_OK)
+            core->data->error(core->data->data, lua_tostring(lua, -1));
     }
 }
 
 static void callLuaScanline(tic_mem* tic, s32 row, void* data)
 {
-    callLuaScanlineName(tic, row, data, SCN_FN);
+    tic_core* core = (tic_core*)tic;
+
+    callLuaScanlineRef(tic, row, core->luaRefs.scn);
 
     // try to call old scanline
-    callLuaScanlineName(tic, row, data, "scanline");
+    callLuaScanlineRef(tic, row, core->luaRefs.scanline);
 }
 
 static void callLuaOverline(tic_mem* tic, void* data)
@@ -1420,19 +1466,12 @@ static void callLuaOverline(tic_mem* tic, void* data)
     tic_core* core = (tic_core*)tic;
     lua_State* lua = core->lua;
 
-    if (lua)
+    if (lua && core->luaRefs.ovr != LUA_NOREF)
     {
-        const char* OvrFunc = OVR_FN;
-
-        lua_getglobal(lua, OvrFunc);
-        if(lua_isfunction(lua, -1)) 
-        {
-            if(docall(lua, 0, 0) != LUA_OK)
-                core->data->error(core->data->data, lua_tostring(lua, -1));
-        }
-        else lua_pop(lua, 1);
+        lua_rawgeti(lua, LUA_REGISTRYINDEX, core->luaRefs.ovr);
+        if(docall(lua, 0, 0) != LUA_OK)
+            core->data->error(core->data->data, lua_tostring(lua, -1));
     }
-
 }
 
 static const char* const LuaKeywords [] =
@@ -1547,20 +1586,30 @@ const tic_script_config* getLuaScriptConfig()
     return &LuaSyntaxConfig;
 }
 
-#if defined(TIC_BUILD_WITH_MOON)
+#if defined(TIC_BUILD_WITH_MOON) || defined(TIC_BUILD_WITH_FENNEL)
 
-#include "moonscript.h"
+// MoonScript and Fennel are compiled to Lua in separate states which stay loaded between runs,
+// the Lua is cached by the source hash, so a restart of an unchanged cart doesn't compile at all
 
-#define MOON_CODE(...) #__VA_ARGS__
+typedef struct
+{
+    // also the name of the file the last compiled cart is saved to
+    const char* name;
 
-static const char* execute_moonscript_src = MOON_CODE(
-    local fn, err = require('moonscript.base').loadstring(...)
+    // the compiler sources, the bundle has to be run to register the compiler modules
+    const u8* bundle;
+    s32 bundleSize;
+    const char* bundleName;
 
-    if not fn then
-        error(err)
-    end
-    return fn()
-);
+    // takes the cart source, returns its Lua
+    const char* compile;
+    const char* compileName;
+
+    // the module carts can require, the bundle is run in the cart state on demand
+    const char* module;
+
+    bool lpeg;
+} LuaCompiler;
 
 static void setloaded(lua_State* l, char* name)
 {
@@ -1577,54 +1626,318 @@ static void setloaded(lua_State* l, char* name)
     lua_settop(l, top);
 }
 
-static bool initMoonscript(tic_mem* tic, const char* code)
+// package.preload loader of the compiler module, runs the bundle on the first
+// require, the bundle then puts the module to package.loaded or registers its
+// own loader in place of this one
+static s32 requireCompiler(lua_State* lua)
 {
-    tic_core* core = (tic_core*)tic;
-    closeLua(tic);
+    const char* name = luaL_checkstring(lua, 1);
+    const char* bundle = (const char*)lua_touserdata(lua, lua_upvalueindex(1));
+    s32 bundleSize = (s32)lua_tointeger(lua, lua_upvalueindex(2));
+    const char* bundleName = lua_tostring(lua, lua_upvalueindex(3));
+
+    lua_settop(lua, 1);
+    lua_getglobal(lua, "package");
+
+    lua_getfield(lua, 2, "preload");
+    lua_pushnil(lua);
+    lua_setfield(lua, 3, name);
+
+    if(luaL_loadbuffer(lua, bundle, bundleSize, bundleName) != LUA_OK)
+        return lua_error(lua);
+
+    lua_call(lua, 0, 0);
+
+    lua_getfield(lua, 3, name);
+
+    if(lua_isfunction(lua, -1))
+    {
+        lua_pushvalue(lua, 1);
+        lua_call(lua, 1, 1);
+        return 1;
+    }
+
+    lua_getfield(lua, 2, "loaded");
+    lua_getfield(lua, -1, name);
+
+    return 1;
+}
+
+static void preloadCompiler(lua_State* lua, const LuaCompiler* compiler)
+{
+    lua_getglobal(lua, "package");
+    lua_getfield(lua, -1, "preload");
+
+    lua_pushlightuserdata(lua, (void*)compiler->bundle);
+    lua_pushinteger(lua, compiler->bundleSize);
+    lua_pushstring(lua, compiler->bundleName);
+    lua_pushcclosure(lua, requireCompiler, 3);
+    lua_setfield(lua, -2, compiler->module);
+
+    lua_pop(lua, 2);
+}
+
+static lua_State* newLuaCompiler(tic_core* core, const LuaCompiler* compiler)
+{
+    // the compiler lives out of the VM heap, it isn't a part of the cart state
+    lua_State* lua = luaL_newstate();
+
+    if(!lua)
+        return NULL;
 
-    lua_State* lua = core->lua = luaL_newstate();
     lua_open_builtins(lua);
 
-    luaopen_lpeg(lua);
-    setloaded(lua, "lpeg");
+    if(compiler->lpeg)
+    {
+        luaopen_lpeg(lua);
+        setloaded(lua, "lpeg");
+    }
 
-    initAPI(core);
+    // macros can loop forever, the compiler is interrupted the same way as the cart
+    setLuaCore(lua, core);
+    lua_sethook(lua, &checkForceExit, LUA_MASKCOUNT, LUA_LOC_STACK);
+
+    lua_settop(lua, 0);
+
+    if(luaL_loadbuffer(lua, (const char*)compiler->bundle, compiler->bundleSize, compiler->bundleName) != LUA_OK
+        || lua_pcall(lua, 0, 0, 0) != LUA_OK)
+    {
+        lua_close(lua);
+        return NULL;
+    }
+
+    return lua;
+}
+
+// returns the Lua the code compiles to, the caller frees it
+static char* compileLua(tic_core* core, const LuaCompiler* compiler, lua_State** state, const char* code, s32* size)
+{
+    if(!*state && !(*state = newLuaCompiler(core, compiler)))
+    {
+        core->data->error(core->data->data, "failed to load the compiler");
+        return NULL;
+    }
+
+    lua_State* lua = *state;
+    char* result = NULL;
+
+    lua_settop(lua, 0);
 
+    if(luaL_loadbuffer(lua, compiler->compile, strlen(compiler->compile), compiler->compileName) != LUA_OK)
     {
-        lua_State* moon = core->lua;
+        core->data->error(core->data->data, "failed to load the compiler");
+        return NULL;
+    }
+
+    lua_pushstring(lua, code);
 
-        lua_settop(moon, 0);
+    if(lua_pcall(lua, 1, 1, 0) == LUA_OK && lua_type(lua, -1) == LUA_TSTRING)
+    {
+        size_t len = 0;
+        const char* lua_code = lua_tolstring(lua, -1, &len);
 
-        if (luaL_loadbuffer(moon, (const char *)moonscript_lua, moonscript_lua_len, "moonscript.lua") != LUA_OK)
+        if((result = malloc(len + 1)))
         {
-            core->data->error(core->data->data, "failed to load moonscript.lua");
-            return false;
+            memcpy(result, lua_code, len + 1);
+            *size = (s32)len;
         }
+    }
+    else
+    {
+        const char* msg = lua_tostring(lua, -1);
+        core->data->error(core->data->data, msg ? msg : "compilation failed");
+    }
+
+    lua_settop(lua, 0);
 
-        lua_call(moon, 0, 0);
+    return result;
+}
+
+enum {TranspiledHeader = sizeof "--0123456789abcdef\n" - 1};
 
-        if (luaL_loadbuffer(moon, execute_moonscript_src, strlen(execute_moonscript_src), "execute_moonscript") != LUA_OK)
+static void addTranspiled(tic_core* core, u64 hash, char* code, s32 size)
+{
+    tic_transpiled* item = &core->transpiled.items[core->transpiled.next];
+    core->transpiled.next = (core->transpiled.next + 1) % TIC_TRANSPILED_CACHE;
+
+    free(item->code);
+
+    item->hash = hash;
+    item->code = code;
+    item->size = size;
+}
+
+// the compiled Lua of the code, from memory, from the last saved one or compiled now,
+// the result is owned by the cache and stays until the cache is refilled
+static const char* transpile(tic_core* core, const LuaCompiler* compiler, lua_State** state, const char* code, s32* size)
+{
+    // FNV-1a
+    u64 hash = 0xcbf29ce484222325ull;
+    for(const char* ptr = compiler->name; *ptr; ptr++)
+        hash = (hash ^ (u8)*ptr) * 0x100000001b3ull;
+    for(const char* ptr = code; *ptr; ptr++)
+        hash = (hash ^ (u8)*ptr) * 0x100000001b3ull;
+
+    for(s32 i = 0; i < TIC_TRANSPILED_CACHE; i++)
+    {
+        const tic_transpiled* item = &core->transpiled.items[i];
+
+        if(item->code && item->hash == hash)
         {
-            core->data->error(core->data->data, "failed to load moonscript compiler");
-            return false;
+            *size = item->size;
+            return item->code;
         }
+    }
+
+    tic_tick_data* data = core->data;
+    char header[TranspiledHeader + 1];
+    snprintf(header, sizeof header, "--%016llx\n", (unsigned long long)hash);
 
-        lua_pushstring(moon, code);
-        if (lua_pcall(moon, 1, 1, 0) != LUA_OK)
+    // the saved file starts with the hash in a comment
+    if(data->cacheLoad)
+    {
+        s32 saved = 0;
+        char* buffer = data->cacheLoad(data->data, compiler->name, &saved);
+
+        if(buffer)
         {
-            const char* msg = lua_tostring(moon, -1);
+            char* result = NULL;
 
-            if (msg)
+            if(saved >= TranspiledHeader && memcmp(buffer, header, TranspiledHeader) == 0
+                && (result = malloc(saved - TranspiledHeader + 1)))
             {
-                core->data->error(core->data->data, msg);
-                return false;
+                *size = saved - TranspiledHeader;
+                memcpy(result, buffer + TranspiledHeader, *size);
+                result[*size] = '\0';
+
+                addTranspiled(core, hash, result, *size);
             }
+
+            free(buffer);
+
+            if(result)
+                return result;
+        }
+    }
+
+    char* result = compileLua(core, compiler, state, code, size);
+
+    if(!result)
+        return NULL;
+
+    addTranspiled(core, hash, result, *size);
+
+    if(data->cacheSave)
+    {
+        char* buffer = malloc(TranspiledHeader + *size);
+
+        if(buffer)
+        {
+            memcpy(buffer, header, TranspiledHeader);
+            memcpy(buffer + TranspiledHeader, result, *size);
+            data->cacheSave(data->data, compiler->name, buffer, TranspiledHeader + *size);
+            free(buffer);
+        }
+    }
+
+    return result;
+}
+
+static bool runTranspiled(tic_core* core, const char* code, s32 size, const char* name)
+{
+    lua_State* lua = core->lua;
+
+    lua_settop(lua, 0);
+
+    if(luaL_loadbuffer(lua, code, size, name) != LUA_OK || lua_pcall(lua, 0, 0, 0) != LUA_OK)
+    {
+        const char* msg = lua_tostring(lua, -1);
+
+        if (msg)
+        {
+            core->data->error(core->data->data, msg);
+            return false;
         }
     }
 
     return true;
 }
 
+void closeLuaCompilers(tic_mem* tic)
+{
+    tic_core* core = (tic_core*)tic;
+
+    if(core->transpiled.moon)
+    {
+        lua_close(core->transpiled.moon);
+        core->transpiled.moon = NULL;
+    }
+
+    if(core->transpiled.fennel)
+    {
+        lua_close(core->transpiled.fennel);
+        core->transpiled.fennel = NULL;
+    }
+
+    for(s32 i = 0; i < TIC_TRANSPILED_CACHE; i++)
+    {
+        free(core->transpiled.items[i].code);
+        core->transpiled.items[i].code = NULL;
+    }
+}
+
+#endif
+
+#if defined(TIC_BUILD_WITH_MOON)
+
+#include "moonscript.h"
+
+#define MOON_CODE(...) #__VA_ARGS__
+
+static const char* execute_moonscript_src = MOON_CODE(
+    local code, err = require('moonscript.base').to_lua(...)
+
+    if not code then
+        error(err)
+    end
+    return code
+);
+
+static bool initMoonscript(tic_mem* tic, const char* code)
+{
+    tic_core* core = (tic_core*)tic;
+    closeLua(tic);
+
+    const LuaCompiler compiler =
+    {
+        .name           = "moon",
+        .bundle         = moonscript_lua,
+        .bundleSize     = moonscript_lua_len,
+        .bundleName     = "moonscript.lua",
+        .compile        = execute_moonscript_src,
+        .compileName    = "execute_moonscript",
+        .module         = "moonscript",
+        .lpeg           = true,
+    };
+
+    s32 size = 0;
+    const char* lua_code = transpile(core, &compiler, &core->transpiled.moon, code, &size);
+
+    if(!lua_code)
+        return false;
+
+    lua_State* lua = core->lua = newLuaState(core);
+    lua_open_builtins(lua);
+
+    luaopen_lpeg(lua);
+    setloaded(lua, "lpeg");
+
+    preloadCompiler(lua, &compiler);
+    initAPI(core);
+
+    return runTranspiled(core, lua_code, size, "=(moonscript.loadstring)");
+}
+
 static const char* const MoonKeywords [] =
 {
     "false", "true", "nil", "local", "return",
@@ -1724,52 +2037,44 @@ const tic_script_config* getMoonScriptConfig()
 
 static const char* execute_fennel_src = FENNEL_CODE(
   local opts = {filename="game", correlate=true, allowedGlobals=false}
-  local ok, msg = pcall(require('fennel').eval, ..., opts)
-  if(not ok) then return msg end
+  return require('fennel').compileString(..., opts)
 );
 
+static LuaCompiler getFennelCompiler()
+{
+    return (LuaCompiler)
+    {
+        .name           = "fennel",
+        .bundle         = loadfennel_lua,
+        .bundleSize     = loadfennel_lua_len,
+        .bundleName     = "fennel.lua",
+        .compile        = execute_fennel_src,
+        .compileName    = "execute_fennel",
+        .module         = "fennel",
+        .lpeg           = false,
+    };
+}
+
 static bool initFennel(tic_mem* tic, const char* code)
 {
     tic_core* core = (tic_core*)tic;
     closeLua(tic);
 
-    lua_State* lua = core->lua = luaL_newstate();
-    lua_open_builtins(lua);
+    const LuaCompiler compiler = getFennelCompiler();
 
-    initAPI(core);
+    s32 size = 0;
+    const char* lua_code = transpile(core, &compiler, &core->transpiled.fennel, code, &size);
 
-    {
-        lua_State* fennel = core->lua;
-
-        lua_settop(fennel, 0);
+    if(!lua_code)
+        return false;
 
-        if (luaL_loadbuffer(fennel, (const char *)loadfennel_lua,
-                            loadfennel_lua_len, "fennel.lua") != LUA_OK)
-        {
-            core->data->error(core->data->data, "failed to load fennel compiler");
-            return false;
-        }
-
-        lua_call(fennel, 0, 0);
-
-        if (luaL_loadbuffer(fennel, execute_fennel_src, strlen(execute_fennel_src), "execute_fennel") != LUA_OK)
-        {
-            core->data->error(core->data->data, "failed to load fennel compiler");
-            return false;
-        }
-
-        lua_pushstring(fennel, code);
-        lua_call(fennel, 1, 1);
-        const char* err = lua_tostring(fennel, -1);
+    lua_State* lua = core->lua = newLuaState(core);
+    lua_open_builtins(lua);
 
-        if (err)
-        {
-            core->data->error(core->data->data, err);
-            return false;
-        }
-    }
+    preloadCompiler(lua, &compiler);
+    initAPI(core);
 
-    return true;
+    return runTranspiled(core, lua_code, size, "@game");
 }
 
 static const char* const FennelKeywords [] =
@@ -1842,22 +2147,17 @@ static const tic_outline_item* getFennelOutline(const char* code, s32* size)
 
 static void evalFennel(tic_mem* tic, const char* code) {
     tic_core* core = (tic_core*)tic;
-    lua_State* fennel = core->lua;
 
-    lua_settop(fennel, 0);
-
-    if (luaL_loadbuffer(fennel, execute_fennel_src, strlen(execute_fennel_src), "execute_fennel") != LUA_OK)
-    {
-        core->data->error(core->data->data, "failed to load fennel compiler");
-    }
+    // the snippets are compiled every time, they would only push the cart out of the cache
+    const LuaCompiler compiler = getFennelCompiler();
 
-    lua_pushstring(fennel, code);
-    lua_call(fennel, 1, 1);
-    const char* err = lua_tostring(fennel, -1);
+    s32 size = 0;
+    char* lua_code = compileLua(core, &compiler, &core->transpiled.fennel, code, &size);
 
-    if (err)
+    if(lua_code)
     {
-        core->data->error(core->data->data, err);
+        runTranspiled(core, lua_code, size, "@game");
+        free(lua_code);
     }
 }
 
@@ -359,7 +359,7 @@ static SQInteger squirrel_textri(HSQUIRRELVM vm)
         }
 
         tic_mem* tic = (tic_mem*)getSquirrelCore(vm);
-        static u8 colors[TIC_PALETTE_SIZE];
+        u8 colors[TIC_PALETTE_SIZE];
         s32 count = 0;
         bool use_map = false;
 
@@ -505,7 +505,7 @@ static SQInteger squirrel_spr(HSQUIRRELVM vm)
     s32 scale = 1;
     tic_flip flip = tic_no_flip;
     tic_rotate rotate = tic_no_rotate;
-    static u8 colors[TIC_PALETTE_SIZE];
+    u8 colors[TIC_PALETTE_SIZE];
     s32 count = 0;
 
     if(top >= 2) 
@@ -668,7 +668,7 @@ static SQInteger squirrel_map(HSQUIRRELVM vm)
     s32 sx = 0;
     s32 sy = 0;
     s32 scale = 1;
-    static u8 colors[TIC_PALETTE_SIZE];
+    u8 colors[TIC_PALETTE_SIZE];
     s32 count = 0;
 
     SQInteger top = sq_gettop(vm);
@@ -1374,6 +1374,18 @@ static void checkForceExit(HSQUIRRELVM vm, SQInteger type, const SQChar* sourceN
         sq_throwerror(vm, "script execution was interrupted");
 }
 
+#define API_FUNC_DEF(name, ...)                                 \
+    static SQInteger squirrel_perf_ ## name(HSQUIRRELVM vm)     \
+    {                                                           \
+        tic_core* core = getSquirrelCore(vm);                   \
+        u64 start = tic_core_perf_start(core);                  \
+        SQInteger result = squirrel_ ## name(vm);               \
+        tic_core_perf_api(core, tic_api_id_ ## name, start);    \
+        return result;                                          \
+    }
+TIC_API_LIST(API_FUNC_DEF)
+#undef API_FUNC_DEF
+
 static void initAPI(tic_core* core)
 {
     HSQUIRRELVM vm = core->squirrel;
@@ -1390,12 +1402,12 @@ static void initAPI(tic_core* core)
     sq_setforeignptr(vm, core);
 #endif
 
-#define API_FUNC_DEF(name, ...) {squirrel_ ## name, #name},
-    static const struct{SQFUNCTION func; const char* name;} ApiItems[] = {TIC_API_LIST(API_FUNC_DEF)};
+#define API_FUNC_DEF(name, ...) {squirrel_ ## name, squirrel_perf_ ## name, #name},
+    static const struct{SQFUNCTION func; SQFUNCTION perf; const char* name;} ApiItems[] = {TIC_API_LIST(API_FUNC_DEF)};
 #undef API_FUNC_DEF
 
     for (s32 i = 0; i < COUNT_OF(ApiItems); i++)
-        registerSquirrelFunction(core, ApiItems[i].func, ApiItems[i].name);
+        registerSquirrelFunction(core, core->perf ? ApiItems[i].perf : ApiItems[i].func, ApiItems[i].name);
 
     registerSquirrelFunction(core, squirrel_dofile, "dofile");
     registerSquirrelFunction(core, squirrel_loadfile, "loadfile");
@@ -1458,6 +1470,60 @@ static bool initSquirrel(tic_mem* tic, const char* code)
     return true;
 }
 
+// SCN, legacy scanline and OVR functions are kept in the registry table at these indices
+enum
+{
+    SquirrelScnRef,
+    SquirrelScanlineRef,
+    SquirrelOvrRef,
+};
+
+static void callSquirrelScanline(tic_mem* tic, s32 row, void* data);
+static void callSquirrelOverline(tic_mem* tic, void* data);
+
+static bool isSquirrelFunction(HSQUIRRELVM vm)
+{
+    SQObjectType type = sq_gettype(vm, -1);
+    return type == OT_CLOSURE || type == OT_NATIVECLOSURE;
+}
+
+// SCN and OVR are resolved once a frame after TIC, which is where carts (re)define them,
+// so the blit doesn't look them up by name for every scanline
+static void updateSquirrelCallbacks(tic_core* core)
+{
+    static const char* const Names[] = {SCN_FN, "scanline", OVR_FN};
+
+    HSQUIRRELVM vm = core->squirrel;
+    SQInteger top = sq_gettop(vm);
+    bool defined[COUNT_OF(Names)];
+
+    sq_pushregistrytable(vm);
+
+    for(s32 i = 0; i < COUNT_OF(Names); i++)
+    {
+        sq_pushinteger(vm, i);
+
+        sq_pushroottable(vm);
+        sq_pushstring(vm, Names[i], -1);
+
+        defined[i] = SQ_SUCCEEDED(sq_get(vm, -2)) && isSquirrelFunction(vm);
+
+        if(!defined[i])
+        {
+            sq_settop(vm, top + 2);
+            sq_pushnull(vm);
+        }
+        else sq_remove(vm, -2);
+
+        sq_newslot(vm, -3, SQFalse);
+    }
+
+    sq_settop(vm, top);
+
+    core->state.scanline = defined[SquirrelScnRef] || defined[SquirrelScanlineRef] ? callSquirrelScanline : NULL;
+    core->state.ovr.callback = defined[SquirrelOvrRef] ? callSquirrelOverline : NULL;
+}
+
 static void callSquirrelTick(tic_mem* tic)
 {
     tic_core* core = (tic_core*)tic;
@@ -1490,24 +1556,30 @@ static void callSquirrelTick(tic_mem* tic)
             if (core->data)
                 core->data->error(core->data->data, "'function TIC()...' isn't found :(");
         }
+
+        updateSquirrelCallbacks(core);
     }
 }
 
-static void callSquirrelScanlineName(tic_mem* tic, s32 row, void* data, const char* name)
+static void callSquirrelRef(tic_core* core, SQInteger ref, const s32* row)
 {
-    tic_core* core = (tic_core*)tic;
     HSQUIRRELVM vm = core->squirrel;
 
     if (vm)
     {
-        sq_pushroottable(vm);
-        sq_pushstring(vm, name, -1);
-        if (SQ_SUCCEEDED(sq_get(vm, -2)))
+        SQInteger top = sq_gettop(vm);
+
+        sq_pushregistrytable(vm);
+        sq_pushinteger(vm, ref);
+
+        if (SQ_SUCCEEDED(sq_get(vm, -2)) && isSquirrelFunction(vm))
         {
             sq_pushroottable(vm);
-            sq_pushinteger(vm, row);
 
-            if(SQ_FAILED(sq_call(vm, 2, SQFalse, SQTrue)))
+            if (row)
+                sq_pushinteger(vm, *row);
+
+            if(SQ_FAILED(sq_call(vm, row ? 2 : 1, SQFalse, SQTrue)))
             {
                 sq_getlasterror(vm);
                 sq_tostring(vm, -1);
@@ -1516,50 +1588,26 @@ static void callSquirrelScanlineName(tic_mem* tic, s32 row, void* data, const ch
                 sq_getstring(vm, -1, &errorString);
                 if (core->data)
                     core->data->error(core->data->data, errorString);
-                sq_pop(vm, 3); // error string, error and root table
             }
         }
-        else sq_poptop(vm);
+
+        sq_settop(vm, top);
     }
 }
 
 static void callSquirrelScanline(tic_mem* tic, s32 row, void* data)
 {
-    callSquirrelScanlineName(tic, row, data, SCN_FN);
+    tic_core* core = (tic_core*)tic;
+
+    callSquirrelRef(core, SquirrelScnRef, &row);
 
     // try to call old scanline
-    callSquirrelScanlineName(tic, row, data, "scanline");
+    callSquirrelRef(core, SquirrelScanlineRef, &row);
 }
 
 static void callSquirrelOverline(tic_mem* tic, void* data)
 {
-    tic_core* core = (tic_core*)tic;
-    HSQUIRRELVM vm = core->squirrel;
-
-    if (vm)
-    {
-        const char* OvrFunc = OVR_FN;
-
-        sq_pushroottable(vm);
-        sq_pushstring(vm, OvrFunc, -1);
-        
-        if(SQ_SUCCEEDED(sq_get(vm, -2))) 
-        {
-            sq_pushroottable(vm);
-            if(SQ_FAILED(sq_call(vm, 1, SQFalse, SQTrue)))
-            {
-                sq_getlasterror(vm);
-                sq_tostring(vm, -1);
-                const SQChar* errorString = "unknown error";
-                sq_getstring(vm, -1, &errorString);
-                if (core->data)
-                    core->data->error(core->data->data, errorString);
-                sq_pop(vm, 3);
-            }
-        }
-        else sq_poptop(vm);
-    }
-
+    callSquirrelRef((tic_core*)tic, SquirrelOvrRef, NULL);
 }
 
 static const char* const SquirrelKeywords [] =
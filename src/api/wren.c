@@ -32,14 +32,6 @@
 #include "tools.h"
 #include "wren.h"
 
-static WrenHandle* game_class;
-static WrenHandle* new_handle;
-static WrenHandle* update_handle;
-static WrenHandle* scanline_handle;
-static WrenHandle* overline_handle;
-
-static bool loaded = false;
-
 static char const* tic_wren_api = "\n\
 class TIC {\n\
     foreign static btn(id)\n\
@@ -200,15 +192,15 @@ static void closeWren(tic_mem* tic)
     if(core->wren)
     {   
         // release handles
-        if (loaded)
+        if (core->wrenHandles.loaded)
         {
-            wrenReleaseHandle(core->wren, new_handle);
-            wrenReleaseHandle(core->wren, update_handle);
-            wrenReleaseHandle(core->wren, scanline_handle);
-            wrenReleaseHandle(core->wren, overline_handle);
-            if (game_class != NULL) 
+            wrenReleaseHandle(core->wren, core->wrenHandles.init);
+            wrenReleaseHandle(core->wren, core->wrenHandles.update);
+            wrenReleaseHandle(core->wren, core->wrenHandles.scanline);
+            wrenReleaseHandle(core->wren, core->wrenHandles.overline);
+            if (core->wrenHandles.game != NULL) 
             {
-                wrenReleaseHandle(core->wren, game_class);
+                wrenReleaseHandle(core->wren, core->wrenHandles.game);
             }
         }
 
@@ -216,7 +208,7 @@ static void closeWren(tic_mem* tic)
         core->wren = NULL;
 
     }
-    loaded = false;
+    core->wrenHandles.loaded = false;
 }
 
 static tic_core* getWrenCore(WrenVM* vm)
@@ -508,7 +500,7 @@ static void wren_spr(WrenVM* vm)
     s32 scale = 1;
     tic_flip flip = tic_no_flip;
     tic_rotate rotate = tic_no_rotate;
-    static u8 colors[TIC_PALETTE_SIZE];
+    u8 colors[TIC_PALETTE_SIZE];
     s32 count = 0;
 
     if(top > 1) 
@@ -583,7 +575,7 @@ static void wren_spr_internal(WrenVM* vm)
     s32 x = getWrenNumber(vm, 2);
     s32 y = getWrenNumber(vm, 3);
 
-    static u8 colors[TIC_PALETTE_SIZE];
+    u8 colors[TIC_PALETTE_SIZE];
     s32 count = 0;
             
     if(isList(vm, 4))
@@ -628,7 +620,7 @@ static void wren_map(WrenVM* vm)
     s32 sx = 0;
     s32 sy = 0;
     s32 scale = 1;
-    static u8 colors[TIC_PALETTE_SIZE];
+    u8 colors[TIC_PALETTE_SIZE];
     s32 count = 0;
 
     s32 top = wrenGetSlotCount(vm);
@@ -722,7 +714,7 @@ static void wren_textri(WrenVM* vm)
     }
 
     tic_mem* tic = (tic_mem*)getWrenCore(vm);
-    static u8 colors[TIC_PALETTE_SIZE];
+    u8 colors[TIC_PALETTE_SIZE];
     s32 count = 0;
     bool use_map = false;
 
@@ -1313,6 +1305,31 @@ static WrenForeignMethodFn foreignTicMethods(const char* signature)
 static const WrenForeignMethodFn ApiFuncList[] = {TIC_API_LIST(API_FUNC_DEF)};
 #undef API_FUNC_DEF
 
+#define API_FUNC_DEF(name, ...)                                 \
+    static void wren_perf_ ## name(WrenVM* vm)                  \
+    {                                                           \
+        tic_core* core = getWrenCore(vm);                       \
+        u64 start = tic_core_perf_start(core);                  \
+        wren_ ## name(vm);                                      \
+        tic_core_perf_api(core, tic_api_id_ ## name, start);    \
+    }
+TIC_API_LIST(API_FUNC_DEF)
+#undef API_FUNC_DEF
+
+#define API_FUNC_DEF(name, ...) wren_perf_##name,
+static const WrenForeignMethodFn PerfFuncList[] = {TIC_API_LIST(API_FUNC_DEF)};
+#undef API_FUNC_DEF
+
+static WrenForeignMethodFn profileForeignMethod(WrenVM* vm, WrenForeignMethodFn func)
+{
+    if(func && getWrenCore(vm)->perf)
+        for (s32 i = 0; i < COUNT_OF(ApiFuncList); i++)
+            if(ApiFuncList[i] == func)
+                return PerfFuncList[i];
+
+    return func;
+}
+
 static WrenForeignMethodFn bindForeignMethod(
     WrenVM* vm, const char* module, const char* className,
     bool isStatic, const char* signature)
@@ -1331,7 +1348,7 @@ static WrenForeignMethodFn bindForeignMethod(
     strcat(fullName, ".");
     strcat(fullName, signature);
 
-    return foreignTicMethods(fullName);
+    return profileForeignMethod(vm, foreignTicMethods(fullName));
 }
 
 static void initAPI(tic_core* core)
@@ -1389,32 +1406,32 @@ static bool initWren(tic_mem* tic, const char* code)
         return false;
     }
 
-    loaded = true;
+    core->wrenHandles.loaded = true;
 
     // make handles
     wrenEnsureSlots(vm, 1);
     wrenGetVariable(vm, "main", "Game", 0);
-    game_class = wrenGetSlotHandle(vm, 0); // handle from game class 
+    core->wrenHandles.game = wrenGetSlotHandle(vm, 0); // handle from game class 
 
-    new_handle = wrenMakeCallHandle(vm, "new()");
-    update_handle = wrenMakeCallHandle(vm, TIC_FN "()");
-    scanline_handle = wrenMakeCallHandle(vm, SCN_FN "(_)");
-    overline_handle = wrenMakeCallHandle(vm, OVR_FN "()");
+    core->wrenHandles.init = wrenMakeCallHandle(vm, "new()");
+    core->wrenHandles.update = wrenMakeCallHandle(vm, TIC_FN "()");
+    core->wrenHandles.scanline = wrenMakeCallHandle(vm, SCN_FN "(_)");
+    core->wrenHandles.overline = wrenMakeCallHandle(vm, OVR_FN "()");
 
     // create game class
-    if (game_class)
+    if (core->wrenHandles.game)
     {
         wrenEnsureSlots(vm, 1);
-        wrenSetSlotHandle(vm, 0, game_class);
-        wrenCall(vm, new_handle);
-        wrenReleaseHandle(core->wren, game_class); // release game class handle
-        game_class = NULL;
+        wrenSetSlotHandle(vm, 0, core->wrenHandles.game);
+        wrenCall(vm, core->wrenHandles.init);
+        wrenReleaseHandle(core->wren, core->wrenHandles.game); // release game class handle
+        core->wrenHandles.game = NULL;
         if (wrenGetSlotCount(vm) == 0) 
         {
             core->data->error(core->data->data, "Error in game class :(");
             return false;
         }
-        game_class = wrenGetSlotHandle(vm, 0); // handle from game object 
+        core->wrenHandles.game = wrenGetSlotHandle(vm, 0); // handle from game object 
     } else {
         core->data->error(core->data->data, "'Game class' isn't found :(");   
         return false;
@@ -1428,11 +1445,11 @@ static void callWrenTick(tic_mem* tic)
     tic_core* core = (tic_core*)tic;
     WrenVM* vm = core->wren;
 
-    if(vm && game_class)
+    if(vm && core->wrenHandles.game)
     {
         wrenEnsureSlots(vm, 1);
-        wrenSetSlotHandle(vm, 0, game_class);
-        wrenCall(vm, update_handle);
+        wrenSetSlotHandle(vm, 0, core->wrenHandles.game);
+        wrenCall(vm, core->wrenHandles.update);
     }
 }
 
@@ -1441,12 +1458,12 @@ static void callWrenScanline(tic_mem* tic, s32 row, void* data)
     tic_core* core = (tic_core*)tic;
     WrenVM* vm = core->wren;
 
-    if(vm && game_class)
+    if(vm && core->wrenHandles.game)
     {
         wrenEnsureSlots(vm, 2);
-        wrenSetSlotHandle(vm, 0, game_class);
+        wrenSetSlotHandle(vm, 0, core->wrenHandles.game);
         wrenSetSlotDouble(vm, 1, row);
-        wrenCall(vm, scanline_handle);
+        wrenCall(vm, core->wrenHandles.scanline);
     }
 }
 
@@ -1455,11 +1472,11 @@ static void callWrenOverline(tic_mem* tic, void* data)
     tic_core* core = (tic_core*)tic;
     WrenVM* vm = core->wren;
 
-    if (vm && game_class)
+    if (vm && core->wrenHandles.game)
     {
         wrenEnsureSlots(vm, 1);
-        wrenSetSlotHandle(vm, 0, game_class);
-        wrenCall(vm, overline_handle);
+        wrenSetSlotHandle(vm, 0, core->wrenHandles.game);
+        wrenCall(vm, core->wrenHandles.overline);
     }
 }
 
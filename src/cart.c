@@ -60,103 +60,229 @@ STATIC_ASSERT(tic_chunk_size, sizeof(Chunk) == 4);
 static const u8 Sweetie16[] = {0x1a, 0x1c, 0x2c, 0x5d, 0x27, 0x5d, 0xb1, 0x3e, 0x53, 0xef, 0x7d, 0x57, 0xff, 0xcd, 0x75, 0xa7, 0xf0, 0x70, 0x38, 0xb7, 0x64, 0x25, 0x71, 0x79, 0x29, 0x36, 0x6f, 0x3b, 0x5d, 0xc9, 0x41, 0xa6, 0xf6, 0x73, 0xef, 0xf7, 0xf4, 0xf4, 0xf4, 0x94, 0xb0, 0xc2, 0x56, 0x6c, 0x86, 0x33, 0x3c, 0x57};
 static const u8 Waveforms[] = {0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x00, 0x00, 0x00, 0x00, 0xff, 0xff, 0xff, 0xff, 0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0xef, 0xcd, 0xab, 0x89, 0x67, 0x45, 0x23, 0x01, 0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe, 0x10, 0x32, 0x54, 0x76, 0x98, 0xba, 0xdc, 0xfe};
 
-void tic_cart_load(tic_cartridge* cart, const u8* buffer, s32 size)
+bool tic_cart_index_create(tic_cart_index* index, const u8* buffer, s32 size)
 {
+    const u8* ptr = buffer;
     const u8* end = buffer + size;
-    memset(cart, 0, sizeof(tic_cartridge));
-
-    #define LOAD_CHUNK(to) memcpy(&to, buffer, MIN(sizeof(to), chunk.size))
-
-    bool paletteExists = false;
-
-    tic_code* code = calloc(TIC_BANKS, TIC_CODE_BANK_SIZE);
+    s32 capacity = 0;
 
-    if(!code) return;
+    *index = (tic_cart_index){.buffer = buffer};
 
-    while(buffer < end)
+    while(ptr + sizeof(Chunk) <= end)
     {
         Chunk chunk;
-        memcpy(&chunk, buffer, sizeof(Chunk));
-        buffer += sizeof(Chunk);
+        memcpy(&chunk, ptr, sizeof(Chunk));
+        ptr += sizeof(Chunk);
 
-        switch(chunk.type)
+        if(index->count == capacity)
         {
-        case CHUNK_TILES:       LOAD_CHUNK(cart->banks[chunk.bank].tiles);          break;
-        case CHUNK_SPRITES:     LOAD_CHUNK(cart->banks[chunk.bank].sprites);        break;
-        case CHUNK_MAP:         LOAD_CHUNK(cart->banks[chunk.bank].map);            break;
-        case CHUNK_SAMPLES:     LOAD_CHUNK(cart->banks[chunk.bank].sfx.samples);    break;
-        case CHUNK_WAVEFORM:    LOAD_CHUNK(cart->banks[chunk.bank].sfx.waveforms);  break;
-        case CHUNK_MUSIC:       LOAD_CHUNK(cart->banks[chunk.bank].music.tracks);   break;
-        case CHUNK_PATTERNS:    LOAD_CHUNK(cart->banks[chunk.bank].music.patterns); break;
-        case CHUNK_PALETTE:     LOAD_CHUNK(cart->banks[chunk.bank].palette);        break;
-        case CHUNK_FLAGS:       LOAD_CHUNK(cart->banks[chunk.bank].flags);          break;
-        case CHUNK_CODE:        LOAD_CHUNK(code->banks[chunk.bank].data);           break;
-        case CHUNK_CODE_ZIP:
-            tic_tool_unzip(cart->code.data, TIC_CODE_SIZE, buffer, chunk.size);
-            break;
-        case CHUNK_COVER:
-            LOAD_CHUNK(cart->cover.data);
-            cart->cover.size = chunk.size;
-            break;
-        case CHUNK_PATTERNS_DEP: 
+            capacity = capacity ? capacity * 2 : TIC_BANKS * 16;
+            tic_cart_chunk* chunks = realloc(index->chunks, capacity * sizeof(tic_cart_chunk));
+
+            if(!chunks)
             {
-                // workaround to load deprecated music patterns section
-                // and automatically convert volume value to a command
-                tic_patterns* ptrns = &cart->banks[chunk.bank].music.patterns;
-                LOAD_CHUNK(*ptrns);
-                for(s32 i = 0; i < MUSIC_PATTERNS; i++)
-                    for(s32 r = 0; r < MUSIC_PATTERN_ROWS; r++)
+                tic_cart_index_free(index);
+                return false;
+            }
+
+            index->chunks = chunks;
+        }
+
+        // a truncated file only loses its tail
+        s32 chunkSize = (s32)MIN(chunk.size, end - ptr);
+
+        index->chunks[index->count++] = (tic_cart_chunk)
+        {
+            .offset = (u32)(ptr - buffer),
+            .size = chunkSize,
+            .type = chunk.type,
+            .bank = chunk.bank,
+        };
+
+        if(chunk.type != CHUNK_CODE && chunk.type != CHUNK_CODE_ZIP && chunk.type != CHUNK_COVER)
+            index->banks |= 1 << chunk.bank;
+
+        ptr += chunkSize;
+    }
+
+    return true;
+}
+
+void tic_cart_index_free(tic_cart_index* index)
+{
+    free(index->chunks);
+    *index = (tic_cart_index){0};
+}
+
+static void loadBankChunk(tic_bank* bank, const tic_cart_chunk* chunk, const u8* data)
+{
+    #define LOAD_CHUNK(to) memcpy(&to, data, MIN(sizeof(to), chunk->size))
+
+    switch(chunk->type)
+    {
+    case CHUNK_TILES:       LOAD_CHUNK(bank->tiles);          break;
+    case CHUNK_SPRITES:     LOAD_CHUNK(bank->sprites);        break;
+    case CHUNK_MAP:         LOAD_CHUNK(bank->map);            break;
+    case CHUNK_SAMPLES:     LOAD_CHUNK(bank->sfx.samples);    break;
+    case CHUNK_WAVEFORM:    LOAD_CHUNK(bank->sfx.waveforms);  break;
+    case CHUNK_MUSIC:       LOAD_CHUNK(bank->music.tracks);   break;
+    case CHUNK_PATTERNS:    LOAD_CHUNK(bank->music.patterns); break;
+    case CHUNK_PALETTE:     LOAD_CHUNK(bank->palette);        break;
+    case CHUNK_FLAGS:       LOAD_CHUNK(bank->flags);          break;
+    case CHUNK_PATTERNS_DEP: 
+        {
+            // workaround to load deprecated music patterns section
+            // and automatically convert volume value to a command
+            tic_patterns* ptrns = &bank->music.patterns;
+            LOAD_CHUNK(*ptrns);
+            for(s32 i = 0; i < MUSIC_PATTERNS; i++)
+                for(s32 r = 0; r < MUSIC_PATTERN_ROWS; r++)
+                {
+                    tic_track_row* row = &ptrns->data[i].rows[r];
+                    if(row->note >= NoteStart && row->command == tic_music_cmd_empty)
                     {
-                        tic_track_row* row = &ptrns->data[i].rows[r];
-                        if(row->note >= NoteStart && row->command == tic_music_cmd_empty)
-                        {
-                            row->command = tic_music_cmd_volume;
-                            row->param2 = row->param1 = MAX_VOLUME - row->param1;
-                        }
+                        row->command = tic_music_cmd_volume;
+                        row->param2 = row->param1 = MAX_VOLUME - row->param1;
                     }
-            }
+                }
+        }
+        break;
+    case CHUNK_DEFAULT:
+        memcpy(&bank->palette, Sweetie16, sizeof Sweetie16);
+        memcpy(&bank->sfx.waveforms, Waveforms, sizeof Waveforms);
+        break;
+    default: break;
+    }
+
+    #undef LOAD_CHUNK
+}
+
+static void loadCode(tic_code* code, const tic_cart_index* index)
+{
+    const tic_cart_chunk* banks[TIC_BANKS] = {NULL};
+
+    for(const tic_cart_chunk *chunk = index->chunks, *end = chunk + index->count; chunk < end; chunk++)
+    {
+        switch(chunk->type)
+        {
+        case CHUNK_CODE_ZIP:
+            tic_tool_unzip(code->data, TIC_CODE_SIZE, index->buffer + chunk->offset, chunk->size);
             break;
-        case CHUNK_DEFAULT:
-            memcpy(&cart->banks[chunk.bank].palette, Sweetie16, sizeof Sweetie16);
-            memcpy(&cart->banks[chunk.bank].sfx.waveforms, Waveforms, sizeof Waveforms);
+        case CHUNK_CODE:
+            // the last chunk of a bank wins
+            banks[chunk->bank] = chunk;
             break;
         default: break;
         }
+    }
 
-        buffer += chunk.size;
+    if(*code->data)
+        return;
 
-        if(chunk.bank == 0 && (chunk.type == CHUNK_PALETTE || chunk.type == CHUNK_DEFAULT))
-            paletteExists = true;
+    // workaround to load code from banks,
+    // they are joined from the last one with a new line between
+    char* dst = code->data;
+    const char* limit = code->data + TIC_CODE_SIZE - 1;
+
+    for(s32 i = TIC_BANKS-1; i >= 0; i--)
+    {
+        const tic_cart_chunk* chunk = banks[i];
+
+        if(!chunk) continue;
+
+        const char* data = (const char*)index->buffer + chunk->offset;
+        const char* zero = memchr(data, 0, chunk->size);
+        s32 len = zero ? (s32)(zero - data) : chunk->size;
+
+        if(!len) continue;
+
+        if(dst > code->data && dst < limit)
+            *dst++ = '\n';
+
+        len = (s32)MIN(len, limit - dst);
+        memcpy(dst, data, len);
+        dst += len;
     }
 
-    #undef LOAD_CHUNK
+    *dst = '\0';
+}
 
-    // workaround to load code from banks
-    if(!*cart->code.data)
-        for(s32 i = TIC_BANKS-1; i >= 0; i--)
-        {
-            const char* data = code->banks[i].data;
+void tic_cart_load_index(tic_cartridge* cart, const tic_cart_index* index, u32 parts)
+{
+    for(s32 i = 0; i < TIC_BANKS; i++)
+        if(parts & (1 << i))
+            memset(&cart->banks[i], 0, sizeof(tic_bank));
 
-            if(*data)
-            {
-                if(*cart->code.data)
-                    strcat(cart->code.data, "\n");
+    if(parts & tic_cart_code)
+        memset(&cart->code, 0, sizeof cart->code);
+
+    if(parts & tic_cart_cover)
+        memset(&cart->cover, 0, sizeof cart->cover);
+
+    bool paletteExists = false;
+
+    for(const tic_cart_chunk *chunk = index->chunks, *end = chunk + index->count; chunk < end; chunk++)
+    {
+        const u8* data = index->buffer + chunk->offset;
 
-                strcat(cart->code.data, data);
+        switch(chunk->type)
+        {
+        case CHUNK_CODE:
+        case CHUNK_CODE_ZIP:
+            break;
+        case CHUNK_COVER:
+            if(parts & tic_cart_cover)
+            {
+                memcpy(cart->cover.data, data, MIN(sizeof cart->cover.data, chunk->size));
+                cart->cover.size = chunk->size;
             }
+            break;
+        default:
+            if(parts & (1 << chunk->bank))
+                loadBankChunk(&cart->banks[chunk->bank], chunk, data);
         }
 
-    free(code);
+        if(chunk->bank == 0 && (chunk->type == CHUNK_PALETTE || chunk->type == CHUNK_DEFAULT))
+            paletteExists = true;
+    }
+
+    if(parts & tic_cart_code)
+        loadCode(&cart->code, index);
 
     // workaround to support ancient carts without palette
     // load DB16 palette if it not exists
-    if(!paletteExists)
+    if(!paletteExists && (parts & tic_cart_bank0))
     {
         static const u8 DB16[] = {0x14, 0x0c, 0x1c, 0x44, 0x24, 0x34, 0x30, 0x34, 0x6d, 0x4e, 0x4a, 0x4e, 0x85, 0x4c, 0x30, 0x34, 0x65, 0x24, 0xd0, 0x46, 0x48, 0x75, 0x71, 0x61, 0x59, 0x7d, 0xce, 0xd2, 0x7d, 0x2c, 0x85, 0x95, 0xa1, 0x6d, 0xaa, 0x2c, 0xd2, 0xaa, 0x99, 0x6d, 0xc2, 0xca, 0xda, 0xd4, 0x5e, 0xde, 0xee, 0xd6};
         memcpy(cart->bank0.palette.scn.data, DB16, sizeof DB16);
     }
 }
 
+void tic_cart_load_parts(tic_cartridge* cart, const u8* buffer, s32 size, u32 parts)
+{
+    tic_cart_index index;
+
+    if(tic_cart_index_create(&index, buffer, size))
+    {
+        tic_cart_load_index(cart, &index, parts);
+        tic_cart_index_free(&index);
+    }
+}
+
+void tic_cart_load(tic_cartridge* cart, const u8* buffer, s32 size)
+{
+    tic_cart_load_parts(cart, buffer, size, tic_cart_all);
+}
+
+s32 tic_cart_chunk_size(const u8* header, bool* cover)
+{
+    Chunk chunk;
+    memcpy(&chunk, header, sizeof chunk);
+
+    *cover = chunk.type == CHUNK_COVER;
+
+    return chunk.size;
+}
 
 static s32 calcBufferSize(const void* buffer, s32 size)
 {
@@ -24,5 +24,47 @@
 
 #include "tic.h"
 
+// parts of the cart to load, the low bits select the banks
+typedef enum
+{
+    tic_cart_bank0  = 1 << 0,
+    tic_cart_banks  = (1 << TIC_BANKS) - 1,
+    tic_cart_code   = 1 << TIC_BANKS,
+    tic_cart_cover  = 1 << (TIC_BANKS + 1),
+    tic_cart_all    = tic_cart_banks | tic_cart_code | tic_cart_cover,
+} tic_cart_part;
+
+typedef struct
+{
+    u32 offset;
+    u16 size;
+    u8 type;
+    u8 bank;
+} tic_cart_chunk;
+
+// chunks of a cart file in the file order, built in one pass over the headers,
+// the buffer must outlive the index
+typedef struct
+{
+    const u8* buffer;
+    tic_cart_chunk* chunks;
+    s32 count;
+
+    // banks having any data chunk
+    u32 banks;
+} tic_cart_index;
+
+bool tic_cart_index_create(tic_cart_index* index, const u8* buffer, s32 size);
+void tic_cart_index_free(tic_cart_index* index);
+
+// zeroes and loads the selected parts only, the rest of the cart isn't touched
+void tic_cart_load_index(tic_cartridge* rom, const tic_cart_index* index, u32 parts);
+void tic_cart_load_parts(tic_cartridge* rom, const u8* buffer, s32 size, u32 parts);
+
 void tic_cart_load(tic_cartridge* rom, const u8* buffer, s32 size);
 s32  tic_cart_save(const tic_cartridge* rom, u8* buffer);
+
+// for readers which seek through the cart file instead of loading it,
+// returns the size of the chunk data following the header
+enum {TIC_CART_CHUNK_HEADER = 4};
+s32  tic_cart_chunk_size(const u8* header, bool* cover);
@@ -0,0 +1,244 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "core.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define BLIT_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#define BLIT_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined(__GNUC__) || defined(__clang__)
+#define BLIT_TARGET(name) __attribute__((target(name)))
+#else
+#define BLIT_TARGET(name)
+#endif
+
+// every kernel expands `size` bytes of 4bpp pixels (low nibble first) into
+// 2 * `size` palette colors
+
+static void expandScalar(u32* dst, const u8* src, s32 size, const u32* pal)
+{
+    for (const u8* end = src + size; src != end; src++)
+    {
+        *dst++ = pal[*src & 0xf];
+        *dst++ = pal[*src >> 4];
+    }
+}
+
+#if defined(BLIT_X86)
+
+// the palette is split into 4 byte planes, so a 16 entries lookup is
+// 4 byte shuffles and the colors are put back together by unpacking
+
+BLIT_TARGET("ssse3")
+static void expandSsse3(u32* dst, const u8* src, s32 size, const u32* pal)
+{
+    __m128i planes[4];
+    {
+        u8 bytes[4][TIC_PALETTE_SIZE];
+
+        for (s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+            for (s32 b = 0; b < 4; b++)
+                bytes[b][i] = ((const u8*)&pal[i])[b];
+
+        for (s32 b = 0; b < 4; b++)
+            planes[b] = _mm_loadu_si128((const __m128i*)bytes[b]);
+    }
+
+    const __m128i mask = _mm_set1_epi8(0xf);
+
+    for (; size >= 16; size -= 16, src += 16)
+    {
+        __m128i val = _mm_loadu_si128((const __m128i*)src);
+        __m128i lo = _mm_and_si128(val, mask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(val, 4), mask);
+        __m128i indices[] = {_mm_unpacklo_epi8(lo, hi), _mm_unpackhi_epi8(lo, hi)};
+
+        for (s32 i = 0; i < 2; i++, dst += 16)
+        {
+            __m128i b0 = _mm_shuffle_epi8(planes[0], indices[i]);
+            __m128i b1 = _mm_shuffle_epi8(planes[1], indices[i]);
+            __m128i b2 = _mm_shuffle_epi8(planes[2], indices[i]);
+            __m128i b3 = _mm_shuffle_epi8(planes[3], indices[i]);
+
+            __m128i b01lo = _mm_unpacklo_epi8(b0, b1), b01hi = _mm_unpackhi_epi8(b0, b1);
+            __m128i b23lo = _mm_unpacklo_epi8(b2, b3), b23hi = _mm_unpackhi_epi8(b2, b3);
+
+            _mm_storeu_si128((__m128i*)dst + 0, _mm_unpacklo_epi16(b01lo, b23lo));
+            _mm_storeu_si128((__m128i*)dst + 1, _mm_unpackhi_epi16(b01lo, b23lo));
+            _mm_storeu_si128((__m128i*)dst + 2, _mm_unpacklo_epi16(b01hi, b23hi));
+            _mm_storeu_si128((__m128i*)dst + 3, _mm_unpackhi_epi16(b01hi, b23hi));
+        }
+    }
+
+    expandScalar(dst, src, size, pal);
+}
+
+// same as SSSE3 with both lanes busy, the lanes hold pixels 0-15 and 16-31
+// and get reordered on store
+BLIT_TARGET("avx2")
+static void expandAvx2(u32* dst, const u8* src, s32 size, const u32* pal)
+{
+    __m256i planes[4];
+    {
+        u8 bytes[4][TIC_PALETTE_SIZE];
+
+        for (s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+            for (s32 b = 0; b < 4; b++)
+                bytes[b][i] = ((const u8*)&pal[i])[b];
+
+        for (s32 b = 0; b < 4; b++)
+            planes[b] = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)bytes[b]));
+    }
+
+    const __m128i mask = _mm_set1_epi8(0xf);
+
+    for (; size >= 16; size -= 16, src += 16, dst += 32)
+    {
+        __m128i val = _mm_loadu_si128((const __m128i*)src);
+        __m128i lo = _mm_and_si128(val, mask);
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(val, 4), mask);
+        __m256i indices = _mm256_inserti128_si256(_mm256_castsi128_si256(_mm_unpacklo_epi8(lo, hi)), _mm_unpackhi_epi8(lo, hi), 1);
+
+        __m256i b0 = _mm256_shuffle_epi8(planes[0], indices);
+        __m256i b1 = _mm256_shuffle_epi8(planes[1], indices);
+        __m256i b2 = _mm256_shuffle_epi8(planes[2], indices);
+        __m256i b3 = _mm256_shuffle_epi8(planes[3], indices);
+
+        __m256i b01lo = _mm256_unpacklo_epi8(b0, b1), b01hi = _mm256_unpackhi_epi8(b0, b1);
+        __m256i b23lo = _mm256_unpacklo_epi8(b2, b3), b23hi = _mm256_unpackhi_epi8(b2, b3);
+
+        __m256i p0 = _mm256_unpacklo_epi16(b01lo, b23lo);
+        __m256i p1 = _mm256_unpackhi_epi16(b01lo, b23lo);
+        __m256i p2 = _mm256_unpacklo_epi16(b01hi, b23hi);
+        __m256i p3 = _mm256_unpackhi_epi16(b01hi, b23hi);
+
+        _mm256_storeu_si256((__m256i*)dst + 0, _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256((__m256i*)dst + 1, _mm256_permute2x128_si256(p2, p3, 0x20));
+        _mm256_storeu_si256((__m256i*)dst + 2, _mm256_permute2x128_si256(p0, p1, 0x31));
+        _mm256_storeu_si256((__m256i*)dst + 3, _mm256_permute2x128_si256(p2, p3, 0x31));
+    }
+
+    expandScalar(dst, src, size, pal);
+}
+
+static bool cpuSupports(bool avx2)
+{
+#if defined(_MSC_VER) && !defined(__clang__)
+    s32 info[4];
+    __cpuid(info, 0);
+
+    if (avx2)
+    {
+        if (info[0] < 7) return false;
+
+        // the OS has to save the AVX state as well
+        __cpuid(info, 1);
+        if (!(info[2] & (1 << 27)) || (_xgetbv(0) & 6) != 6) return false;
+
+        __cpuidex(info, 7, 0);
+        return (info[1] & (1 << 5)) != 0;
+    }
+
+    __cpuid(info, 1);
+    return (info[2] & (1 << 9)) != 0;
+#else
+    __builtin_cpu_init();
+    return avx2 ? __builtin_cpu_supports("avx2") : __builtin_cpu_supports("ssse3");
+#endif
+}
+
+#elif defined(BLIT_NEON)
+
+// NEON stores 4 byte planes interleaved, so the colors don't need unpacking
+
+static void expandNeon(u32* dst, const u8* src, s32 size, const u32* pal)
+{
+    u8 bytes[4][TIC_PALETTE_SIZE];
+
+    for (s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+        for (s32 b = 0; b < 4; b++)
+            bytes[b][i] = ((const u8*)&pal[i])[b];
+
+    const uint8x16_t mask = vdupq_n_u8(0xf);
+
+#if defined(__aarch64__)
+    uint8x16_t planes[4];
+    for (s32 b = 0; b < 4; b++)
+        planes[b] = vld1q_u8(bytes[b]);
+#else
+    uint8x8x2_t planes[4];
+    for (s32 b = 0; b < 4; b++)
+        planes[b] = (uint8x8x2_t){{vld1_u8(bytes[b]), vld1_u8(bytes[b] + 8)}};
+#endif
+
+    for (; size >= 16; size -= 16, src += 16)
+    {
+        uint8x16_t val = vld1q_u8(src);
+        uint8x16x2_t indices = vzipq_u8(vandq_u8(val, mask), vshrq_n_u8(val, 4));
+
+        for (s32 i = 0; i < 2; i++, dst += 16)
+        {
+#if defined(__aarch64__)
+            uint8x16x4_t colors;
+            for (s32 b = 0; b < 4; b++)
+                colors.val[b] = vqtbl1q_u8(planes[b], indices.val[i]);
+
+            vst4q_u8((u8*)dst, colors);
+#else
+            uint8x8x4_t colors;
+            for (s32 b = 0; b < 4; b++)
+                colors.val[b] = vtbl2_u8(planes[b], vget_low_u8(indices.val[i]));
+
+            vst4_u8((u8*)dst, colors);
+
+            for (s32 b = 0; b < 4; b++)
+                colors.val[b] = vtbl2_u8(planes[b], vget_high_u8(indices.val[i]));
+
+            vst4_u8((u8*)(dst + 8), colors);
+#endif
+        }
+    }
+
+    expandScalar(dst, src, size, pal);
+}
+
+#endif
+
+tic_blit_expand tic_core_blit_expand()
+{
+#if defined(BLIT_X86)
+    if (cpuSupports(true)) return expandAvx2;
+    if (cpuSupports(false)) return expandSsse3;
+#elif defined(BLIT_NEON)
+    return expandNeon;
+#endif
+
+    return expandScalar;
+}
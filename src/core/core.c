@@ -42,20 +42,51 @@ STATIC_ASSERT(tic_vram, sizeof(tic_vram) == TIC_VRAM_SIZE);
 STATIC_ASSERT(tic_ram, sizeof(tic_ram) == TIC_RAM_SIZE);
 
 static inline u32* getOvrAddr(tic_mem* tic, s32 x, s32 y)
+{
+    tic_core* core = (tic_core*)tic;
+
+    return (u32*)((u8*)core->blit.ovr.pixels + y * core->blit.ovr.pitch) + x;
+}
+
+// OVR draws over the buffer the screen was blitted to, 'out' has 'pitch' bytes per row
+static void setOvrTarget(tic_core* core, u32* out, s32 pitch, bool border)
 {
     enum { Top = (TIC80_FULLHEIGHT - TIC80_HEIGHT) / 2 };
     enum { Left = (TIC80_FULLWIDTH - TIC80_WIDTH) / 2 };
 
-    return tic->screen + x + (y << TIC80_FULLWIDTH_BITS) + (Left + Top * TIC80_FULLWIDTH);
+    core->blit.ovr.pixels = border ? (u32*)((u8*)out + Top * pitch) + Left : out;
+    core->blit.ovr.pitch = pitch;
+}
+
+static inline void markOverlaid(tic_core* core, s32 y)
+{
+    enum { Top = (TIC80_FULLHEIGHT - TIC80_HEIGHT) / 2 };
+
+    core->blit.overlaid[y] = true;
+    core->blit.dirty[Top + y] = true;
 }
 
 static void setPixelOvr(tic_mem* tic, s32 x, s32 y, u8 color)
 {
     tic_core* core = (tic_core*)tic;
 
+    markOverlaid(core, y);
     *getOvrAddr(tic, x, y) = *(core->state.ovr.raw + color);
 }
 
+static void drawSpanOvr(tic_mem* tic, s32 x, s32 y, const u8* colors, s32 width)
+{
+    tic_core* core = (tic_core*)tic;
+    const u32* pal = core->state.ovr.raw;
+    u32* dst = getOvrAddr(tic, x, y);
+
+    markOverlaid(core, y);
+
+    for (s32 i = 0; i < width; i++)
+        if (colors[i] != TRANSPARENT_COLOR)
+            dst[i] = pal[colors[i]];
+}
+
 static u8 getPixelOvr(tic_mem* tic, s32 x, s32 y)
 {
     tic_core* core = (tic_core*)tic;
@@ -74,6 +105,7 @@ static void drawHLineOvr(tic_mem* tic, s32 x1, s32 x2, s32 y, u8 color)
 {
     tic_core* core = (tic_core*)tic;
     u32 final_color = *(core->state.ovr.raw + color);
+    markOverlaid(core, y);
     for (s32 x = x1; x < x2; ++x) {
         *getOvrAddr(tic, x, y) = final_color;
     }
@@ -190,6 +222,12 @@ void tic_api_sync(tic_mem* tic, u32 mask, s32 bank, bool toCart)
 
     assert(bank >= 0 && bank < TIC_BANKS);
 
+    if (mask && (core->lazy.pending & (1 << bank)))
+    {
+        tic_cart_load_index(&tic->cart, &core->lazy.index, 1 << bank);
+        core->lazy.pending &= ~(1 << bank);
+    }
+
     for (s32 i = 0; i < Count; i++)
         if(mask & (1 << i))
             sync((u8*)&tic->ram + Sections[i].ram, (u8*)&tic->cart.banks[bank] + Sections[i].bank, Sections[i].size, toCart);
@@ -229,6 +267,36 @@ static u8 getPixelDma(tic_mem* tic, s32 x, s32 y)
     return tic_tool_peek4(core->memory.ram.vram.screen.data, y * TIC80_WIDTH + x);
 }
 
+// writes the nibbles straight to VRAM, a byte at once where both pixels are opaque
+static void drawSpanDma(tic_mem* tic, s32 x, s32 y, const u8* colors, s32 width)
+{
+    u8* dst = tic->ram.vram.screen.data + ((y * TIC80_WIDTH + x) >> 1);
+    const u8* end = colors + width;
+
+    if (x & 1)
+    {
+        if (*colors != TRANSPARENT_COLOR)
+            *dst = (*dst & 0x0f) | (*colors << 4);
+
+        colors++, dst++;
+    }
+
+    for (; end - colors >= 2; colors += 2, dst++)
+    {
+        u8 lo = colors[0], hi = colors[1];
+
+        if (lo != TRANSPARENT_COLOR && hi != TRANSPARENT_COLOR)
+            *dst = lo | hi << 4;
+        else if (lo != TRANSPARENT_COLOR)
+            *dst = (*dst & 0xf0) | lo;
+        else if (hi != TRANSPARENT_COLOR)
+            *dst = (*dst & 0x0f) | hi << 4;
+    }
+
+    if (colors != end && *colors != TRANSPARENT_COLOR)
+        *dst = (*dst & 0xf0) | *colors;
+}
+
 static void drawHLineDma(tic_mem* memory, s32 xl, s32 xr, s32 y, u8 color)
 {
     color = color << 4 | color;
@@ -262,7 +330,7 @@ static const char* readMetatag(const char* code, const char* tag, const char* co
     const char* start = NULL;
 
     {
-        static char format[] = "%s %s:";
+        static const char format[] = "%s %s:";
 
         char* tagBuffer = malloc(strlen(format) + strlen(tag));
 
@@ -405,6 +473,7 @@ static void resetDma(tic_mem* memory)
     core->state.setpix = setPixelDma;
     core->state.getpix = getPixelDma;
     core->state.drawhline = drawHLineDma;
+    core->state.drawspan = drawSpanDma;
 }
 
 void tic_api_reset(tic_mem* memory)
@@ -468,6 +537,14 @@ static void cart2ram(tic_mem* memory)
     initCover(memory);
 }
 
+// the arena is taken when a cart is loaded or first run, so the savestate size is
+// fixed from then on, cores that never run code (music rendering) don't pay for it
+static void createHeap(tic_core* core)
+{
+    if (!core->heap)
+        core->heap = heap_create(TIC_SCRIPT_HEAP_SIZE);
+}
+
 void tic_core_tick(tic_mem* tic, tic_tick_data* data)
 {
     tic_core* core = (tic_core*)tic;
@@ -499,6 +576,8 @@ void tic_core_tick(tic_mem* tic, tic_tick_data* data)
 
             data->start = data->counter(core->data->data);
 
+            createHeap(core);
+
             done = config->init(tic, code);
         }
         else
@@ -528,7 +607,9 @@ void tic_core_tick(tic_mem* tic, tic_tick_data* data)
             ZEROMEM(tic->ram.input.mouse);
     }
 
+    u64 start = tic_core_perf_start(core);
     core->state.tick(tic);
+    tic_core_perf_phase(core, tic_perf_tic, start);
 }
 
 void tic_core_pause(tic_mem* memory)
@@ -560,11 +641,204 @@ void tic_core_resume(tic_mem* memory)
     }
 }
 
+// the snapshot extends what tic_core_pause() keeps with the VM heap, it can be
+// loaded back only into the same core within the same run
+#define TIC_STATE_MAGIC 0x53434954 // 'TICS'
+#define TIC_STATE_VERSION 3
+
+typedef struct
+{
+    u32 magic;
+    u32 version;
+    u32 size;
+    u32 heap;
+
+    const void* arena;
+
+    struct
+    {
+        void* lua;
+        void* js;
+        s32 luaRefs[3];
+    } vm;
+
+    u64 elapsed;
+    u8 input;
+
+    tic_core_state_data state;
+    tic_ram ram;
+
+    // followed by the used part of the VM heap
+} tic_core_snapshot;
+
+static bool isSnapshotSupported(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+
+    if (!core->heap)
+        return false;
+
+    const tic_script_config* config = tic_core_script_config(memory);
+
+#if defined(TIC_BUILD_WITH_WREN)
+    if (config == getWrenScriptConfig())
+        return false;
+#endif
+
+#if defined(TIC_BUILD_WITH_SQUIRREL)
+    if (config == getSquirrelScriptConfig())
+        return false;
+#endif
+
+    return config != NULL;
+}
+
+u32 tic_core_state_size(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+
+    return isSnapshotSupported(memory)
+        ? sizeof(tic_core_snapshot) + heap_capacity(core->heap)
+        : 0;
+}
+
+// the size the next tic_core_state_save() writes, only the used part of the heap
+u32 tic_core_state_length(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+
+    return isSnapshotSupported(memory)
+        ? sizeof(tic_core_snapshot) + heap_used(core->heap)
+        : 0;
+}
+
+u32 tic_core_state_save(tic_mem* memory, void* buffer, u32 size)
+{
+    tic_core* core = (tic_core*)memory;
+
+    if (!isSnapshotSupported(memory) || size < sizeof(tic_core_snapshot))
+        return 0;
+
+    tic_core_snapshot* snapshot = (tic_core_snapshot*)buffer;
+
+    snapshot->magic = TIC_STATE_MAGIC;
+    snapshot->version = TIC_STATE_VERSION;
+    snapshot->arena = heap_base(core->heap);
+    snapshot->vm.lua = NULL;
+    snapshot->vm.js = NULL;
+
+#if defined(TIC_BUILD_WITH_LUA) || defined(TIC_BUILD_WITH_MOON) || defined(TIC_BUILD_WITH_FENNEL)
+    snapshot->vm.lua = core->lua;
+    snapshot->vm.luaRefs[0] = core->luaRefs.scn;
+    snapshot->vm.luaRefs[1] = core->luaRefs.scanline;
+    snapshot->vm.luaRefs[2] = core->luaRefs.ovr;
+#endif
+
+#if defined(TIC_BUILD_WITH_JS)
+    snapshot->vm.js = core->js;
+#endif
+
+    snapshot->elapsed = core->data ? core->data->counter(core->data->data) - core->data->start : 0;
+    snapshot->input = memory->input.data;
+
+    memcpy(&snapshot->state, &core->state, sizeof(tic_core_state_data));
+    memcpy(&snapshot->ram, &memory->ram, sizeof(tic_ram));
+
+    snapshot->heap = heap_save(core->heap, snapshot + 1, size - sizeof(tic_core_snapshot));
+
+    if (!snapshot->heap)
+        return 0;
+
+    return snapshot->size = sizeof(tic_core_snapshot) + snapshot->heap;
+}
+
+bool tic_core_state_load(tic_mem* memory, const void* buffer, u32 size)
+{
+    tic_core* core = (tic_core*)memory;
+    const tic_core_snapshot* snapshot = (const tic_core_snapshot*)buffer;
+
+    if (size < sizeof(tic_core_snapshot)
+        || snapshot->magic != TIC_STATE_MAGIC
+        || snapshot->version != TIC_STATE_VERSION
+        || snapshot->size > size
+        || snapshot->size != sizeof(tic_core_snapshot) + snapshot->heap
+        || snapshot->arena != heap_base(core->heap))
+        return false;
+
+    if (!heap_load(core->heap, snapshot + 1, snapshot->heap))
+        return false;
+
+#if defined(TIC_BUILD_WITH_LUA) || defined(TIC_BUILD_WITH_MOON) || defined(TIC_BUILD_WITH_FENNEL)
+    core->lua = snapshot->vm.lua;
+    core->luaRefs.scn = snapshot->vm.luaRefs[0];
+    core->luaRefs.scanline = snapshot->vm.luaRefs[1];
+    core->luaRefs.ovr = snapshot->vm.luaRefs[2];
+#endif
+
+#if defined(TIC_BUILD_WITH_JS)
+    core->js = snapshot->vm.js;
+#endif
+
+    memcpy(&core->state, &snapshot->state, sizeof(tic_core_state_data));
+    memcpy(&memory->ram, &snapshot->ram, sizeof(tic_ram));
+    memory->input.data = snapshot->input;
+
+    tic_core_sound_state_reset(memory);
+
+    if (core->data)
+        core->data->start = core->data->counter(core->data->data) - snapshot->elapsed;
+
+    return true;
+}
+
+static void freeLazyCart(tic_core* core)
+{
+    tic_cart_index_free(&core->lazy.index);
+    free(core->lazy.data);
+    core->lazy.data = NULL;
+    core->lazy.pending = 0;
+}
+
+void tic_core_load_cart(tic_mem* memory, const void* buffer, s32 size)
+{
+    tic_core* core = (tic_core*)memory;
+
+    freeLazyCart(core);
+    createHeap(core);
+
+    core->lazy.data = malloc(size);
+
+    if (core->lazy.data)
+    {
+        memcpy(core->lazy.data, buffer, size);
+
+        if (tic_cart_index_create(&core->lazy.index, core->lazy.data, size))
+        {
+            // empty banks are only zeroed, the others wait for tic_api_sync
+            core->lazy.pending = core->lazy.index.banks & tic_cart_banks & ~tic_cart_bank0;
+            tic_cart_load_index(&memory->cart, &core->lazy.index, tic_cart_all & ~core->lazy.pending);
+
+            if (!core->lazy.pending)
+                freeLazyCart(core);
+
+            return;
+        }
+
+        freeLazyCart(core);
+    }
+
+    tic_cart_load(&memory->cart, buffer, size);
+}
+
 void tic_core_close(tic_mem* memory)
 {
     tic_core* core = (tic_core*)memory;
 
     core->state.initialized = false;
+    freeLazyCart(core);
+
+    tic_core_rewind_close(memory);
+    tic_core_perf_enable(memory, false);
 
 #if defined(TIC_BUILD_WITH_SQUIRREL)
     getSquirrelScriptConfig()->close(memory);
@@ -581,6 +855,10 @@ void tic_core_close(tic_mem* memory)
     getFennelConfig()->close(memory);
 #   endif
 
+#   if defined(TIC_BUILD_WITH_MOON) || defined(TIC_BUILD_WITH_FENNEL)
+    closeLuaCompilers(memory);
+#   endif
+
 #endif /* defined(TIC_BUILD_WITH_LUA) */
 
 
@@ -595,6 +873,8 @@ void tic_core_close(tic_mem* memory)
     blip_delete(core->blip.left);
     blip_delete(core->blip.right);
 
+    heap_delete(core->heap);
+
     free(memory->samples.buffer);
     free(core);
 }
@@ -617,11 +897,14 @@ void tic_core_tick_end(tic_mem* memory)
     core->state.gamepads.previous.data = input->gamepads.data;
     core->state.keyboard.previous.data = input->keyboard.data;
 
+    u64 start = tic_core_perf_start(core);
     tic_core_sound_tick_end(memory);
+    tic_core_perf_phase(core, tic_perf_sound, start);
 
     core->state.setpix = setPixelOvr;
     core->state.getpix = getPixelOvr;
     core->state.drawhline = drawHLineOvr;
+    core->state.drawspan = drawSpanOvr;
 }
 
 // copied from SDL2
@@ -654,63 +937,199 @@ static inline void memset4(void* dst, u32 val, u32 dwords)
 #endif
 }
 
-void tic_core_blit_ex(tic_mem* tic, tic80_pixel_color_format fmt, tic_scanline scanline, tic_overline overline, void* data)
+static inline void blitRow(tic_core* core, u32* dst, const u8* src, s32 from, s32 to, const u32* pal)
+{
+    if ((from & 1) && from < to)
+        *dst++ = pal[tic_tool_peek4(src, from++)];
+
+    s32 size = (to - from) >> 1;
+    core->blit.expand(dst, src + (from >> 1), size, pal);
+    dst += size << 1;
+    from += size << 1;
+
+    if (from < to)
+        *dst = pal[tic_tool_peek4(src, from)];
+}
+
+static void markDirty(tic_core* core, s32 from, s32 to)
+{
+    memset(core->blit.dirty + from, true, to - from);
+}
+
+// renders the frame to 'out' with 'pitch' bytes per row, the border is skipped unless 'border' is set,
+// a buffer other than tic->screen is converted completely, its previous content isn't known
+static void blitScreen(tic_mem* tic, tic80_pixel_color_format fmt, u32* out, s32 pitch, bool border,
+    tic_scanline scanline, tic_overline overline, void* data)
 {
+    tic_core* core = (tic_core*)tic;
+    u64 blitStart = tic_core_perf_start(core);
+    bool external = out != tic->screen;
+
     // init OVR palette
     {
-        tic_core* core = (tic_core*)tic;
-
         const tic_palette* ovr = &core->state.ovr.palette;
         bool ovrEmpty = true;
         for (s32 i = 0; i < sizeof(tic_palette); i++)
             if (ovr->data[i])
                 ovrEmpty = false;
 
-        memcpy(core->state.ovr.raw, tic_tool_palette_blit(ovrEmpty ? &tic->ram.vram.palette : ovr, fmt), sizeof core->state.ovr.raw);
+        tic_tool_palette_blit(core->state.ovr.raw, ovrEmpty ? &tic->ram.vram.palette : ovr, fmt);
     }
 
+    // the whole screen is converted when the format or the target changes
+    bool full = core->blit.fmt != fmt || external;
+    core->blit.fmt = fmt;
+
     if (scanline)
+    {
+        u64 start = tic_core_perf_start(core);
         scanline(tic, 0, data);
+        tic_core_perf_phase(core, tic_perf_scn, start);
+    }
 
-    const u32* pal = tic_tool_palette_blit(&tic->ram.vram.palette, fmt);
+    u32 pal[TIC_PALETTE_SIZE];
+    tic_tool_palette_blit(pal, &tic->ram.vram.palette, fmt);
 
     enum { Top = (TIC80_FULLHEIGHT - TIC80_HEIGHT) / 2, Bottom = Top };
     enum { Left = (TIC80_FULLWIDTH - TIC80_WIDTH) / 2, Right = Left };
 
-    u32* out = tic->screen;
+    if (full || core->blit.top != pal[tic->ram.vram.vars.border])
+    {
+        core->blit.top = pal[tic->ram.vram.vars.border];
 
-    memset4(&out[0 * TIC80_FULLWIDTH], pal[tic->ram.vram.vars.border], TIC80_FULLWIDTH * Top);
+        if (border)
+            for (s32 r = 0; r < Top; r++)
+                memset4((u8*)out + r * pitch, core->blit.top, TIC80_FULLWIDTH);
 
-    u32* rowPtr = out + (Top * TIC80_FULLWIDTH);
-    for (s32 r = 0; r < TIC80_HEIGHT; r++, rowPtr += TIC80_FULLWIDTH)
-    {
-        u32* colPtr = rowPtr + Left;
-        memset4(rowPtr, pal[tic->ram.vram.vars.border], Left);
+        markDirty(core, 0, Top);
+    }
 
-        s32 pos = (r + tic->ram.vram.vars.offset.y + TIC80_HEIGHT) % TIC80_HEIGHT * TIC80_WIDTH >> 1;
+    u32* rowPtr = border ? (u32*)((u8*)out + Top * pitch) + Left : out;
+    for (s32 r = 0; r < TIC80_HEIGHT; r++, rowPtr = (u32*)((u8*)rowPtr + pitch))
+    {
+        const u8* src = (u8*)tic->ram.vram.screen.data + ((r + tic->ram.vram.vars.offset.y + TIC80_HEIGHT) % TIC80_HEIGHT * TIC80_WIDTH >> 1);
 
-        u32 x = (-tic->ram.vram.vars.offset.x + TIC80_WIDTH) % TIC80_WIDTH;
-        for (s32 c = 0; c < TIC80_WIDTH / 2; c++)
+        // the row is converted only when anything it's made of has changed
         {
-            u8 val = ((u8*)tic->ram.vram.screen.data)[pos + c];
-            *(colPtr + (x++ % TIC80_WIDTH)) = pal[val & 0xf];
-            *(colPtr + (x++ % TIC80_WIDTH)) = pal[val >> 4];
-        }
+            tic_blit_row* row = &core->blit.rows[r];
 
-        memset4(rowPtr + (TIC80_FULLWIDTH - Right), pal[tic->ram.vram.vars.border], Right);
+            if (full || core->blit.overlaid[r]
+                || row->offset != tic->ram.vram.vars.offset.x
+                || row->border != tic->ram.vram.vars.border
+                || memcmp(row->screen, src, sizeof row->screen) != 0
+                || memcmp(&row->palette, &tic->ram.vram.palette, sizeof(tic_palette)) != 0)
+            {
+                memcpy(row->screen, src, sizeof row->screen);
+                memcpy(&row->palette, &tic->ram.vram.palette, sizeof(tic_palette));
+                row->offset = tic->ram.vram.vars.offset.x;
+                row->border = tic->ram.vram.vars.border;
+                core->blit.overlaid[r] = false;
+                core->blit.dirty[Top + r] = true;
+
+                if (border)
+                    memset4(rowPtr - Left, pal[tic->ram.vram.vars.border], Left);
+
+                // the row is split in two spans at the horizontal offset
+                s32 x = (-tic->ram.vram.vars.offset.x + TIC80_WIDTH) % TIC80_WIDTH;
+                blitRow(core, rowPtr + x, src, 0, TIC80_WIDTH - x, pal);
+
+                if (x)
+                    blitRow(core, rowPtr, src, TIC80_WIDTH - x, TIC80_WIDTH, pal);
+
+                if (border)
+                    memset4(rowPtr + TIC80_WIDTH, pal[tic->ram.vram.vars.border], Right);
+            }
+        }
 
         if (scanline && (r < TIC80_HEIGHT - 1))
         {
+            u64 start = tic_core_perf_start(core);
             scanline(tic, r + 1, data);
-            pal = tic_tool_palette_blit(&tic->ram.vram.palette, fmt);
+            tic_core_perf_phase(core, tic_perf_scn, start);
+
+            tic_tool_palette_blit(pal, &tic->ram.vram.palette, fmt);
         }
     }
 
-    memset4(&out[(TIC80_FULLHEIGHT - Bottom) * TIC80_FULLWIDTH], pal[tic->ram.vram.vars.border], TIC80_FULLWIDTH * Bottom);
+    if (full || core->blit.bottom != pal[tic->ram.vram.vars.border])
+    {
+        core->blit.bottom = pal[tic->ram.vram.vars.border];
+
+        if (border)
+            for (s32 r = TIC80_FULLHEIGHT - Bottom; r < TIC80_FULLHEIGHT; r++)
+                memset4((u8*)out + r * pitch, core->blit.bottom, TIC80_FULLWIDTH);
+
+        markDirty(core, TIC80_FULLHEIGHT - Bottom, TIC80_FULLHEIGHT);
+    }
+
+    // tic->screen missed this frame, the next blit to it converts everything
+    if (external)
+        core->blit.fmt = 0;
+
+    // blit time includes SCN, OVR is measured apart
+    tic_core_perf_phase(core, tic_perf_blit, blitStart);
 
     if (overline)
+    {
+        u64 start = tic_core_perf_start(core);
+
+        setOvrTarget(core, out, pitch, border);
         overline(tic, data);
+        setOvrTarget(core, tic->screen, TIC80_FULLWIDTH * sizeof(u32), true);
+
+        tic_core_perf_phase(core, tic_perf_ovr, start);
+    }
+}
+
+void tic_core_blit_ex(tic_mem* tic, tic80_pixel_color_format fmt, tic_scanline scanline, tic_overline overline, void* data)
+{
+    blitScreen(tic, fmt, tic->screen, TIC80_FULLWIDTH * sizeof(u32), true, scanline, overline, data);
+}
+
+s32 tic_core_dirty_rects(tic_mem* tic, tic_rect* rects, s32 count)
+{
+    tic_core* core = (tic_core*)tic;
+    s32 size = 0;
+
+    for (s32 r = 0; r < TIC80_FULLHEIGHT && size < count;)
+    {
+        if (!core->blit.dirty[r])
+        {
+            r++;
+            continue;
+        }
 
+        s32 start = r;
+        while (r < TIC80_FULLHEIGHT && core->blit.dirty[r])
+            core->blit.dirty[r++] = false;
+
+        rects[size++] = (tic_rect){0, start, TIC80_FULLWIDTH, r - start};
+    }
+
+    return size;
+}
+
+// rows of tic->screen drawn over outside of the core, they are converted again on the next blit
+void tic_core_invalidate_rows(tic_mem* tic, s32 y, s32 height)
+{
+    tic_core* core = (tic_core*)tic;
+
+    enum { Top = (TIC80_FULLHEIGHT - TIC80_HEIGHT) / 2, Bottom = Top };
+
+    s32 from = MAX(y, 0);
+    s32 to = MIN(y + height, TIC80_FULLHEIGHT);
+
+    if (from >= to)
+        return;
+
+    markDirty(core, from, to);
+
+    for (s32 r = MAX(from, Top); r < MIN(to, TIC80_FULLHEIGHT - Bottom); r++)
+        core->blit.overlaid[r - Top] = true;
+
+    // the border is only redrawn with everything else
+    if (from < Top || to > TIC80_FULLHEIGHT - Bottom)
+        core->blit.fmt = 0;
 }
 
 static inline void scanline(tic_mem* memory, s32 row, void* data)
@@ -731,7 +1150,20 @@ static inline void overline(tic_mem* memory, void* data)
 
 void tic_core_blit(tic_mem* tic, tic80_pixel_color_format fmt)
 {
-    tic_core_blit_ex(tic, fmt, scanline, overline, NULL);
+    tic_core* core = (tic_core*)tic;
+
+    tic_core_blit_ex(tic, fmt,
+        core->state.scanline ? scanline : NULL,
+        core->state.ovr.callback ? overline : NULL, NULL);
+}
+
+void tic_core_blit_to(tic_mem* tic, tic80_pixel_color_format fmt, void* pixels, s32 pitch, bool border)
+{
+    tic_core* core = (tic_core*)tic;
+
+    blitScreen(tic, fmt, pixels, pitch, border,
+        core->state.scanline ? scanline : NULL,
+        core->state.ovr.callback ? overline : NULL, NULL);
 }
 
 tic_mem* tic_core_create(s32 samplerate)
@@ -754,7 +1186,9 @@ tic_mem* tic_core_create(s32 samplerate)
     core->memory.screen = linearAlloc(TIC80_FULLWIDTH * (TIC80_FULLHEIGHT + 1) * sizeof(u32));
 #endif
     core->memory.samples.size = samplerate * TIC_STEREO_CHANNELS / TIC80_FRAMERATE * sizeof(s16);
-    core->memory.samples.buffer = malloc(core->memory.samples.size);
+
+    // a frame takes one more sample when the samplerate isn't a multiple of the framerate
+    core->memory.samples.buffer = malloc(core->memory.samples.size + TIC_STEREO_CHANNELS * sizeof(s16));
 
     core->blip.left = blip_new(samplerate / 10);
     core->blip.right = blip_new(samplerate / 10);
@@ -762,6 +1196,9 @@ tic_mem* tic_core_create(s32 samplerate)
     blip_set_rates(core->blip.left, CLOCKRATE, samplerate);
     blip_set_rates(core->blip.right, CLOCKRATE, samplerate);
 
+    core->blit.expand = tic_core_blit_expand();
+    setOvrTarget(core, core->memory.screen, TIC80_FULLWIDTH * sizeof(u32), true);
+
     tic_api_reset(&core->memory);
 
     return &core->memory;
@@ -23,11 +23,23 @@
 #pragma once
 
 #include "api.h"
+#include "cart.h"
 #include "tools.h"
 #include "blip_buf.h"
+#include "ext/heap.h"
 
 #define CLOCKRATE (255<<13)
 #define TIC_DEFAULT_COLOR tic_color_white
+#define TRANSPARENT_COLOR 255
+
+#if defined(_3DS) || defined(BAREMETALPI)
+#define TIC_SCRIPT_HEAP_SIZE 0
+#else
+#define TIC_SCRIPT_HEAP_SIZE (16 * 1024 * 1024) // 16M
+#endif
+
+// compiled MoonScript and Fennel sources kept in memory
+#define TIC_TRANSPILED_CACHE 4
 
 typedef struct
 {
@@ -143,6 +155,8 @@ typedef struct
     } music;
 
     tic_tick tick;
+
+    // the binding clears SCN/OVR callbacks the cart doesn't define
     tic_scanline scanline;
 
     struct
@@ -156,11 +170,34 @@ typedef struct
     u8 (*getpix)(tic_mem* memory, s32 x, s32 y);
     void (*drawhline)(tic_mem* memory, s32 xl, s32 xr, s32 y, u8 color);
 
+    // clipped row of sprite pixels, TRANSPARENT_COLOR ones are skipped
+    void (*drawspan)(tic_mem* memory, s32 x, s32 y, const u8* colors, s32 width);
+
     u32 synced;
 
     bool initialized;
 } tic_core_state_data;
 
+typedef struct tic_rewind tic_rewind;
+typedef struct tic_perf tic_perf;
+
+typedef void(*tic_blit_expand)(u32* dst, const u8* src, s32 size, const u32* pal);
+
+typedef struct
+{
+    u8 screen[TIC80_WIDTH / 2];
+    tic_palette palette;
+    s8 offset;
+    u8 border;
+} tic_blit_row;
+
+typedef struct
+{
+    u64 hash;
+    char* code;
+    s32 size;
+} tic_transpiled;
+
 typedef struct
 {
     tic_mem memory; // it should be first
@@ -169,14 +206,46 @@ typedef struct
     {
 #if defined(TIC_BUILD_WITH_LUA) || defined(TIC_BUILD_WITH_MOON) || defined(TIC_BUILD_WITH_FENNEL)
         struct lua_State* lua;
+
+        // registry refs of the SCN, legacy scanline and OVR functions
+        struct
+        {
+            s32 scn;
+            s32 scanline;
+            s32 ovr;
+        } luaRefs;
+#endif
+
+#if defined(TIC_BUILD_WITH_MOON) || defined(TIC_BUILD_WITH_FENNEL)
+        // compilers kept loaded between runs and the Lua they produced by the source hash
+        struct
+        {
+            struct lua_State* moon;
+            struct lua_State* fennel;
+
+            tic_transpiled items[TIC_TRANSPILED_CACHE];
+
+            s32 next;
+        } transpiled;
 #endif
 
 #if defined(TIC_BUILD_WITH_JS)
         struct duk_hthread* js;
+        u64 jsTimeoutCounter;
 #endif
 
 #if defined(TIC_BUILD_WITH_WREN)
         struct WrenVM* wren;
+
+        struct
+        {
+            struct WrenHandle* game;
+            struct WrenHandle* init;
+            struct WrenHandle* update;
+            struct WrenHandle* scanline;
+            struct WrenHandle* overline;
+            bool loaded;
+        } wrenHandles;
 #endif  
 
 #if defined(TIC_BUILD_WITH_SQUIRREL)
@@ -185,10 +254,31 @@ typedef struct
 
     };
 
+    // Lua and JS VMs allocate here to be saved with the core state
+    Heap* heap;
+
+    tic_rewind* rewind;
+
+    // profiler, NULL unless enabled
+    tic_perf* perf;
+
+    // copy of the cart file loaded by tic_core_load_cart,
+    // the banks besides the first one are read from it on the first sync
+    struct
+    {
+        u8* data;
+        tic_cart_index index;
+        u32 pending;
+    } lazy;
+
     struct
     {
         blip_buffer_t* left;
         blip_buffer_t* right;
+
+        // set from sound tick start to tick end, the registers are half
+        // written then and tic_core_sound_render() must not touch them
+        bool frame;
     } blip;
     
     s32 samplerate;
@@ -197,6 +287,41 @@ typedef struct
 
     tic_core_state_data state;
 
+    // sources of the blitted rows, rows which didn't change aren't converted again
+    struct
+    {
+        tic_blit_row rows[TIC80_HEIGHT];
+
+        u32 top;
+        u32 bottom;
+        tic80_pixel_color_format fmt;
+
+        // 4bpp to colors kernel picked for the CPU
+        tic_blit_expand expand;
+
+        // rows the OVR layer was drawn over since the last blit
+        bool overlaid[TIC80_HEIGHT];
+
+        // top left pixel of the OVR layer in the buffer blitted to last
+        struct
+        {
+            u32* pixels;
+            s32 pitch;
+        } ovr;
+
+        // screen rows changed since the frontend asked last time
+        bool dirty[TIC80_FULLHEIGHT];
+    } blit;
+
+    // filled shapes edges, scratch for circ/tri/textri
+    struct
+    {
+        s16 left[TIC80_HEIGHT];
+        s16 right[TIC80_HEIGHT];
+        s32 uleft[TIC80_HEIGHT];
+        s32 vleft[TIC80_HEIGHT];
+    } sides;
+
     struct
     {
         tic_core_state_data state;   
@@ -227,6 +352,10 @@ const tic_script_config* getMoonScriptConfig();
 const tic_script_config* getFennelConfig();
 #   endif
 
+#   if defined(TIC_BUILD_WITH_MOON) || defined(TIC_BUILD_WITH_FENNEL)
+void closeLuaCompilers(tic_mem* memory);
+#   endif
+
 #endif /* defined(TIC_BUILD_WITH_LUA) */
 
 #if defined(TIC_BUILD_WITH_JS)
@@ -240,3 +369,8 @@ const tic_script_config* getWrenScriptConfig();
 void tic_core_tick_io(tic_mem* memory);
 void tic_core_sound_tick_start(tic_mem* memory);
 void tic_core_sound_tick_end(tic_mem* memory);
+tic_blit_expand tic_core_blit_expand();
+u64 tic_core_perf_start(tic_core* core);
+void tic_core_perf_phase(tic_core* core, tic_perf_phase phase, u64 start);
+void tic_core_perf_api(tic_core* core, tic_api_id id, u64 start);
+void tic_core_sound_state_reset(tic_mem* memory);
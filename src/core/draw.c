@@ -27,8 +27,6 @@
 #include <string.h>
 #include <stdlib.h>
 
-#define TRANSPARENT_COLOR 255
-
 static tic_tilesheet getTileSheetFromSegment(tic_mem* memory, u8 segment)
 {
     u8* src;
@@ -43,9 +41,8 @@ static tic_tilesheet getTileSheetFromSegment(tic_mem* memory, u8 segment)
     return tic_tilesheet_get(segment, src);
 }
 
-static u8* getPalette(tic_mem* tic, u8* colors, u8 count)
+static u8* getPalette(tic_mem* tic, u8* colors, u8 count, u8* mapping)
 {
-    static u8 mapping[TIC_PALETTE_SIZE];
     for (s32 i = 0; i < TIC_PALETTE_SIZE; i++) mapping[i] = tic_tool_peek4(tic->ram.vram.mapping, i);
     for (s32 i = 0; i < count; i++) mapping[colors[i]] = TRANSPARENT_COLOR;
     return mapping;
@@ -114,24 +111,64 @@ static void drawRectBorder(tic_core* core, s32 x, s32 y, s32 width, s32 height,
     drawVLine(core, x + width - 1, y, height, color);
 }
 
-#define DRAW_TILE_BODY(X, Y) do {\
-    for(s32 py=sy; py < ey; py++, y++) \
+// rows of a tile are 8 * bpp bits long and byte aligned in every segment,
+// so a row is unpacked from a single word instead of peeking each pixel
+#define UNPACK_TILE(BPP) do { \
+    for (s32 py = 0; py < TIC_SPRITESIZE; py++) \
     { \
-        s32 xx = x; \
-        for(s32 px=sx; px < ex; px++, xx++) \
-        { \
-            u8 color = mapping[tic_tilesheet_gettilepix(tile, (X), (Y))];\
-            if(color != TRANSPARENT_COLOR) core->state.setpix(&core->memory, xx, y, color); \
-        } \
+        const u8* src = tile->ptr + (tile->offset + py * segment->tile_width) * (BPP) / BITS_IN_BYTE; \
+        u32 bits = 0; \
+        for (s32 i = 0; i < (BPP); i++) bits |= (u32)src[i] << (i * BITS_IN_BYTE); \
+        for (s32 px = 0; px < TIC_SPRITESIZE; px++, bits >>= (BPP)) \
+            *pixels++ = bits & ((1 << (BPP)) - 1); \
     } \
     } while(0)
 
+static void unpackTile(const tic_tileptr* tile, u8* pixels)
+{
+    const tic_blit_segment* segment = tile->segment;
+
+    switch (segment->ptr_size / segment->tile_width)
+    {
+    case 4: UNPACK_TILE(4); break;
+    case 2: UNPACK_TILE(2); break;
+    default: UNPACK_TILE(1); break;
+    }
+}
+
+#undef UNPACK_TILE
+
+#define ORIENT_TILE(X, Y) do { \
+    for (s32 py = 0; py < TIC_SPRITESIZE; py++) \
+        for (s32 px = 0; px < TIC_SPRITESIZE; px++) \
+            *dst++ = mapping[pixels[(Y) * TIC_SPRITESIZE + (X)]]; \
+    } while(0)
+
 #define REVERT(X) (TIC_SPRITESIZE - 1 - (X))
 
-static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, u8* colors, s32 count, s32 scale, tic_flip flip, tic_rotate rotate)
-{
-    u8* mapping = getPalette(&core->memory, colors, count);
+// unpacks the tile, applies flip/rotate and the palette mapping, every orientation has its own loop
+static void orientTile(const tic_tileptr* tile, u32 orientation, const u8* mapping, u8* dst)
+{
+    u8 pixels[TIC_SPRITESIZE * TIC_SPRITESIZE];
+    unpackTile(tile, pixels);
+
+    switch (orientation) {
+    case 0b100: ORIENT_TILE(py, px); break;
+    case 0b110: ORIENT_TILE(REVERT(py), px); break;
+    case 0b101: ORIENT_TILE(py, REVERT(px)); break;
+    case 0b111: ORIENT_TILE(REVERT(py), REVERT(px)); break;
+    case 0b000: ORIENT_TILE(px, py); break;
+    case 0b010: ORIENT_TILE(px, REVERT(py)); break;
+    case 0b001: ORIENT_TILE(REVERT(px), py); break;
+    case 0b011: ORIENT_TILE(REVERT(px), REVERT(py)); break;
+    }
+}
+
+#undef ORIENT_TILE
+#undef REVERT
 
+static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, const u8* mapping, s32 scale, tic_flip flip, tic_rotate rotate)
+{
     rotate &= 0b11;
     u32 orientation = flip & 0b11;
 
@@ -147,48 +184,52 @@ static void drawTile(tic_core* core, tic_tileptr* tile, s32 x, s32 y, u8* colors
         sy = core->state.clip.t - y; if (sy < 0) sy = 0;
         ex = core->state.clip.r - x; if (ex > TIC_SPRITESIZE) ex = TIC_SPRITESIZE;
         ey = core->state.clip.b - y; if (ey > TIC_SPRITESIZE) ey = TIC_SPRITESIZE;
-        y += sy;
-        x += sx;
-        switch (orientation) {
-        case 0b100: DRAW_TILE_BODY(py, px); break;
-        case 0b110: DRAW_TILE_BODY(REVERT(py), px); break;
-        case 0b101: DRAW_TILE_BODY(py, REVERT(px)); break;
-        case 0b111: DRAW_TILE_BODY(REVERT(py), REVERT(px)); break;
-        case 0b000: DRAW_TILE_BODY(px, py); break;
-        case 0b010: DRAW_TILE_BODY(px, REVERT(py)); break;
-        case 0b001: DRAW_TILE_BODY(REVERT(px), py); break;
-        case 0b011: DRAW_TILE_BODY(REVERT(px), REVERT(py)); break;
-        }
+
+        if (sx >= ex || sy >= ey) return;
+
+        u8 tilePixels[TIC_SPRITESIZE * TIC_SPRITESIZE];
+        orientTile(tile, orientation, mapping, tilePixels);
+
+        for (s32 py = sy; py < ey; py++)
+            core->state.drawspan(&core->memory, x + sx, y + py, tilePixels + py * TIC_SPRITESIZE + sx, ex - sx);
+
         return;
     }
 
-    if (EARLY_CLIP(x, y, TIC_SPRITESIZE * scale, TIC_SPRITESIZE * scale)) return;
+    if (scale < 1) return;
+
+    s32 size = TIC_SPRITESIZE * scale;
+    s32 sx = MAX(core->state.clip.l - x, 0), ex = MIN(core->state.clip.r - x, size);
+    s32 sy = MAX(core->state.clip.t - y, 0), ey = MIN(core->state.clip.b - y, size);
+
+    if (sx >= ex || sy >= ey) return;
+
+    u8 tilePixels[TIC_SPRITESIZE * TIC_SPRITESIZE];
+    orientTile(tile, orientation, mapping, tilePixels);
 
-    for (s32 py = 0; py < TIC_SPRITESIZE; py++, y += scale)
+    // a scaled row is built once and drawn for all the screen rows it covers
+    u8 row[TIC80_WIDTH];
+    for (s32 py = sy; py < ey;)
     {
-        s32 xx = x;
-        for (s32 px = 0; px < TIC_SPRITESIZE; px++, xx += scale)
-        {
-            s32 ix = orientation & 0b001 ? TIC_SPRITESIZE - px - 1 : px;
-            s32 iy = orientation & 0b010 ? TIC_SPRITESIZE - py - 1 : py;
-            if (orientation & 0b100) {
-                s32 tmp = ix; ix = iy; iy = tmp;
-            }
-            u8 color = mapping[tic_tilesheet_gettilepix(tile, ix, iy)];
-            if (color != TRANSPARENT_COLOR) drawRect(core, xx, y, scale, scale, color);
-        }
+        const u8* src = tilePixels + py / scale * TIC_SPRITESIZE;
+
+        for (s32 px = sx; px < ex; px++)
+            row[px - sx] = src[px / scale];
+
+        for (s32 next = MIN((py / scale + 1) * scale, ey); py < next; py++)
+            core->state.drawspan(&core->memory, x + sx, y + py, row, ex - sx);
     }
 }
 
-#undef DRAW_TILE_BODY
-#undef REVERT
-
 static void drawSprite(tic_core* core, s32 index, s32 x, s32 y, s32 w, s32 h, u8* colors, s32 count, s32 scale, tic_flip flip, tic_rotate rotate)
 {
     tic_tilesheet sheet = getTileSheetFromSegment(&core->memory, core->memory.ram.vram.blit.segment);
+    u8 buffer[TIC_PALETTE_SIZE];
+    u8* mapping = getPalette(&core->memory, colors, count, buffer);
+
     if (w == 1 && h == 1) {
         tic_tileptr tile = tic_tilesheet_gettile(&sheet, index, false);
-        drawTile(core, &tile, x, y, colors, count, scale, flip, rotate);
+        drawTile(core, &tile, x, y, mapping, scale, flip, rotate);
     }
     else
     {
@@ -230,9 +271,9 @@ static void drawSprite(tic_core* core, s32 index, s32 x, s32 y, s32 w, s32 h, u8
 
                 tic_tileptr tile = tic_tilesheet_gettile(&sheet, index + mx + my * cols, false);
                 if (rotate == 0 || rotate == 2)
-                    drawTile(core, &tile, x + i * step, y + j * step, colors, count, scale, flip, rotate);
+                    drawTile(core, &tile, x + i * step, y + j * step, mapping, scale, flip, rotate);
                 else
-                    drawTile(core, &tile, x + j * step, y + i * step, colors, count, scale, flip, rotate);
+                    drawTile(core, &tile, x + j * step, y + i * step, mapping, scale, flip, rotate);
             }
         }
     }
@@ -243,6 +284,8 @@ static void drawMap(tic_core* core, const tic_map* src, s32 x, s32 y, s32 width,
     const s32 size = TIC_SPRITESIZE * scale;
 
     tic_tilesheet sheet = getTileSheetFromSegment(&core->memory, core->memory.ram.vram.blit.segment);
+    u8 buffer[TIC_PALETTE_SIZE];
+    u8* mapping = getPalette(&core->memory, colors, count, buffer);
 
     for (s32 j = y, jj = sy; j < y + height; j++, jj += size)
         for (s32 i = x, ii = sx; i < x + width; i++, ii += size)
@@ -258,11 +301,16 @@ static void drawMap(tic_core* core, const tic_map* src, s32 x, s32 y, s32 width,
             s32 index = mi + mj * TIC_MAP_WIDTH;
             RemapResult retile = { *(src->data + index), tic_no_flip, tic_no_rotate };
 
+            // the callback may poke the palette map, so the mapping is taken
+            // again after it, the same as when it was built for every tile
             if (remap)
+            {
                 remap(data, mi, mj, &retile);
+                mapping = getPalette(&core->memory, colors, count, buffer);
+            }
 
             tic_tileptr tile = tic_tilesheet_gettile(&sheet, retile.index, true);
-            drawTile(core, &tile, ii, jj, colors, count, scale, retile.flip, retile.rotate);
+            drawTile(core, &tile, ii, jj, mapping, scale, retile.flip, retile.rotate);
         }
 }
 
@@ -369,7 +417,8 @@ void tic_api_cls(tic_mem* memory, u8 color)
 
 s32 tic_api_font(tic_mem* memory, const char* text, s32 x, s32 y, u8 chromakey, s32 w, s32 h, bool fixed, s32 scale, bool alt)
 {
-    u8* mapping = getPalette(memory, &chromakey, 1);
+    u8 buffer[TIC_PALETTE_SIZE];
+    u8* mapping = getPalette(memory, &chromakey, 1, buffer);
 
     // Compatibility : flip top and bottom of the spritesheet
     // to preserve tic_api_font's default target
@@ -397,24 +446,28 @@ void tic_api_spr(tic_mem* memory, s32 index, s32 x, s32 y, s32 w, s32 h, u8* col
 
 static inline u8* getFlag(tic_mem* memory, s32 index, u8 flag)
 {
-    static u8 stub = 0;
-    if (index >= TIC_FLAGS || flag >= BITS_IN_BYTE)
-        return &stub;
+    if (index < 0 || index >= TIC_FLAGS || flag >= BITS_IN_BYTE)
+        return NULL;
 
     return memory->ram.flags.data + index;
 }
 
 bool tic_api_fget(tic_mem* memory, s32 index, u8 flag)
 {
-    return *getFlag(memory, index, flag) & (1 << flag);
+    u8* flags = getFlag(memory, index, flag);
+    return flags && (*flags & (1 << flag));
 }
 
 void tic_api_fset(tic_mem* memory, s32 index, u8 flag, bool value)
 {
+    u8* flags = getFlag(memory, index, flag);
+
+    if (!flags) return;
+
     if (value)
-        *getFlag(memory, index, flag) |= (1 << flag);
+        *flags |= (1 << flag);
     else
-        *getFlag(memory, index, flag) &= ~(1 << flag);
+        *flags &= ~(1 << flag);
 }
 
 u8 tic_api_pix(tic_mem* memory, s32 x, s32 y, u8 color, bool get)
@@ -434,43 +487,35 @@ void tic_api_rectb(tic_mem* memory, s32 x, s32 y, s32 width, s32 height, u8 colo
     drawRectBorder(core, x, y, width, height, mapColor(memory, color));
 }
 
-static struct
-{
-    s16 Left[TIC80_HEIGHT];
-    s16 Right[TIC80_HEIGHT];
-    s32 ULeft[TIC80_HEIGHT];
-    s32 VLeft[TIC80_HEIGHT];
-} SidesBuffer;
-
-static void initSidesBuffer()
+static void initSidesBuffer(tic_core* core)
 {
-    for (s32 i = 0; i < COUNT_OF(SidesBuffer.Left); i++)
-        SidesBuffer.Left[i] = TIC80_WIDTH, SidesBuffer.Right[i] = -1;
+    for (s32 i = 0; i < COUNT_OF(core->sides.left); i++)
+        core->sides.left[i] = TIC80_WIDTH, core->sides.right[i] = -1;
 }
 
-static void setSidePixel(s32 x, s32 y)
+static void setSidePixel(tic_core* core, s32 x, s32 y)
 {
     if (y >= 0 && y < TIC80_HEIGHT)
     {
-        if (x < SidesBuffer.Left[y]) SidesBuffer.Left[y] = x;
-        if (x > SidesBuffer.Right[y]) SidesBuffer.Right[y] = x;
+        if (x < core->sides.left[y]) core->sides.left[y] = x;
+        if (x > core->sides.right[y]) core->sides.right[y] = x;
     }
 }
 
-static void setSideTexPixel(s32 x, s32 y, float u, float v)
+static void setSideTexPixel(tic_core* core, s32 x, s32 y, float u, float v)
 {
     s32 yy = y;
     if (yy >= 0 && yy < TIC80_HEIGHT)
     {
-        if (x < SidesBuffer.Left[yy])
+        if (x < core->sides.left[yy])
         {
-            SidesBuffer.Left[yy] = x;
-            SidesBuffer.ULeft[yy] = (s32)(u * 65536.0f);
-            SidesBuffer.VLeft[yy] = (s32)(v * 65536.0f);
+            core->sides.left[yy] = x;
+            core->sides.uleft[yy] = (s32)(u * 65536.0f);
+            core->sides.vleft[yy] = (s32)(v * 65536.0f);
         }
-        if (x > SidesBuffer.Right[yy])
+        if (x > core->sides.right[yy])
         {
-            SidesBuffer.Right[yy] = x;
+            core->sides.right[yy] = x;
         }
     }
 }
@@ -479,16 +524,16 @@ void tic_api_circ(tic_mem* memory, s32 xm, s32 ym, s32 radius, u8 color)
 {
     tic_core* core = (tic_core*)memory;
 
-    initSidesBuffer();
+    initSidesBuffer(core);
 
     s32 r = radius;
     s32 x = -r, y = 0, err = 2 - 2 * r;
     do
     {
-        setSidePixel(xm - x, ym + y);
-        setSidePixel(xm - y, ym - x);
-        setSidePixel(xm + x, ym - y);
-        setSidePixel(xm + y, ym + x);
+        setSidePixel(core, xm - x, ym + y);
+        setSidePixel(core, xm - y, ym - x);
+        setSidePixel(core, xm + x, ym - y);
+        setSidePixel(core, xm + y, ym + x);
 
         r = err;
         if (r <= y) err += ++y * 2 + 1;
@@ -499,8 +544,8 @@ void tic_api_circ(tic_mem* memory, s32 xm, s32 ym, s32 radius, u8 color)
     s32 yb = MIN(core->state.clip.b, ym + radius + 1);
     u8 final_color = mapColor(&core->memory, color);
     for (s32 y = yt; y < yb; y++) {
-        s32 xl = MAX(SidesBuffer.Left[y], core->state.clip.l);
-        s32 xr = MIN(SidesBuffer.Right[y] + 1, core->state.clip.r);
+        s32 xl = MAX(core->sides.left[y], core->state.clip.l);
+        s32 xr = MIN(core->sides.right[y] + 1, core->state.clip.r);
         core->state.drawhline(&core->memory, xl, xr, y, final_color);
     }
 }
@@ -547,14 +592,14 @@ static void ticLine(tic_mem* memory, s32 x0, s32 y0, s32 x1, s32 y1, u8 color, l
 
 static void triPixelFunc(tic_mem* memory, s32 x, s32 y, u8 color)
 {
-    setSidePixel(x, y);
+    setSidePixel((tic_core*)memory, x, y);
 }
 
 void tic_api_tri(tic_mem* memory, s32 x1, s32 y1, s32 x2, s32 y2, s32 x3, s32 y3, u8 color)
 {
     tic_core* core = (tic_core*)memory;
 
-    initSidesBuffer();
+    initSidesBuffer(core);
 
     ticLine(memory, x1, y1, x2, y2, color, triPixelFunc);
     ticLine(memory, x2, y2, x3, y3, color, triPixelFunc);
@@ -565,8 +610,8 @@ void tic_api_tri(tic_mem* memory, s32 x1, s32 y1, s32 x2, s32 y2, s32 x3, s32 y3
     s32 yb = MIN(core->state.clip.b, MAX(y1, MAX(y2, y3)) + 1);
 
     for (s32 y = yt; y < yb; y++) {
-        s32 xl = MAX(SidesBuffer.Left[y], core->state.clip.l);
-        s32 xr = MIN(SidesBuffer.Right[y] + 1, core->state.clip.r);
+        s32 xl = MAX(core->sides.left[y], core->state.clip.l);
+        s32 xr = MIN(core->sides.right[y] + 1, core->state.clip.r);
         core->state.drawhline(&core->memory, xl, xr, y, final_color);
     }
 }
@@ -623,7 +668,7 @@ static void ticTexLine(tic_mem* memory, TexVert* v0, TexVert* v1)
 
     for (; y < botY; ++y)
     {
-        setSideTexPixel((s32)x, (s32)y, u, v);
+        setSideTexPixel((tic_core*)memory, (s32)x, (s32)y, u, v);
         x += step_x;
         u += step_u;
         v += step_v;
@@ -633,7 +678,8 @@ static void ticTexLine(tic_mem* memory, TexVert* v0, TexVert* v1)
 static void drawTexturedTriangle(tic_core* core, float x1, float y1, float x2, float y2, float x3, float y3, float u1, float v1, float u2, float v2, float u3, float v3, bool use_map, u8* colors, s32 count)
 {
     tic_mem* memory = &core->memory;
-    u8* mapping = getPalette(memory, colors, count);
+    u8 buffer[TIC_PALETTE_SIZE];
+    u8* mapping = getPalette(memory, colors, count, buffer);
     TexVert V0, V1, V2;
 
     const u8* map = memory->ram.map.data;
@@ -659,7 +705,7 @@ static void drawTexturedTriangle(tic_core* core, float x1, float y1, float x2, f
     s32 dudxs = (s32)(dudx * 65536.0f);
     s32 dvdxs = (s32)(dvdx * 65536.0f);
     //  fill the buffer 
-    initSidesBuffer();
+    initSidesBuffer(core);
     //  parse each line and decide where in the buffer to store them ( left or right ) 
     ticTexLine(memory, &V0, &V1);
     ticTexLine(memory, &V1, &V2);
@@ -668,23 +714,23 @@ static void drawTexturedTriangle(tic_core* core, float x1, float y1, float x2, f
     for (s32 y = 0; y < TIC80_HEIGHT; y++)
     {
         //  if it's backwards skip it
-        s32 width = SidesBuffer.Right[y] - SidesBuffer.Left[y];
+        s32 width = core->sides.right[y] - core->sides.left[y];
         //  if it's off top or bottom , skip this line
         if ((y < core->state.clip.t) || (y > core->state.clip.b))
             width = 0;
         if (width > 0)
         {
-            s32 u = SidesBuffer.ULeft[y];
-            s32 v = SidesBuffer.VLeft[y];
-            s32 left = SidesBuffer.Left[y];
-            s32 right = SidesBuffer.Right[y];
+            s32 u = core->sides.uleft[y];
+            s32 v = core->sides.vleft[y];
+            s32 left = core->sides.left[y];
+            s32 right = core->sides.right[y];
             //  check right edge, and CLAMP it
             if (right > core->state.clip.r)
                 right = core->state.clip.r;
             //  check left edge and offset UV's if we are off the left 
             if (left < core->state.clip.l)
             {
-                s32 dist = core->state.clip.l - SidesBuffer.Left[y];
+                s32 dist = core->state.clip.l - core->sides.left[y];
                 u += dudxs * dist;
                 v += dvdxs * dist;
                 left = core->state.clip.l;
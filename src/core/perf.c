@@ -0,0 +1,222 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "api.h"
+#include "core.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+// the latest events are kept for the trace
+#define TRACE_EVENTS (1 << 16)
+
+typedef struct
+{
+    u64 start;
+    u64 duration;
+    u16 id;
+    bool api;
+} Event;
+
+struct tic_perf
+{
+    tic_perf_stats stats;
+    u64 origin;
+
+    struct
+    {
+        Event* items;
+        u32 next;
+        u32 count;
+    } events;
+};
+
+static const char* const PhaseNames[] = {"TIC", "SCN", "OVR", "sound", "blit"};
+STATIC_ASSERT(perf_phase_names, COUNT_OF(PhaseNames) == tic_perf_phases_count);
+
+#define API_NAME_DEF(name, ...) #name,
+static const char* const ApiNames[] = {TIC_API_LIST(API_NAME_DEF)};
+#undef API_NAME_DEF
+
+static u64 now()
+{
+#if defined(_WIN32)
+    LARGE_INTEGER counter, freq;
+    QueryPerformanceCounter(&counter);
+    QueryPerformanceFrequency(&freq);
+    return (u64)(counter.QuadPart * (1e9 / freq.QuadPart));
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (u64)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+#else
+    return (u64)clock() * (1000000000ull / CLOCKS_PER_SEC);
+#endif
+}
+
+static void addEvent(tic_perf* perf, bool api, s32 id, u64 start, u64 duration)
+{
+    Event* event = &perf->events.items[perf->events.next];
+    *event = (Event){start, duration, id, api};
+
+    perf->events.next = (perf->events.next + 1) % TRACE_EVENTS;
+
+    if (perf->events.count < TRACE_EVENTS)
+        perf->events.count++;
+}
+
+u64 tic_core_perf_start(tic_core* core)
+{
+    return core->perf ? now() : 0;
+}
+
+void tic_core_perf_phase(tic_core* core, tic_perf_phase phase, u64 start)
+{
+    tic_perf* perf = core->perf;
+
+    if (!perf || !start) return;
+
+    u64 duration = now() - start;
+    tic_perf_counter* counter = &perf->stats.phases[phase];
+
+    counter->calls++;
+    counter->ns += duration;
+
+    if (phase == tic_perf_tic)
+        perf->stats.frames++;
+
+    addEvent(perf, false, phase, start, duration);
+}
+
+void tic_core_perf_api(tic_core* core, tic_api_id id, u64 start)
+{
+    tic_perf* perf = core->perf;
+
+    if (!perf || !start) return;
+
+    u64 duration = now() - start;
+    tic_perf_counter* counter = &perf->stats.api[id];
+
+    counter->calls++;
+    counter->ns += duration;
+
+    addEvent(perf, true, id, start, duration);
+}
+
+void tic_core_perf_enable(tic_mem* memory, bool enable)
+{
+    tic_core* core = (tic_core*)memory;
+
+    if (enable && !core->perf)
+    {
+        tic_perf* perf = calloc(1, sizeof(tic_perf));
+
+        if (perf && (perf->events.items = malloc(TRACE_EVENTS * sizeof(Event))))
+        {
+            perf->origin = now();
+            core->perf = perf;
+        }
+        else free(perf);
+    }
+    else if (!enable && core->perf)
+    {
+        free(core->perf->events.items);
+        free(core->perf);
+        core->perf = NULL;
+    }
+}
+
+void tic_core_perf_reset(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+    tic_perf* perf = core->perf;
+
+    if (perf)
+    {
+        memset(&perf->stats, 0, sizeof perf->stats);
+        perf->events.next = perf->events.count = 0;
+        perf->origin = now();
+    }
+}
+
+const tic_perf_stats* tic_core_perf_stats(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+
+    return core->perf ? &core->perf->stats : NULL;
+}
+
+const char* tic_core_perf_phase_name(tic_perf_phase phase)
+{
+    return PhaseNames[phase];
+}
+
+const char* tic_core_perf_api_name(tic_api_id id)
+{
+    return ApiNames[id];
+}
+
+// Chrome trace event format, open it in chrome://tracing or Perfetto
+char* tic_core_perf_trace(tic_mem* memory, s32* size)
+{
+    tic_core* core = (tic_core*)memory;
+    tic_perf* perf = core->perf;
+
+    if (!perf) return NULL;
+
+    enum { EventSize = 128 };
+    static const char Header[] = "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+    static const char Footer[] = "\n]}\n";
+
+    s32 capacity = sizeof Header + perf->events.count * EventSize + sizeof Footer;
+    char* json = malloc(capacity);
+
+    if (!json) return NULL;
+
+    char* ptr = json;
+    ptr += sprintf(ptr, "%s", Header);
+
+    u32 first = (perf->events.next + TRACE_EVENTS - perf->events.count) % TRACE_EVENTS;
+
+    for (u32 i = 0; i < perf->events.count; i++)
+    {
+        const Event* event = &perf->events.items[(first + i) % TRACE_EVENTS];
+
+        ptr += snprintf(ptr, EventSize, "%s\n{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":1}",
+            i ? "," : "",
+            event->api ? ApiNames[event->id] : PhaseNames[event->id],
+            event->api ? "api" : "phase",
+            (event->start - perf->origin) / 1000.0,
+            event->duration / 1000.0);
+    }
+
+    ptr += sprintf(ptr, "%s", Footer);
+    *size = (s32)(ptr - json);
+
+    return json;
+}
@@ -0,0 +1,430 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "api.h"
+#include "core.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+// Rewind keeps every frame as a sparse XOR delta against its keyframe.
+// Only the newest keyframe is stored in full, each older keyframe is kept as
+// a delta against the next one, so going one frame back costs a single delta
+// apply, plus one more when crossing a keyframe.
+
+#define KEYFRAME_INTERVAL TIC80_FRAMERATE
+
+// equal bytes shorter than this don't break a run
+#define RUN_GAP 8
+
+typedef struct
+{
+    u8* data;
+    u32 size;
+    u32 length;
+    bool key;
+} Frame;
+
+typedef struct
+{
+    u8* data;
+    u32 length;
+    u32 extent;
+} Snapshot;
+
+struct tic_rewind
+{
+    struct
+    {
+        Frame* items;
+        u32 capacity;
+        u32 first;
+        u32 count;
+    } frames;
+
+    // used counts the frames and the buffers below against the limit
+    u32 limit;
+    u32 used;
+    u32 lastKey;
+
+    // the key and work buffers grow with the snapshot, the VM heap is
+    // rarely used up to its capacity
+    u32 size;
+    Snapshot key;
+    Snapshot work;
+
+    struct
+    {
+        u8* data;
+        u32 size;
+    } temp;
+};
+
+static inline Frame* getFrame(tic_rewind* rewind, u32 index)
+{
+    return &rewind->frames.items[(rewind->frames.first + index) % rewind->frames.capacity];
+}
+
+static bool addFrame(tic_rewind* rewind, const Frame* frame)
+{
+    if(rewind->frames.count == rewind->frames.capacity)
+    {
+        u32 capacity = rewind->frames.capacity ? rewind->frames.capacity * 2 : KEYFRAME_INTERVAL * 2;
+        Frame* items = malloc(capacity * sizeof(Frame));
+
+        if(!items) return false;
+
+        for(u32 i = 0; i < rewind->frames.count; i++)
+            items[i] = *getFrame(rewind, i);
+
+        free(rewind->frames.items);
+
+        rewind->frames.items = items;
+        rewind->frames.capacity = capacity;
+        rewind->frames.first = 0;
+    }
+
+    *getFrame(rewind, rewind->frames.count++) = *frame;
+    rewind->used += sizeof(Frame) + frame->size;
+
+    return true;
+}
+
+static void freeFrame(tic_rewind* rewind, Frame* frame)
+{
+    rewind->used -= frame->size;
+    free(frame->data);
+    frame->data = NULL;
+    frame->size = 0;
+}
+
+// keeps the bytes after the snapshot zeroed, so two snapshots can be
+// XORed up to the longest of them
+static void setLength(Snapshot* snapshot, u32 length)
+{
+    if(snapshot->extent > length)
+        memset(snapshot->data + length, 0, snapshot->extent - length);
+
+    snapshot->length = length;
+    snapshot->extent = length;
+}
+
+static bool reserveTemp(tic_rewind* rewind, u32 size)
+{
+    if(size > rewind->temp.size)
+    {
+        u32 capacity = MAX(size, rewind->temp.size * 2);
+        u8* data = realloc(rewind->temp.data, capacity);
+
+        if(!data) return false;
+
+        rewind->used += capacity - rewind->temp.size;
+        rewind->temp.data = data;
+        rewind->temp.size = capacity;
+    }
+
+    return true;
+}
+
+static bool growSnapshot(Snapshot* snapshot, u32 size, u32 capacity)
+{
+    u8* data = realloc(snapshot->data, capacity);
+
+    if(!data) return false;
+
+    memset(data + size, 0, capacity - size);
+    snapshot->data = data;
+
+    return true;
+}
+
+static bool reserveSnapshots(tic_rewind* rewind, u32 length, u32 max)
+{
+    if(length > rewind->size)
+    {
+        u32 capacity = MIN(MAX(length, rewind->size + rewind->size / 2), max);
+
+        if(!growSnapshot(&rewind->key, rewind->size, capacity)
+            || !growSnapshot(&rewind->work, rewind->size, capacity))
+            return false;
+
+        rewind->used += (capacity - rewind->size) * 2;
+        rewind->size = capacity;
+    }
+
+    return true;
+}
+
+// encodes a ^ b as a list of [offset][size][bytes] runs
+static bool encodeDelta(tic_rewind* rewind, const Snapshot* a, const Snapshot* b, Frame* frame)
+{
+    const u8* pa = a->data;
+    const u8* pb = b->data;
+    u32 length = MAX(a->length, b->length);
+    u32 size = 0;
+
+    for(u32 pos = 0; pos < length;)
+    {
+        while(pos + sizeof(u64) <= length && memcmp(pa + pos, pb + pos, sizeof(u64)) == 0)
+            pos += sizeof(u64);
+
+        while(pos < length && pa[pos] == pb[pos])
+            pos++;
+
+        if(pos == length) break;
+
+        u32 start = pos, end = pos;
+
+        for(u32 gap = 0; pos < length && gap < RUN_GAP; pos++)
+        {
+            if(pa[pos] != pb[pos])
+            {
+                end = pos + 1;
+                gap = 0;
+            }
+            else gap++;
+        }
+
+        u32 run = end - start;
+
+        if(!reserveTemp(rewind, size + sizeof(u32) * 2 + run))
+            return false;
+
+        u8* out = rewind->temp.data + size;
+        memcpy(out, &start, sizeof(u32));
+        memcpy(out + sizeof(u32), &run, sizeof(u32));
+        out += sizeof(u32) * 2;
+
+        for(u32 i = start; i < end; i++)
+            *out++ = pa[i] ^ pb[i];
+
+        size += sizeof(u32) * 2 + run;
+    }
+
+    frame->data = NULL;
+    frame->size = size;
+
+    if(size)
+    {
+        if(!(frame->data = malloc(size)))
+            return false;
+
+        memcpy(frame->data, rewind->temp.data, size);
+    }
+
+    return true;
+}
+
+static void applyDelta(Snapshot* snapshot, const Frame* frame)
+{
+    const u8* ptr = frame->data;
+    const u8* end = ptr + frame->size;
+
+    while(ptr < end)
+    {
+        u32 start, run;
+        memcpy(&start, ptr, sizeof(u32));
+        memcpy(&run, ptr + sizeof(u32), sizeof(u32));
+        ptr += sizeof(u32) * 2;
+
+        u8* dst = snapshot->data + start;
+        for(u32 i = 0; i < run; i++)
+            *dst++ ^= *ptr++;
+
+        snapshot->extent = MAX(snapshot->extent, start + run);
+    }
+}
+
+static void clearFrames(tic_rewind* rewind)
+{
+    for(u32 i = 0; i < rewind->frames.count; i++)
+        freeFrame(rewind, getFrame(rewind, i));
+
+    rewind->used -= rewind->frames.count * sizeof(Frame);
+    rewind->frames.first = 0;
+    rewind->frames.count = 0;
+    rewind->lastKey = 0;
+}
+
+// drops the oldest keyframes with their deltas, the newest one always stays
+static void trimFrames(tic_rewind* rewind)
+{
+    while(rewind->used > rewind->limit && rewind->lastKey > 0)
+    {
+        do
+        {
+            freeFrame(rewind, getFrame(rewind, 0));
+            rewind->used -= sizeof(Frame);
+
+            rewind->frames.first = (rewind->frames.first + 1) % rewind->frames.capacity;
+            rewind->frames.count--;
+            rewind->lastKey--;
+        }
+        while(!getFrame(rewind, 0)->key);
+    }
+}
+
+static void deleteRewind(tic_rewind* rewind)
+{
+    clearFrames(rewind);
+
+    free(rewind->frames.items);
+    free(rewind->key.data);
+    free(rewind->work.data);
+    free(rewind->temp.data);
+    free(rewind);
+}
+
+void tic_core_rewind_init(tic_mem* memory, u32 limit)
+{
+    tic_core* core = (tic_core*)memory;
+
+    if(core->rewind)
+    {
+        deleteRewind(core->rewind);
+        core->rewind = NULL;
+    }
+
+    // the buffers are taken on the first push, the cart may not be loaded yet
+    if(limit && (core->rewind = calloc(1, sizeof(tic_rewind))))
+        core->rewind->limit = limit;
+}
+
+void tic_core_rewind_reset(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+
+    if(core->rewind)
+        clearFrames(core->rewind);
+}
+
+void tic_core_rewind_close(tic_mem* memory)
+{
+    tic_core_rewind_init(memory, 0);
+}
+
+bool tic_core_rewind_push(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+    tic_rewind* rewind = core->rewind;
+
+    if(!rewind) return false;
+
+    u32 length = tic_core_state_length(memory);
+
+    if(!length || !reserveSnapshots(rewind, length, tic_core_state_size(memory)))
+        return false;
+
+    length = tic_core_state_save(memory, rewind->work.data, rewind->size);
+
+    if(!length) return false;
+
+    rewind->work.extent = MAX(rewind->work.extent, length);
+    setLength(&rewind->work, length);
+
+    u32 count = rewind->frames.count;
+    Frame frame = {NULL, 0, length, false};
+
+    if(count == 0 || count - rewind->lastKey >= KEYFRAME_INTERVAL)
+    {
+        // previous keyframe turns into a delta against the new one
+        if(count)
+        {
+            Frame* prev = getFrame(rewind, rewind->lastKey);
+
+            if(!encodeDelta(rewind, &rewind->key, &rewind->work, prev))
+            {
+                clearFrames(rewind);
+                return false;
+            }
+
+            rewind->used += prev->size;
+        }
+
+        SWAP(rewind->key, rewind->work, Snapshot);
+
+        frame.key = true;
+        rewind->lastKey = count;
+    }
+    else if(!encodeDelta(rewind, &rewind->work, &rewind->key, &frame))
+        return false;
+
+    if(!addFrame(rewind, &frame))
+    {
+        free(frame.data);
+        clearFrames(rewind);
+        return false;
+    }
+
+    trimFrames(rewind);
+
+    return true;
+}
+
+bool tic_core_rewind_step(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+    tic_rewind* rewind = core->rewind;
+
+    if(!rewind || rewind->frames.count < 2) return false;
+
+    Frame* top = getFrame(rewind, rewind->frames.count - 1);
+
+    if(top->key)
+    {
+        // the previous keyframe becomes the decoded one
+        u32 index = rewind->frames.count - 2;
+        while(!getFrame(rewind, index)->key) index--;
+
+        Frame* prev = getFrame(rewind, index);
+        applyDelta(&rewind->key, prev);
+        setLength(&rewind->key, prev->length);
+        freeFrame(rewind, prev);
+
+        rewind->lastKey = index;
+    }
+
+    freeFrame(rewind, top);
+    rewind->used -= sizeof(Frame);
+    rewind->frames.count--;
+
+    top = getFrame(rewind, rewind->frames.count - 1);
+
+    if(top->key)
+        return tic_core_state_load(memory, rewind->key.data, top->length);
+
+    u32 length = MAX(rewind->key.length, top->length);
+
+    memcpy(rewind->work.data, rewind->key.data, length);
+    rewind->work.extent = MAX(rewind->work.extent, length);
+    applyDelta(&rewind->work, top);
+    setLength(&rewind->work, top->length);
+
+    return tic_core_state_load(memory, rewind->work.data, top->length);
+}
+
+u32 tic_core_rewind_frames(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+
+    return core->rewind ? core->rewind->frames.count : 0;
+}
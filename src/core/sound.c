@@ -480,9 +480,8 @@ void tic_api_sfx(tic_mem* memory, s32 index, s32 note, s32 octave, s32 duration,
     setSfxChannelData(memory, index, note, octave, duration, channel, left, right, speed);
 }
 
-static void stereo_tick_end(tic_mem* memory, tic_sound_register_data* registers, blip_buffer_t* blip, u8 stereoRight)
+static void stereo_synth(tic_mem* memory, tic_sound_register_data* registers, blip_buffer_t* blip, u8 stereoRight, s32 endTime)
 {
-    enum { EndTime = CLOCKRATE / TIC80_FRAMERATE };
     for (s32 i = 0; i < TIC_SOUND_CHANNELS; ++i)
     {
         u8 volume = tic_tool_peek4(&memory->ram.stereo.data, stereoRight + i * 2);
@@ -491,19 +490,35 @@ static void stereo_tick_end(tic_mem* memory, tic_sound_register_data* registers,
         tic_sound_register_data* data = registers + i;
 
         tic_tool_is_noise(&reg->waveform)
-            ? runNoise(blip, reg, data, EndTime, volume)
-            : runEnvelope(blip, reg, data, EndTime, volume);
+            ? runNoise(blip, reg, data, endTime, volume)
+            : runEnvelope(blip, reg, data, endTime, volume);
 
-        data->time -= EndTime;
+        data->time -= endTime;
     }
 
-    blip_end_frame(blip, EndTime);
+    blip_end_frame(blip, endTime);
+}
+
+static void synth(tic_mem* memory, s32 clocks)
+{
+    tic_core* core = (tic_core*)memory;
+
+    stereo_synth(memory, core->state.registers.left, core->blip.left, 0, clocks);
+    stereo_synth(memory, core->state.registers.right, core->blip.right, 1, clocks);
+}
+
+static s32 readSamples(tic_core* core, s16* buffer, s32 count)
+{
+    blip_read_samples(core->blip.left, buffer, count, TIC_STEREO_CHANNELS);
+    return blip_read_samples(core->blip.right, buffer + 1, count, TIC_STEREO_CHANNELS);
 }
 
 void tic_core_sound_tick_start(tic_mem* memory)
 {
     tic_core* core = (tic_core*)memory;
 
+    core->blip.frame = true;
+
     for (s32 i = 0; i < TIC_SOUND_CHANNELS; ++i)
         memset(&memory->ram.registers[i], 0, sizeof(tic_sound_register));
 
@@ -521,12 +536,85 @@ void tic_core_sound_tick_start(tic_mem* memory)
 }
 
 void tic_core_sound_tick_end(tic_mem* memory)
+{
+    tic_core* core = (tic_core*)memory;
+    enum { EndTime = CLOCKRATE / TIC80_FRAMERATE };
+
+    synth(memory, EndTime);
+
+    // the frame length in samples isn't whole at most rates, blip keeps the
+    // fraction, so it's 367 or 368 samples at 22050Hz and never drifts
+    s32 count = readSamples(core, memory->samples.buffer, blip_samples_avail(core->blip.left));
+    memory->samples.size = count * TIC_STEREO_CHANNELS * sizeof(s16);
+
+    core->blip.frame = false;
+}
+
+// continues the sound of the last frame for any number of samples between
+// ticks, the registers and the clock remainder carry on into the next frame,
+// so frontends can cover device underruns without a click, returns the number
+// of samples written or 0 when called in the middle of a frame
+s32 tic_core_sound_render(tic_mem* memory, s16* buffer, s32 count)
+{
+    tic_core* core = (tic_core*)memory;
+
+    if (core->blip.frame)
+        return 0;
+
+    // buffers are created with blip_new(samplerate / 10)
+    count = CLAMP(count, 0, core->samplerate / 10 - blip_samples_avail(core->blip.left));
+
+    if (count == 0)
+        return 0;
+
+    synth(memory, blip_clocks_needed(core->blip.left, count));
+    return readSamples(core, buffer, count);
+}
+
+// renders the track on a private core, so the caller's RAM stays untouched
+// and several tracks can be rendered in parallel
+s32 tic_core_render_music(const tic_music_render* params)
+{
+    tic_mem* memory = tic_core_create(params->samplerate);
+
+    if (!memory)
+        return -1;
+
+    memcpy(&memory->ram.sfx, params->sfx, sizeof(tic_sfx));
+    memcpy(&memory->ram.music, params->music, sizeof(tic_music));
+
+    tic_api_music(memory, params->track, -1, -1, false, params->sustain);
+
+    s32 frame = 0;
+    for (; memory->ram.sound_state.flag.music_state == tic_music_play
+        && (params->frames <= 0 || frame < params->frames); frame++)
+    {
+        tic_core_sound_tick_start(memory);
+
+        for (s32 i = 0; i < TIC_SOUND_CHANNELS; i++)
+            if (params->mute & (1 << i))
+                memory->ram.registers[i].volume = 0;
+
+        tic_core_sound_tick_end(memory);
+
+        params->write(memory->samples.buffer, memory->samples.size / sizeof(s16), params->data);
+    }
+
+    tic_core_close(memory);
+
+    return frame;
+}
+
+// blip_buf keeps its state private, so the synth isn't part of the snapshot,
+// it restarts from silence and the restored registers ramp it up again on the
+// next frame, the same way a freshly started sound does
+void tic_core_sound_state_reset(tic_mem* memory)
 {
     tic_core* core = (tic_core*)memory;
 
-    stereo_tick_end(memory, core->state.registers.left, core->blip.left, 0);
-    stereo_tick_end(memory, core->state.registers.right, core->blip.right, 1);
+    blip_clear(core->blip.left);
+    blip_clear(core->blip.right);
 
-    blip_read_samples(core->blip.left, core->memory.samples.buffer, core->samplerate / TIC80_FRAMERATE, TIC_STEREO_CHANNELS);
-    blip_read_samples(core->blip.right, core->memory.samples.buffer + 1, core->samplerate / TIC80_FRAMERATE, TIC_STEREO_CHANNELS);
+    for (s32 i = 0; i < TIC_SOUND_CHANNELS; i++)
+        core->state.registers.left[i].amp = core->state.registers.right[i].amp = 0;
 }
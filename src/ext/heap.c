@@ -0,0 +1,366 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "heap.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define HEAP_ALIGN 16
+#define ALIGN_UP(x) (((x) + HEAP_ALIGN - 1) & ~(HEAP_ALIGN - 1))
+
+// blocks up to LinearLimit are rounded up to HEAP_ALIGN,
+// bigger ones get 4 classes per power of two
+enum
+{
+    LinearLimit = 256,
+    LinearClasses = LinearLimit / HEAP_ALIGN,
+    Classes = LinearClasses + 4 * 20,
+};
+
+typedef struct
+{
+    u32 cls;
+    u8 padding[HEAP_ALIGN - sizeof(u32)];
+} Header;
+
+typedef struct Chunk Chunk;
+
+struct Chunk
+{
+    Chunk* next;
+};
+
+// lives at the start of the arena and is saved with it
+typedef struct
+{
+    u32 top;
+    Chunk* free[Classes];
+} Arena;
+
+typedef struct Foreign Foreign;
+
+struct Foreign
+{
+    Foreign* next;
+    Foreign* prev;
+    size_t size;
+};
+
+enum {ForeignSize = ALIGN_UP(sizeof(Foreign))};
+
+struct Heap
+{
+    void* memory;
+    u8* base;
+    u32 size;
+    Foreign* foreign;
+};
+
+static inline Arena* getArena(const Heap* heap)
+{
+    return (Arena*)heap->base;
+}
+
+static inline bool inArena(const Heap* heap, const void* ptr)
+{
+    return (const u8*)ptr >= heap->base && (const u8*)ptr < heap->base + heap->size;
+}
+
+static u32 classSize(u32 cls)
+{
+    if(cls < LinearClasses)
+        return (cls + 1) * HEAP_ALIGN;
+
+    cls -= LinearClasses;
+
+    return (LinearLimit << (cls >> 2)) / 4 * (4 + (cls & 3));
+}
+
+static u32 sizeClass(size_t size)
+{
+    if(size <= LinearLimit)
+        return (u32)(size + HEAP_ALIGN - 1) / HEAP_ALIGN - 1;
+
+    u32 log = 0;
+    while(((size_t)LinearLimit << (log + 1)) < size) log++;
+
+    size_t base = (size_t)LinearLimit << log;
+    size_t step = base / 4;
+
+    return LinearClasses + log * 4 + (u32)((size - base + step - 1) / step);
+}
+
+static void pushFree(Arena* arena, u8* ptr, u32 cls)
+{
+    Chunk* chunk = (Chunk*)ptr;
+    chunk->next = arena->free[cls];
+    arena->free[cls] = chunk;
+}
+
+// splits the tail of a chunk into the biggest classes that fit
+static void releaseTail(Arena* arena, u8* ptr, u32 size)
+{
+    while(size)
+    {
+        u32 cls = sizeClass(size);
+
+        if(classSize(cls) > size)
+            cls--;
+
+        pushFree(arena, ptr, cls);
+
+        ptr += classSize(cls);
+        size -= classSize(cls);
+    }
+}
+
+static Header* allocChunk(Heap* heap, u32 cls)
+{
+    Arena* arena = getArena(heap);
+    u32 size = classSize(cls);
+
+    if(arena->free[cls])
+    {
+        Chunk* chunk = arena->free[cls];
+        arena->free[cls] = chunk->next;
+        return (Header*)chunk;
+    }
+
+    if(arena->top + size <= heap->size)
+    {
+        Header* header = (Header*)(heap->base + arena->top);
+        arena->top += size;
+        return header;
+    }
+
+    for(u32 i = cls + 1; i < Classes; i++)
+    {
+        if(arena->free[i])
+        {
+            Chunk* chunk = arena->free[i];
+            arena->free[i] = chunk->next;
+
+            releaseTail(arena, (u8*)chunk + size, classSize(i) - size);
+            return (Header*)chunk;
+        }
+    }
+
+    return NULL;
+}
+
+static void* allocForeign(Heap* heap, size_t size)
+{
+    Foreign* foreign = malloc(ForeignSize + size);
+
+    if(foreign)
+    {
+        foreign->size = size;
+        foreign->prev = NULL;
+        foreign->next = heap->foreign;
+
+        if(heap->foreign)
+            heap->foreign->prev = foreign;
+
+        heap->foreign = foreign;
+
+        return (u8*)foreign + ForeignSize;
+    }
+
+    return NULL;
+}
+
+static void freeForeign(Heap* heap, void* ptr)
+{
+    Foreign* foreign = (Foreign*)((u8*)ptr - ForeignSize);
+
+    if(foreign->prev)
+        foreign->prev->next = foreign->next;
+    else heap->foreign = foreign->next;
+
+    if(foreign->next)
+        foreign->next->prev = foreign->prev;
+
+    free(foreign);
+}
+
+static void* heapAlloc(Heap* heap, size_t size)
+{
+    u32 cls = sizeClass(size + sizeof(Header));
+
+    if(cls < Classes)
+    {
+        Header* header = allocChunk(heap, cls);
+
+        if(header)
+        {
+            header->cls = cls;
+            return header + 1;
+        }
+    }
+
+    return allocForeign(heap, size);
+}
+
+static void heapFree(Heap* heap, void* ptr)
+{
+    if(inArena(heap, ptr))
+    {
+        Header* header = (Header*)ptr - 1;
+        pushFree(getArena(heap), (u8*)header, header->cls);
+    }
+    else freeForeign(heap, ptr);
+}
+
+static size_t blockSize(const Heap* heap, const void* ptr)
+{
+    return inArena(heap, ptr)
+        ? classSize(((const Header*)ptr - 1)->cls) - sizeof(Header)
+        : ((const Foreign*)((const u8*)ptr - ForeignSize))->size;
+}
+
+Heap* heap_create(u32 size)
+{
+    size &= ~(HEAP_ALIGN - 1);
+
+    if(size < ALIGN_UP(sizeof(Arena)))
+        return NULL;
+
+    Heap* heap = (Heap*)malloc(sizeof(Heap));
+
+    if(heap)
+    {
+        heap->memory = malloc(size + HEAP_ALIGN);
+
+        if(!heap->memory)
+        {
+            free(heap);
+            return NULL;
+        }
+
+        heap->base = (u8*)ALIGN_UP((uintptr_t)heap->memory);
+        heap->size = size;
+        heap->foreign = NULL;
+
+        Arena* arena = getArena(heap);
+        memset(arena, 0, sizeof(Arena));
+        arena->top = ALIGN_UP(sizeof(Arena));
+    }
+
+    return heap;
+}
+
+void heap_delete(Heap* heap)
+{
+    if(heap)
+    {
+        while(heap->foreign)
+            freeForeign(heap, (u8*)heap->foreign + ForeignSize);
+
+        free(heap->memory);
+        free(heap);
+    }
+}
+
+void* heap_realloc(Heap* heap, void* ptr, size_t size)
+{
+    if(!heap)
+    {
+        if(size)
+            return realloc(ptr, size);
+
+        free(ptr);
+        return NULL;
+    }
+
+    if(!size)
+    {
+        if(ptr)
+            heapFree(heap, ptr);
+
+        return NULL;
+    }
+
+    if(!ptr)
+        return heapAlloc(heap, size);
+
+    size_t capacity = blockSize(heap, ptr);
+
+    // keep the block if it's not going to waste more than half of it
+    if(size <= capacity && size > capacity / 2)
+        return ptr;
+
+    void* block = heapAlloc(heap, size);
+
+    if(block)
+    {
+        memcpy(block, ptr, size < capacity ? size : capacity);
+        heapFree(heap, ptr);
+    }
+
+    return block;
+}
+
+u32 heap_capacity(const Heap* heap)
+{
+    return heap ? heap->size : 0;
+}
+
+// the size heap_save() writes
+u32 heap_used(const Heap* heap)
+{
+    return heap ? getArena(heap)->top : 0;
+}
+
+const void* heap_base(const Heap* heap)
+{
+    return heap ? heap->base : NULL;
+}
+
+u32 heap_save(const Heap* heap, void* buffer, u32 size)
+{
+    if(!heap || heap->foreign)
+        return 0;
+
+    u32 used = getArena(heap)->top;
+
+    if(used > size)
+        return 0;
+
+    memcpy(buffer, heap->base, used);
+
+    return used;
+}
+
+bool heap_load(Heap* heap, const void* buffer, u32 size)
+{
+    if(!heap || size < sizeof(Arena) || size > heap->size)
+        return false;
+
+    // the restored arena doesn't know about blocks allocated outside of it
+    while(heap->foreign)
+        freeForeign(heap, (u8*)heap->foreign + ForeignSize);
+
+    memcpy(heap->base, buffer, size);
+
+    return true;
+}
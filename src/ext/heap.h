@@ -0,0 +1,42 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <tic80_types.h>
+#include <stddef.h>
+
+// Heap keeps all the blocks of a script VM in one contiguous arena, so the
+// whole VM can be saved and restored with a plain memory copy.
+// Allocations that don't fit the arena fall back to the system allocator,
+// a heap with such blocks alive can't be saved.
+
+typedef struct Heap Heap;
+
+Heap* heap_create(u32 size);
+void heap_delete(Heap* heap);
+void* heap_realloc(Heap* heap, void* ptr, size_t size);
+u32 heap_capacity(const Heap* heap);
+u32 heap_used(const Heap* heap);
+const void* heap_base(const Heap* heap);
+u32 heap_save(const Heap* heap, void* buffer, u32 size);
+bool heap_load(Heap* heap, const void* buffer, u32 size);
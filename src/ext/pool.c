@@ -0,0 +1,188 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "pool.h"
+#include "thread.h"
+
+#include <stdlib.h>
+
+#if !defined(_WIN32)
+#include <unistd.h>
+#endif
+
+// every worker owns a range of jobs, takes them from the back and
+// steals from the front of the others when its own range is empty
+typedef struct
+{
+    Mutex lock;
+    s32 begin;
+    s32 end;
+} Queue;
+
+typedef struct Pool Pool;
+
+typedef struct
+{
+    Pool* pool;
+    s32 index;
+    Thread thread;
+} Worker;
+
+struct Pool
+{
+    PoolJob job;
+    void* data;
+
+    s32 count;
+    Queue* queues;
+    Worker* workers;
+};
+
+static bool popJob(Queue* queue, s32* index)
+{
+    bool done = false;
+
+    mutex_lock(&queue->lock);
+
+    if(queue->begin < queue->end)
+    {
+        *index = --queue->end;
+        done = true;
+    }
+
+    mutex_unlock(&queue->lock);
+
+    return done;
+}
+
+static bool stealJob(Queue* queue, s32* index)
+{
+    bool done = false;
+
+    mutex_lock(&queue->lock);
+
+    if(queue->begin < queue->end)
+    {
+        *index = queue->begin++;
+        done = true;
+    }
+
+    mutex_unlock(&queue->lock);
+
+    return done;
+}
+
+static void work(Worker* worker)
+{
+    Pool* pool = worker->pool;
+    s32 index;
+
+    for(;;)
+    {
+        if(popJob(&pool->queues[worker->index], &index))
+        {
+            pool->job(pool->data, index);
+            continue;
+        }
+
+        // no jobs are ever added, so nothing to steal means we're done
+        bool stolen = false;
+
+        for(s32 i = 1; i < pool->count && !stolen; i++)
+            stolen = stealJob(&pool->queues[(worker->index + i) % pool->count], &index);
+
+        if(!stolen) break;
+
+        pool->job(pool->data, index);
+    }
+}
+
+THREAD_ENTRY(workerThread, work)
+
+static bool startThread(Worker* worker)
+{
+    return thread_start(&worker->thread, workerThread, worker);
+}
+
+static void joinThread(Worker* worker)
+{
+    thread_join(&worker->thread);
+}
+
+s32 pool_cpus()
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    s32 cpus = info.dwNumberOfProcessors;
+#else
+    s32 cpus = (s32)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+
+    return cpus > 0 ? cpus : 1;
+}
+
+void pool_run(s32 threads, s32 count, PoolJob job, void* data)
+{
+    if(threads > count) threads = count;
+    if(threads < 1) threads = 1;
+
+    Pool pool = {job, data, threads};
+
+    pool.queues = malloc(threads * sizeof(Queue));
+    pool.workers = malloc(threads * sizeof(Worker));
+
+    if(threads == 1 || !pool.queues || !pool.workers)
+    {
+        for(s32 i = 0; i < count; i++)
+            job(data, i);
+    }
+    else
+    {
+        for(s32 i = 0; i < threads; i++)
+        {
+            Queue* queue = &pool.queues[i];
+            mutex_init(&queue->lock);
+            queue->begin = (s32)((s64)count * i / threads);
+            queue->end = (s32)((s64)count * (i + 1) / threads);
+
+            pool.workers[i] = (Worker){&pool, i};
+        }
+
+        // the calling thread is the first worker
+        s32 started = 1;
+        while(started < threads && startThread(&pool.workers[started]))
+            started++;
+
+        // queues of the threads which failed to start get stolen by the others
+        work(&pool.workers[0]);
+
+        for(s32 i = 1; i < started; i++)
+            joinThread(&pool.workers[i]);
+
+        for(s32 i = 0; i < threads; i++)
+            mutex_destroy(&pool.queues[i].lock);
+    }
+
+    free(pool.queues);
+    free(pool.workers);
+}
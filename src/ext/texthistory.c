@@ -0,0 +1,387 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "texthistory.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    s32 offset;
+    s32 size;
+    s32 capacity;
+    bool insert;
+
+    // the chars followed by their attributes, capacity bytes each
+    u8* data;
+} Op;
+
+typedef struct Step Step;
+
+struct Step
+{
+    Step* next;
+    Step* prev;
+
+    Op* ops;
+    s32 count;
+
+    TextCursor before;
+    TextCursor after;
+
+    u32 bytes;
+};
+
+struct TextHistory
+{
+    char* text;
+    u8* attrs;
+    u32 limit;
+    u32 bytes;
+
+    // the first step is empty and stands for the oldest text left
+    Step* first;
+    Step* current;
+    Step* pending;
+
+    // the current step is a run of typed or deleted chars
+    bool run;
+};
+
+static void freeStep(TextHistory* history, Step* step)
+{
+    for(s32 i = 0; i < step->count; i++)
+        free(step->ops[i].data);
+
+    history->bytes -= step->bytes;
+
+    free(step->ops);
+    free(step);
+}
+
+static void freeSteps(TextHistory* history, Step* from)
+{
+    while(from)
+    {
+        Step* next = from->next;
+        freeStep(history, from);
+        from = next;
+    }
+}
+
+static Step* createStep(TextHistory* history)
+{
+    Step* step = calloc(1, sizeof(Step));
+
+    if(step)
+    {
+        step->bytes = sizeof(Step);
+        history->bytes += step->bytes;
+    }
+
+    return step;
+}
+
+static bool resizeOp(TextHistory* history, Step* step, Op* op, s32 capacity)
+{
+    u8* data = malloc(capacity * 2);
+
+    if(!data)
+        return false;
+
+    if(op->data)
+    {
+        memcpy(data, op->data, op->size);
+        memcpy(data + capacity, op->data + op->capacity, op->size);
+        free(op->data);
+    }
+
+    step->bytes += (capacity - op->capacity) * 2;
+    history->bytes += (capacity - op->capacity) * 2;
+
+    op->data = data;
+    op->capacity = capacity;
+
+    return true;
+}
+
+static void record(TextHistory* history, const TextCursor* cursor, s32 offset, s32 size, bool insert)
+{
+    if(size <= 0)
+        return;
+
+    if(!history->pending)
+    {
+        history->pending = createStep(history);
+
+        if(!history->pending)
+            return;
+
+        history->pending->before = *cursor;
+    }
+
+    Step* step = history->pending;
+    Op* ops = realloc(step->ops, (step->count + 1) * sizeof(Op));
+
+    if(!ops)
+        return;
+
+    step->ops = ops;
+    step->bytes += sizeof(Op);
+    history->bytes += sizeof(Op);
+
+    Op* op = &step->ops[step->count++];
+    *op = (Op){.offset = offset, .insert = insert};
+
+    if(resizeOp(history, step, op, size))
+    {
+        memcpy(op->data, history->text + offset, size);
+        memcpy(op->data + op->capacity, history->attrs + offset, size);
+        op->size = size;
+    }
+}
+
+void texthistory_remove(TextHistory* history, const TextCursor* cursor, s32 offset, s32 size)
+{
+    record(history, cursor, offset, size, false);
+}
+
+void texthistory_insert(TextHistory* history, const TextCursor* cursor, s32 offset, s32 size)
+{
+    record(history, cursor, offset, size, true);
+}
+
+static inline bool isspace_(u8 c) {return c == ' ' || c == '\t';}
+
+// appends the only char of the new step to the current run
+static bool mergeRun(TextHistory* history, const Step* next)
+{
+    Step* step = history->current;
+    const Op* op = &next->ops[0];
+
+    if(!history->run || step->count != 1 || op->size != 1
+        || memcmp(&step->after, &next->before, sizeof(TextCursor)) != 0)
+        return false;
+
+    Op* last = &step->ops[0];
+
+    if(last->insert != op->insert)
+        return false;
+
+    bool append;
+
+    if(op->insert)
+    {
+        // typing, a new word starts a new step
+        if(last->offset + last->size != op->offset
+            || op->data[0] == '\n'
+            || (isspace_(last->data[last->size - 1]) && !isspace_(op->data[0])))
+            return false;
+
+        append = true;
+    }
+    else if(op->offset == last->offset)
+        append = true; // delete
+    else if(op->offset + 1 == last->offset)
+        append = false; // backspace
+    else return false;
+
+    if(last->size == last->capacity && !resizeOp(history, step, last, last->capacity * 2))
+        return false;
+
+    u8* chars = last->data;
+    u8* attrs = last->data + last->capacity;
+
+    if(append)
+    {
+        chars[last->size] = op->data[0];
+        attrs[last->size] = op->data[op->capacity];
+    }
+    else
+    {
+        memmove(chars + 1, chars, last->size);
+        memmove(attrs + 1, attrs, last->size);
+        chars[0] = op->data[0];
+        attrs[0] = op->data[op->capacity];
+        last->offset--;
+    }
+
+    last->size++;
+
+    return true;
+}
+
+bool texthistory_commit(TextHistory* history, const TextCursor* cursor)
+{
+    Step* step = history->pending;
+
+    if(!step)
+        return false;
+
+    history->pending = NULL;
+
+    freeSteps(history, history->current->next);
+    history->current->next = NULL;
+
+    bool single = step->count == 1 && step->ops[0].size == 1 
+        && !(step->ops[0].insert && step->ops[0].data[0] == '\n');
+
+    if(single && mergeRun(history, step))
+    {
+        history->current->after = *cursor;
+        freeStep(history, step);
+        return true;
+    }
+
+    step->after = *cursor;
+    step->prev = history->current;
+    history->current->next = step;
+    history->current = step;
+    history->run = single;
+
+    // drop the oldest steps over the limit, the text they led to becomes the first one
+    while(history->bytes > history->limit && history->first->next)
+    {
+        Step* oldest = history->first->next;
+
+        history->first->next = oldest->next;
+
+        if(oldest->next)
+            oldest->next->prev = history->first;
+
+        if(history->current == oldest)
+        {
+            history->current = history->first;
+            history->run = false;
+        }
+
+        freeStep(history, oldest);
+    }
+
+    return true;
+}
+
+static void removeChars(TextHistory* history, s32 offset, s32 size)
+{
+    s32 rest = (s32)strlen(history->text + offset + size) + 1;
+
+    memmove(history->text + offset, history->text + offset + size, rest);
+    memmove(history->attrs + offset, history->attrs + offset + size, rest);
+}
+
+static void insertChars(TextHistory* history, const Op* op)
+{
+    s32 rest = (s32)strlen(history->text + op->offset) + 1;
+
+    memmove(history->text + op->offset + op->size, history->text + op->offset, rest);
+    memmove(history->attrs + op->offset + op->size, history->attrs + op->offset, rest);
+
+    memcpy(history->text + op->offset, op->data, op->size);
+    memcpy(history->attrs + op->offset, op->data + op->capacity, op->size);
+}
+
+bool texthistory_undo(TextHistory* history, TextCursor* cursor)
+{
+    texthistory_commit(history, cursor);
+
+    Step* step = history->current;
+
+    if(step == history->first)
+        return false;
+
+    for(s32 i = step->count - 1; i >= 0; i--)
+    {
+        const Op* op = &step->ops[i];
+
+        if(op->insert)
+            removeChars(history, op->offset, op->size);
+        else
+            insertChars(history, op);
+    }
+
+    *cursor = step->before;
+    history->current = step->prev;
+    history->run = false;
+
+    return true;
+}
+
+bool texthistory_redo(TextHistory* history, TextCursor* cursor)
+{
+    if(history->pending)
+        return false;
+
+    Step* step = history->current->next;
+
+    if(!step)
+        return false;
+
+    for(s32 i = 0; i < step->count; i++)
+    {
+        const Op* op = &step->ops[i];
+
+        if(op->insert)
+            insertChars(history, op);
+        else
+            removeChars(history, op->offset, op->size);
+    }
+
+    *cursor = step->after;
+    history->current = step;
+    history->run = false;
+
+    return true;
+}
+
+TextHistory* texthistory_create(char* text, u8* attrs, u32 limit)
+{
+    TextHistory* history = calloc(1, sizeof(TextHistory));
+
+    if(history)
+    {
+        history->text = text;
+        history->attrs = attrs;
+        history->limit = limit;
+        history->first = history->current = createStep(history);
+
+        if(!history->first)
+        {
+            free(history);
+            return NULL;
+        }
+    }
+
+    return history;
+}
+
+void texthistory_delete(TextHistory* history)
+{
+    if(history)
+    {
+        if(history->pending)
+            freeStep(history, history->pending);
+
+        freeSteps(history, history->first);
+        free(history);
+    }
+}
@@ -0,0 +1,51 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <tic80_types.h>
+
+typedef struct TextHistory TextHistory;
+
+// cursor as offsets into the text, selection is -1 if there is none
+typedef struct
+{
+    s32 position;
+    s32 selection;
+} TextCursor;
+
+// records the edits of a zero terminated text and of the per char attributes kept in parallel with it,
+// the oldest steps are dropped when the recorded data grows over the limit
+TextHistory* texthistory_create(char* text, u8* attrs, u32 limit);
+
+// call before removing and after inserting the chars, the cursor is the one before the step
+void texthistory_remove(TextHistory* history, const TextCursor* cursor, s32 offset, s32 size);
+void texthistory_insert(TextHistory* history, const TextCursor* cursor, s32 offset, s32 size);
+
+// closes the step, a typed or deleted char joins the run of the previous step
+bool texthistory_commit(TextHistory* history, const TextCursor* cursor);
+
+// the cursor is replaced with the one saved with the step
+bool texthistory_undo(TextHistory* history, TextCursor* cursor);
+bool texthistory_redo(TextHistory* history, TextCursor* cursor);
+
+void texthistory_delete(TextHistory* history);
@@ -0,0 +1,781 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "covers.h"
+#include "studio.h"
+#include "fs.h"
+#include "project.h"
+#include "cart.h"
+#include "tools.h"
+#include "ext/gif.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__EMSCRIPTEN__) || defined(BAREMETALPI) || defined(_3DS)
+
+// no threads here, a cover is decoded per take
+#define COVERS_SYNC
+
+#else
+
+#include "ext/thread.h"
+
+#endif
+
+#define COVERS_MAGIC 0x49434954 // 'TICI'
+#define COVERS_VERSION 2
+
+// the covers ahead of the cursor are decoded first
+enum {AheadWeight = 1, BehindWeight = 2};
+
+typedef struct
+{
+    s32 id;
+    u32 generation;
+    char path[TICNAME_MAX];
+} Job;
+
+typedef struct
+{
+    s32 id;
+    tic_cover* cover;
+} Result;
+
+typedef struct
+{
+    char* path;
+    u64 date;
+    s32 size;
+
+    // NULL if the cart has no cover
+    tic_cover* cover;
+} Entry;
+
+typedef struct
+{
+    char path[TICNAME_MAX];
+
+    // covers are decoded over this color, they're dropped when it changes
+    tic_rgb background;
+
+    Entry* items;
+    s32 count;
+    s32 capacity;
+    bool dirty;
+} Index;
+
+struct tic_covers
+{
+    struct
+    {
+        Job* items;
+        s32 count;
+        s32 capacity;
+    } jobs;
+
+    struct
+    {
+        Result* items;
+        s32 count;
+        s32 capacity;
+    } results;
+
+    s32 focus;
+    u32 generation;
+
+    // index to switch to
+    char next[TICNAME_MAX];
+    tic_rgb nextBackground;
+    bool reopen;
+
+    // touched by the worker only
+    Index index;
+
+#if !defined(COVERS_SYNC)
+    Mutex lock;
+    Cond cond;
+    Thread thread;
+    bool quit;
+#endif
+};
+
+static inline void lock(tic_covers* covers)
+{
+#if !defined(COVERS_SYNC)
+    mutex_lock(&covers->lock);
+#endif
+}
+
+static inline void unlock(tic_covers* covers)
+{
+#if !defined(COVERS_SYNC)
+    mutex_unlock(&covers->lock);
+#endif
+}
+
+static bool reserve(void** items, s32* capacity, s32 count, s32 size)
+{
+    if(count < *capacity)
+        return true;
+
+    s32 newCapacity = *capacity ? *capacity * 2 : 16;
+    void* data = realloc(*items, newCapacity * size);
+
+    if(!data)
+        return false;
+
+    *items = data;
+    *capacity = newCapacity;
+
+    return true;
+}
+
+tic_cover* tic_cover_decode(const u8* data, s32 size, const tic_rgb* background)
+{
+    gif_image* image = gif_read_data(data, size);
+    tic_cover* cover = NULL;
+
+    if(image)
+    {
+        if(image->width == TIC80_WIDTH && image->height == TIC80_HEIGHT
+            && (cover = malloc(sizeof(tic_cover))))
+        {
+            for(s32 r = 0; r < TIC80_HEIGHT; r++)
+            {
+                tic_palette* palette = &cover->palettes[r];
+                s32 colorIndex = 0;
+
+                // gif colors already mapped in this row
+                s8 mapping[256];
+                memset(mapping, -1, sizeof mapping);
+
+                memset(palette, 0, sizeof(tic_palette));
+
+                // init first color with default background
+                palette->colors[0] = *background;
+
+                for(s32 c = 0; c < TIC80_WIDTH; c++)
+                {
+                    s32 pixel = r * TIC80_WIDTH + c;
+                    u8 index = image->buffer[pixel];
+                    s32 color = mapping[index];
+
+                    if(color < 0)
+                    {
+                        const gif_color* rgb = &image->palette[index];
+
+                        for(s32 i = 0; i <= colorIndex; i++)
+                        {
+                            const tic_rgb* palColor = &palette->colors[i];
+                            if(palColor->r == rgb->r
+                                && palColor->g == rgb->g
+                                && palColor->b == rgb->b)
+                            {
+                                color = i;
+                                break;
+                            }
+                        }
+
+                        if(color < 0)
+                        {
+                            if(colorIndex < TIC_PALETTE_SIZE-1)
+                            {
+                                tic_rgb* palColor = &palette->colors[color = ++colorIndex];
+
+                                palColor->r = rgb->r;
+                                palColor->g = rgb->g;
+                                palColor->b = rgb->b;
+                            }
+                            else color = tic_tool_find_closest_color(palette->colors, rgb);
+                        }
+
+                        mapping[index] = color;
+                    }
+
+                    tic_tool_poke4(cover->screen.data, pixel, color);
+                }
+            }
+        }
+
+        gif_close(image);
+    }
+
+    return cover;
+}
+
+static const u8* findCover(const u8* buffer, s32 size, s32* coverSize)
+{
+    const u8* ptr = buffer;
+    const u8* end = buffer + size;
+
+    while(ptr + TIC_CART_CHUNK_HEADER <= end)
+    {
+        bool cover;
+        s32 chunk = tic_cart_chunk_size(ptr, &cover);
+        ptr += TIC_CART_CHUNK_HEADER;
+
+        if(cover && ptr + chunk <= end)
+        {
+            *coverSize = chunk;
+            return ptr;
+        }
+
+        ptr += chunk;
+    }
+
+    return NULL;
+}
+
+// seeks from a chunk header to another, only the cover itself is read
+static u8* readCartCover(const char* path, s32* size)
+{
+    FILE* file = fs_open(path, "rb");
+
+    if(!file)
+    {
+        s32 fileSize = 0;
+        u8* data = fs_read(path, &fileSize);
+        u8* cover = NULL;
+
+        if(data)
+        {
+            const u8* ptr = findCover(data, fileSize, size);
+
+            if(ptr && (cover = malloc(*size)))
+                memcpy(cover, ptr, *size);
+
+            free(data);
+        }
+
+        return cover;
+    }
+
+    u8 header[TIC_CART_CHUNK_HEADER];
+    u8* cover = NULL;
+
+    while(fread(header, sizeof header, 1, file) == 1)
+    {
+        bool found;
+        s32 chunk = tic_cart_chunk_size(header, &found);
+
+        if(found)
+        {
+            if((cover = malloc(chunk)) && fread(cover, chunk, 1, file) != 1)
+            {
+                free(cover);
+                cover = NULL;
+            }
+
+            *size = chunk;
+            break;
+        }
+
+        if(fseek(file, chunk, SEEK_CUR))
+            break;
+    }
+
+    fclose(file);
+
+    return cover;
+}
+
+static tic_cover* loadCover(tic_covers* covers, const char* path)
+{
+    tic_cover* cover = NULL;
+
+    if(hasProjectExt(path))
+    {
+        s32 size = 0;
+        void* data = fs_read(path, &size);
+
+        if(data)
+        {
+            tic_cartridge* cart = malloc(sizeof(tic_cartridge));
+
+            if(cart)
+            {
+                if(tic_project_load(path, data, size, cart) && cart->cover.size)
+                    cover = tic_cover_decode(cart->cover.data, cart->cover.size, &covers->index.background);
+
+                free(cart);
+            }
+
+            free(data);
+        }
+    }
+    else
+    {
+        s32 size = 0;
+        u8* data = readCartCover(path, &size);
+
+        if(data)
+        {
+            cover = tic_cover_decode(data, size, &covers->index.background);
+            free(data);
+        }
+    }
+
+    return cover;
+}
+
+static void freeIndex(Index* index)
+{
+    for(s32 i = 0; i < index->count; i++)
+    {
+        free(index->items[i].path);
+        free(index->items[i].cover);
+    }
+
+    free(index->items);
+    memset(index, 0, sizeof(Index));
+}
+
+static Entry* findEntry(Index* index, const char* path)
+{
+    for(s32 i = 0; i < index->count; i++)
+        if(strcmp(index->items[i].path, path) == 0)
+            return &index->items[i];
+
+    return NULL;
+}
+
+static Entry* addEntry(Index* index, const char* path)
+{
+    if(!reserve((void**)&index->items, &index->capacity, index->count, sizeof(Entry)))
+        return NULL;
+
+    Entry* entry = &index->items[index->count];
+    memset(entry, 0, sizeof(Entry));
+
+    if(!(entry->path = strdup(path)))
+        return NULL;
+
+    index->count++;
+
+    return entry;
+}
+
+// index file, native endian, it's a cache and never leaves the machine
+// u32 magic, u32 version, u32 count, tic_rgb background, then for every cart
+// u16 path length, path, u64 date, s32 size, u8 cover, tic_cover if there is one
+#define READ(ptr, value) (memcpy(&(value), ptr, sizeof(value)), ptr += sizeof(value))
+#define WRITE(ptr, value) (memcpy(ptr, &(value), sizeof(value)), ptr += sizeof(value))
+
+// entries of the carts which are gone are dropped, all of them if the
+// background color has changed
+static void loadIndex(Index* index, const char* path, const tic_rgb* background)
+{
+    freeIndex(index);
+    snprintf(index->path, sizeof index->path, "%s", path);
+    index->background = *background;
+
+    s32 size = 0;
+    u8* data = fs_read(path, &size);
+
+    if(!data)
+        return;
+
+    const u8* ptr = data;
+    const u8* end = data + size;
+    u32 magic = 0, version = 0, count = 0;
+    tic_rgb color = {0};
+
+    if(size >= sizeof(u32) * 3 + sizeof(tic_rgb))
+    {
+        READ(ptr, magic);
+        READ(ptr, version);
+        READ(ptr, count);
+        READ(ptr, color);
+    }
+
+    if(magic != COVERS_MAGIC || version != COVERS_VERSION
+        || memcmp(&color, background, sizeof(tic_rgb)))
+    {
+        // stale, it's rewritten with the covers decoded from now on
+        index->dirty = true;
+    }
+    else
+    {
+        for(u32 i = 0; i < count; i++)
+        {
+            u16 length;
+            u64 date;
+            s32 fileSize;
+            u8 hasCover;
+
+            if(ptr + sizeof length > end) break;
+            READ(ptr, length);
+
+            if(length >= TICNAME_MAX || ptr + length + sizeof date + sizeof fileSize + sizeof hasCover > end) break;
+
+            char name[TICNAME_MAX];
+            memcpy(name, ptr, length);
+            name[length] = '\0';
+            ptr += length;
+
+            READ(ptr, date);
+            READ(ptr, fileSize);
+            READ(ptr, hasCover);
+
+            if(hasCover && ptr + sizeof(tic_cover) > end) break;
+
+            if(!fs_exists(name))
+            {
+                if(hasCover)
+                    ptr += sizeof(tic_cover);
+
+                index->dirty = true;
+                continue;
+            }
+
+            Entry* entry = addEntry(index, name);
+
+            if(!entry) break;
+
+            entry->date = date;
+            entry->size = fileSize;
+
+            if(hasCover)
+            {
+                if((entry->cover = malloc(sizeof(tic_cover))))
+                    memcpy(entry->cover, ptr, sizeof(tic_cover));
+
+                ptr += sizeof(tic_cover);
+            }
+        }
+    }
+
+    free(data);
+}
+
+static void saveIndex(Index* index)
+{
+    if(!index->dirty)
+        return;
+
+    index->dirty = false;
+
+    s32 size = sizeof(u32) * 3 + sizeof(tic_rgb);
+
+    for(s32 i = 0; i < index->count; i++)
+    {
+        const Entry* entry = &index->items[i];
+        size += sizeof(u16) + (s32)strlen(entry->path) + sizeof(u64) + sizeof(s32) + sizeof(u8)
+            + (entry->cover ? sizeof(tic_cover) : 0);
+    }
+
+    u8* data = malloc(size);
+
+    if(!data)
+        return;
+
+    u8* ptr = data;
+    u32 magic = COVERS_MAGIC, version = COVERS_VERSION, count = index->count;
+
+    WRITE(ptr, magic);
+    WRITE(ptr, version);
+    WRITE(ptr, count);
+    WRITE(ptr, index->background);
+
+    for(s32 i = 0; i < index->count; i++)
+    {
+        const Entry* entry = &index->items[i];
+        u16 length = (u16)strlen(entry->path);
+        u8 hasCover = entry->cover != NULL;
+
+        WRITE(ptr, length);
+        memcpy(ptr, entry->path, length);
+        ptr += length;
+        WRITE(ptr, entry->date);
+        WRITE(ptr, entry->size);
+        WRITE(ptr, hasCover);
+
+        if(entry->cover)
+        {
+            memcpy(ptr, entry->cover, sizeof(tic_cover));
+            ptr += sizeof(tic_cover);
+        }
+    }
+
+    fs_write_atomic(index->path, data, size);
+    free(data);
+}
+
+#undef READ
+#undef WRITE
+
+// the cart is read only if its date or size don't match the index
+static tic_cover* processJob(tic_covers* covers, const Job* job)
+{
+    Index* index = &covers->index;
+    u64 date = fs_date(job->path);
+    s32 size = fs_size(job->path);
+
+    Entry* entry = findEntry(index, job->path);
+
+    if(!entry || entry->date != date || entry->size != size)
+    {
+        tic_cover* cover = loadCover(covers, job->path);
+
+        if(entry || (entry = addEntry(index, job->path)))
+        {
+            free(entry->cover);
+
+            entry->date = date;
+            entry->size = size;
+            entry->cover = cover;
+            index->dirty = true;
+        }
+        else return cover;
+    }
+
+    tic_cover* cover = NULL;
+
+    if(entry->cover && (cover = malloc(sizeof(tic_cover))))
+        memcpy(cover, entry->cover, sizeof(tic_cover));
+
+    return cover;
+}
+
+static Job popJob(tic_covers* covers)
+{
+    Job* items = covers->jobs.items;
+    s32 best = 0, bestWeight = INT_MAX;
+
+    for(s32 i = 0; i < covers->jobs.count; i++)
+    {
+        s32 distance = items[i].id - covers->focus;
+        s32 weight = distance >= 0 ? distance * AheadWeight : -distance * BehindWeight;
+
+        if(weight < bestWeight)
+        {
+            best = i;
+            bestWeight = weight;
+        }
+    }
+
+    Job job = items[best];
+    items[best] = items[--covers->jobs.count];
+
+    return job;
+}
+
+// a unit of work, called and returns with the lock held
+static bool step(tic_covers* covers)
+{
+    if(covers->reopen)
+    {
+        char path[TICNAME_MAX];
+        strcpy(path, covers->next);
+        tic_rgb background = covers->nextBackground;
+        covers->reopen = false;
+
+        unlock(covers);
+        saveIndex(&covers->index);
+        loadIndex(&covers->index, path, &background);
+        lock(covers);
+
+        return true;
+    }
+
+    if(covers->jobs.count == 0)
+    {
+        if(!covers->index.dirty)
+            return false;
+
+        unlock(covers);
+        saveIndex(&covers->index);
+        lock(covers);
+
+        return true;
+    }
+
+    Job job = popJob(covers);
+
+    unlock(covers);
+    tic_cover* cover = processJob(covers, &job);
+    lock(covers);
+
+    if(job.generation == covers->generation
+        && reserve((void**)&covers->results.items, &covers->results.capacity, covers->results.count, sizeof(Result)))
+    {
+        covers->results.items[covers->results.count++] = (Result){job.id, cover};
+    }
+    else free(cover);
+
+    return true;
+}
+
+#if !defined(COVERS_SYNC)
+
+static void work(tic_covers* covers)
+{
+    lock(covers);
+
+    while(!covers->quit)
+        if(!step(covers))
+            cond_wait(&covers->cond, &covers->lock);
+
+    unlock(covers);
+}
+
+THREAD_ENTRY(coversThread, work)
+
+static bool startThread(tic_covers* covers)
+{
+    return thread_start(&covers->thread, coversThread, covers);
+}
+
+static void joinThread(tic_covers* covers)
+{
+    thread_join(&covers->thread);
+}
+
+#endif
+
+static inline void wakeUp(tic_covers* covers)
+{
+#if !defined(COVERS_SYNC)
+    cond_broadcast(&covers->cond);
+#endif
+}
+
+static void clearResults(tic_covers* covers)
+{
+    for(s32 i = 0; i < covers->results.count; i++)
+        free(covers->results.items[i].cover);
+
+    covers->results.count = 0;
+}
+
+tic_covers* tic_covers_create()
+{
+    tic_covers* covers = calloc(1, sizeof(tic_covers));
+
+    if(covers)
+    {
+#if !defined(COVERS_SYNC)
+        mutex_init(&covers->lock);
+        cond_init(&covers->cond);
+
+        if(!startThread(covers))
+        {
+            cond_destroy(&covers->cond);
+            mutex_destroy(&covers->lock);
+            free(covers);
+            return NULL;
+        }
+#endif
+    }
+
+    return covers;
+}
+
+void tic_covers_open(tic_covers* covers, const char* index, const tic_rgb* background)
+{
+    lock(covers);
+
+    covers->generation++;
+    covers->jobs.count = 0;
+    clearResults(covers);
+
+    snprintf(covers->next, sizeof covers->next, "%s", index);
+    covers->nextBackground = *background;
+    covers->reopen = true;
+
+    wakeUp(covers);
+    unlock(covers);
+}
+
+void tic_covers_request(tic_covers* covers, s32 id, const char* path)
+{
+    lock(covers);
+
+    if(reserve((void**)&covers->jobs.items, &covers->jobs.capacity, covers->jobs.count, sizeof(Job)))
+    {
+        Job* job = &covers->jobs.items[covers->jobs.count++];
+
+        job->id = id;
+        job->generation = covers->generation;
+        snprintf(job->path, sizeof job->path, "%s", path);
+
+        wakeUp(covers);
+    }
+
+    unlock(covers);
+}
+
+void tic_covers_focus(tic_covers* covers, s32 id)
+{
+    lock(covers);
+    covers->focus = id;
+    unlock(covers);
+}
+
+bool tic_covers_take(tic_covers* covers, s32* id, tic_cover** cover)
+{
+    lock(covers);
+
+#if defined(COVERS_SYNC)
+    if(covers->results.count == 0)
+        step(covers);
+#endif
+
+    bool done = covers->results.count > 0;
+
+    if(done)
+    {
+        const Result* result = &covers->results.items[--covers->results.count];
+
+        *id = result->id;
+        *cover = result->cover;
+    }
+
+    unlock(covers);
+
+    return done;
+}
+
+void tic_covers_close(tic_covers* covers)
+{
+#if !defined(COVERS_SYNC)
+    lock(covers);
+    covers->quit = true;
+    wakeUp(covers);
+    unlock(covers);
+
+    joinThread(covers);
+
+    cond_destroy(&covers->cond);
+    mutex_destroy(&covers->lock);
+#endif
+
+    saveIndex(&covers->index);
+    freeIndex(&covers->index);
+    clearResults(covers);
+
+    free(covers->jobs.items);
+    free(covers->results.items);
+    free(covers);
+}
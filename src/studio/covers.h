@@ -0,0 +1,46 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include "tic.h"
+
+// 4bpp cover with a palette per row, ready to be copied to VRAM
+typedef struct
+{
+    tic_screen screen;
+    tic_palette palettes[TIC80_HEIGHT];
+} tic_cover;
+
+// decodes the covers of a folder on a background thread and keeps them in
+// an index file, so carts which didn't change aren't read again, the covers
+// are decoded over the background color given when the folder is opened
+typedef struct tic_covers tic_covers;
+
+tic_covers* tic_covers_create   ();
+void        tic_covers_open     (tic_covers* covers, const char* index, const tic_rgb* background);
+void        tic_covers_request  (tic_covers* covers, s32 id, const char* path);
+void        tic_covers_focus    (tic_covers* covers, s32 id);
+bool        tic_covers_take     (tic_covers* covers, s32* id, tic_cover** cover);
+void        tic_covers_close    (tic_covers* covers);
+
+tic_cover*  tic_cover_decode    (const u8* gif, s32 size, const tic_rgb* background);
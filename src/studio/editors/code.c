@@ -21,7 +21,7 @@
 // SOFTWARE.
 
 #include "code.h"
-#include "ext/history.h"
+#include "ext/texthistory.h"
 
 #include <ctype.h>
 
@@ -31,6 +31,7 @@
 #define CODE_EDITOR_WIDTH (TIC80_WIDTH - BOOKMARK_WIDTH)
 #define CODE_EDITOR_HEIGHT (TIC80_HEIGHT - TOOLBAR_SIZE - STUDIO_TEXT_HEIGHT)
 #define TEXT_BUFFER_HEIGHT (CODE_EDITOR_HEIGHT / STUDIO_TEXT_HEIGHT)
+#define CODE_HISTORY_LIMIT (4 * 1024 * 1024) // 4M of undo steps
 
 typedef struct CodeState CodeState;
 
@@ -48,12 +49,32 @@ enum
     SyntaxTypeOther     = offsetof(struct tic_code_theme, other),
 };
 
-static void history(Code* code)
+// lexer states at a line start, the block comments and strings run over the lines
+enum
 {
-    if(history_add(code->history.code))
-        history_add(code->history.cursor);
+    LexNone,
+    LexBlockComment,
+    LexBlockComment2,
+    LexBlockString,
+    LexString,
+    LexChar,
+
+    LexUnknown = 0xff,
+};
 
-    history_add(code->history.state);
+static TextCursor getTextCursor(Code* code)
+{
+    return (TextCursor)
+    {
+        .position = (s32)(code->cursor.position - code->src),
+        .selection = code->cursor.selection ? (s32)(code->cursor.selection - code->src) : -1,
+    };
+}
+
+static void history(Code* code)
+{
+    TextCursor cursor = getTextCursor(code);
+    texthistory_commit(code->history, &cursor);
 }
 
 static void drawStatus(Code* code)
@@ -89,11 +110,136 @@ static inline CodeState* getState(Code* code, const char* pos)
     return code->state + (pos - code->src);
 }
 
+static inline bool islineend(char c) {return c == '\n' || c == '\0';}
+static inline bool isalpha_(char c) {return isalpha(c) || c == '_';}
+static inline bool isalnum_(char c) {return isalnum(c) || c == '_';}
+
+static bool reserveLines(Code* code, s32 count)
+{
+    if(count > code->lines.capacity)
+    {
+        s32 capacity = MAX(count, code->lines.capacity * 2);
+        struct CodeLine* items = realloc(code->lines.items, capacity * sizeof(struct CodeLine));
+
+        if(!items)
+            return false;
+
+        code->lines.items = items;
+        code->lines.capacity = capacity;
+    }
+
+    return true;
+}
+
+// rebuilds the line index, all the lines are parsed again
+static void resetLines(Code* code)
+{
+    code->lines.count = 0;
+    code->lines.changed = 0;
+
+    const char* ptr = code->src;
+
+    while(true)
+    {
+        if(!reserveLines(code, code->lines.count + 1))
+            break;
+
+        code->lines.items[code->lines.count++] = (struct CodeLine){(s32)(ptr - code->src), LexUnknown, true};
+
+        while(!islineend(*ptr)) ptr++;
+
+        if(!*ptr++) break;
+    }
+
+    if(code->lines.count)
+        code->lines.items->lexer = LexNone;
+
+    code->lines.size = (s32)(ptr - code->src - 1);
+}
+
+// the line holding the text offset
+static s32 getLineIndex(Code* code, s32 offset)
+{
+    s32 low = 0, high = code->lines.count - 1;
+
+    while(low < high)
+    {
+        s32 mid = (low + high + 1) / 2;
+
+        if(code->lines.items[mid].start <= offset) low = mid;
+        else high = mid - 1;
+    }
+
+    return low;
+}
+
+static void changeLine(Code* code, s32 line)
+{
+    code->lines.items[line].changed = true;
+    code->lines.changed = MIN(code->lines.changed, line);
+}
+
+// call before the chars are removed from the text
+static void removeLines(Code* code, s32 offset, s32 size)
+{
+    struct CodeLine* items = code->lines.items;
+    s32 line = getLineIndex(code, offset);
+    s32 first = line + 1, last = first;
+
+    while(last < code->lines.count && items[last].start <= offset + size) last++;
+
+    memmove(items + first, items + last, (code->lines.count - last) * sizeof(struct CodeLine));
+    code->lines.count -= last - first;
+
+    for(s32 i = first; i < code->lines.count; i++)
+        items[i].start -= size;
+
+    code->lines.size -= size;
+    changeLine(code, line);
+}
+
+// call after the chars are inserted to the text
+static void insertLines(Code* code, s32 offset, s32 size)
+{
+    s32 line = getLineIndex(code, offset);
+    s32 count = 0;
+
+    for(const char *ptr = code->src + offset, *end = ptr + size; ptr < end; ptr++)
+        if(*ptr == '\n')
+            count++;
+
+    if(!reserveLines(code, code->lines.count + count))
+    {
+        resetLines(code);
+        return;
+    }
+
+    struct CodeLine* items = code->lines.items;
+    s32 next = line + 1;
+
+    memmove(items + next + count, items + next, (code->lines.count - next) * sizeof(struct CodeLine));
+    code->lines.count += count;
+
+    for(s32 i = next + count; i < code->lines.count; i++)
+        items[i].start += size;
+
+    for(const char *ptr = code->src + offset, *end = ptr + size; ptr < end; ptr++)
+        if(*ptr == '\n')
+            items[next++] = (struct CodeLine){(s32)(ptr - code->src) + 1, LexUnknown, true};
+
+    code->lines.size += size;
+    changeLine(code, line);
+}
+
 static void toggleBookmark(Code* code, char* codePos)
 {
     CodeState* start = getState(code, codePos);
     const CodeState* end = getState(code, getNextLineByPos(code, codePos));
 
+    // the line is recorded as replaced to keep its old bookmarks
+    TextCursor cursor = getTextCursor(code);
+    texthistory_remove(code->history, &cursor, (s32)(codePos - code->src), (s32)(end - start));
+
     bool bookmarked = false;
     CodeState* ptr = start;
     while(ptr < end)
@@ -108,9 +254,15 @@ static void toggleBookmark(Code* code, char* codePos)
     }
     else start->bookmark = 1;
 
+    texthistory_insert(code->history, &cursor, (s32)(codePos - code->src), (s32)(end - start));
     history(code);
 }
 
+static s32 getFirstVisibleLine(Code* code)
+{
+    return CLAMP(code->scroll.y, 0, code->lines.count - 1);
+}
+
 static void drawBookmarks(Code* code)
 {
     tic_mem* tic = code->tic;
@@ -146,11 +298,12 @@ static void drawBookmarks(Code* code)
             toggleBookmark(code, getPosByLine(code->src, line + code->scroll.y));
     }
 
-    const char* pointer = code->src;
-    const CodeState* syntaxPointer = code->state;
-    s32 y = -code->scroll.y;
+    s32 first = getFirstVisibleLine(code);
+    const char* pointer = code->src + code->lines.items[first].start;
+    const CodeState* syntaxPointer = getState(code, pointer);
+    s32 y = first - code->scroll.y;
 
-    while(*pointer)
+    while(*pointer && y < TEXT_BUFFER_HEIGHT)
     {
         if(syntaxPointer++->bookmark)
         {
@@ -199,15 +352,17 @@ static void drawCode(Code* code, bool withCursor)
 {
     tic_rect rect = {BOOKMARK_WIDTH, TOOLBAR_SIZE, CODE_EDITOR_WIDTH, CODE_EDITOR_HEIGHT};
 
+    // the text above the screen is skipped
+    s32 first = getFirstVisibleLine(code);
     s32 xStart = rect.x - code->scroll.x * getFontWidth(code);
     s32 x = xStart;
-    s32 y = rect.y - code->scroll.y * STUDIO_TEXT_HEIGHT;
-    const char* pointer = code->src;
+    s32 y = rect.y + (first - code->scroll.y) * STUDIO_TEXT_HEIGHT;
+    const char* pointer = code->src + code->lines.items[first].start;
 
     u8 selectColor = getConfig()->theme.code.select;
     const struct tic_code_theme* theme = &getConfig()->theme.code.syntax;
     const u8* colors = (const u8*)theme;
-    const CodeState* syntaxPointer = code->state;
+    const CodeState* syntaxPointer = getState(code, pointer);
 
     struct { char* start; char* end; } selection = 
     {
@@ -254,6 +409,10 @@ static void drawCode(Code* code, bool withCursor)
         {
             x = xStart;
             y += STUDIO_TEXT_HEIGHT;
+
+            // and the text below it
+            if(y >= TIC80_HEIGHT)
+                break;
         }
         else x += getFontWidth(code);
 
@@ -277,36 +436,15 @@ static void drawCode(Code* code, bool withCursor)
 
 static void getCursorPosition(Code* code, s32* x, s32* y)
 {
-    *x = 0;
-    *y = 0;
+    s32 offset = (s32)(code->cursor.position - code->src);
 
-    const char* pointer = code->src;
-
-    while(*pointer)
-    {
-        if(code->cursor.position == pointer) return;
-
-        if(*pointer == '\n')
-        {
-            *x = 0;
-            (*y)++;
-        }
-        else (*x)++;
-
-        pointer++;
-    }
+    *y = getLineIndex(code, offset);
+    *x = offset - code->lines.items[*y].start;
 }
 
 static s32 getLinesCount(Code* code)
 {
-    char* text = code->src;
-    s32 count = 0;
-
-    while(*text)
-        if(*text++ == '\n')
-            count++;
-
-    return count;
+    return code->lines.count - 1;
 }
 
 static void removeInvalidChars(char* code)
@@ -373,104 +511,141 @@ static void updateEditor(Code* code)
 
     {
         sprintf(code->statusLine, "line %i/%i col %i", line + 1, getLinesCount(code) + 1, column + 1);
-        sprintf(code->statusSize, "size %i", (u32)strlen(code->src));
+        sprintf(code->statusSize, "size %i", code->lines.size);
     }
 }
 
-static inline bool islineend(char c) {return c == '\n' || c == '\0';}
-static inline bool isalpha_(char c) {return isalpha(c) || c == '_';}
-static inline bool isalnum_(char c) {return isalnum(c) || c == '_';}
-
 static void setCodeState(CodeState* state, u8 color, s32 start, s32 size)
 {
     for(s32 i = start; i < (start + size); i++)
         state[i].syntax = color;
 }
 
-static void parseCode(const tic_script_config* config, const char* start, CodeState* state)
+static const char* findInLine(const char* ptr, const char* end, const char* str)
 {
-    const char* ptr = start;
+    s32 len = (s32)strlen(str);
 
-    const char* blockCommentStart = NULL;
-    const char* blockCommentStart2 = NULL;
-    const char* blockStringStart = NULL;
-    const char* blockStdStringStart = NULL;
-    const char* singleCommentStart = NULL;
-    const char* wordStart = NULL;
-    const char* numberStart = NULL;
+    for(; end - ptr >= len; ptr++)
+        if(*ptr == *str && memcmp(ptr, str, len) == 0)
+            return ptr;
 
-start:
-    while(true)
-    {
-        char c = ptr[0];
+    return NULL;
+}
 
-        if(blockCommentStart)
+// returns the end of the open block comment or string on the line, NULL if it goes on
+static const char* findLexerEnd(const tic_script_config* config, u8 lexer, const char* ptr, const char* end)
+{
+    switch(lexer)
+    {
+    case LexBlockComment:
+    case LexBlockComment2:
+    case LexBlockString:
         {
-            const char* end = strstr(ptr, config->blockCommentEnd);
+            const char* marker = lexer == LexBlockComment 
+                ? config->blockCommentEnd 
+                : lexer == LexBlockComment2 ? config->blockCommentEnd2 : config->blockStringEnd;
 
-            ptr = end ? end + strlen(config->blockCommentEnd) : blockCommentStart + strlen(blockCommentStart);
-            setCodeState(state, SyntaxTypeComment, (s32)(blockCommentStart - start), (s32)(ptr - blockCommentStart));
-            blockCommentStart = NULL;
+            const char* pos = findInLine(ptr, end, marker);
 
-            // !TODO: stupid MS compiler doesn't see 'continue' here in release, so lets use 'goto' instead, investigate why
-            goto start;
+            return pos ? pos + strlen(marker) : NULL;
         }
-        else if(blockCommentStart2)
+    default:
         {
-            const char* end = strstr(ptr, config->blockCommentEnd2);
+            char quote = lexer == LexString ? '"' : '\'';
 
-            ptr = end ? end + strlen(config->blockCommentEnd2) : blockCommentStart2 + strlen(blockCommentStart2);
-            setCodeState(state, SyntaxTypeComment, (s32)(blockCommentStart2 - start), (s32)(ptr - blockCommentStart2));
-            blockCommentStart2 = NULL;
-            goto start;
-        }
-        else if(blockStringStart)
-        {
-            const char* end = strstr(ptr, config->blockStringEnd);
+            while(true)
+            {
+                const char* pos = memchr(ptr, quote, end - ptr);
+                
+                if(!pos) return NULL;
 
-            ptr = end ? end + strlen(config->blockStringEnd) : blockStringStart + strlen(blockStringStart);
-            setCodeState(state, SyntaxTypeString, (s32)(blockStringStart - start), (s32)(ptr - blockStringStart));
-            blockStringStart = NULL;
-            continue;
+                if(*(pos-1) == '\\' && *(pos-2) != '\\') ptr = pos + 1;
+                else return pos + 1;
+            }
         }
-        else if(blockStdStringStart)
+    }
+}
+
+// colors the line starting at ptr and returns the lexer state at the next line start
+static u8 parseLine(const tic_script_config* config, const char* start, CodeState* state, const char* ptr, u8 lexer)
+{
+    const char* lineEnd = ptr;
+    while(!islineend(*lineEnd)) lineEnd++;
+
+    setCodeState(state, SyntaxTypeVar, (s32)(ptr - start), (s32)(lineEnd - ptr) + 1);
+
+    const char* tokenStart = ptr;
+
+    while(true)
+    {
+        if(lexer != LexNone)
         {
-            const char* blockStart = blockStdStringStart+1;
+            const char* end = findLexerEnd(config, lexer, ptr, lineEnd);
+            u8 syntax = lexer == LexBlockComment || lexer == LexBlockComment2 ? SyntaxTypeComment : SyntaxTypeString;
 
-            while(true)
+            if(!end)
             {
-                const char* pos = strchr(blockStart, *blockStdStringStart);
-                
-                if(pos)
-                {
-                    if(*(pos-1) == '\\' && *(pos-2) != '\\') blockStart = pos + 1;
-                    else
-                    {
-                        ptr = pos + 1;
-                        break;
-                    }
-                }
-                else
-                {
-                    ptr = blockStdStringStart + strlen(blockStdStringStart);
-                    break;
-                }
+                // the new line char belongs to the block, the end of the code doesn't
+                ptr = *lineEnd ? lineEnd + 1 : lineEnd;
+                setCodeState(state, syntax, (s32)(tokenStart - start), (s32)(ptr - tokenStart));
+
+                if(*lineEnd) 
+                    return lexer;
+
+                state[lineEnd - start].syntax = SyntaxTypeOther;
+                return LexNone;
             }
 
-            setCodeState(state, SyntaxTypeString, (s32)(blockStdStringStart - start), (s32)(ptr - blockStdStringStart));
-            blockStdStringStart = NULL;
+            setCodeState(state, syntax, (s32)(tokenStart - start), (s32)(end - tokenStart));
+            ptr = end;
+            lexer = LexNone;
             continue;
         }
-        else if(singleCommentStart)
+
+        char c = ptr[0];
+
+        if(config->blockCommentStart && memcmp(ptr, config->blockCommentStart, strlen(config->blockCommentStart)) == 0)
         {
+            tokenStart = ptr;
+            ptr += strlen(config->blockCommentStart);
+            lexer = LexBlockComment;
+            continue;
+        }
+        if(config->blockCommentStart2 && memcmp(ptr, config->blockCommentStart2, strlen(config->blockCommentStart2)) == 0)
+        {
+            tokenStart = ptr;
+            ptr += strlen(config->blockCommentStart2);
+            lexer = LexBlockComment2;
+            continue;
+        }
+        else if(config->blockStringStart && memcmp(ptr, config->blockStringStart, strlen(config->blockStringStart)) == 0)
+        {
+            tokenStart = ptr;
+            ptr += strlen(config->blockStringStart);
+            lexer = LexBlockString;
+            continue;
+        }
+        else if(c == '"' || c == '\'')
+        {
+            tokenStart = ptr;
+            ptr++;
+            lexer = c == '"' ? LexString : LexChar;
+            continue;
+        }
+        else if(config->singleComment && memcmp(ptr, config->singleComment, strlen(config->singleComment)) == 0)
+        {
+            const char* singleCommentStart = ptr;
+            ptr += strlen(config->singleComment);
+
             while(!islineend(*ptr))ptr++;
 
             setCodeState(state, SyntaxTypeComment, (s32)(singleCommentStart - start), (s32)(ptr - singleCommentStart));
-            singleCommentStart = NULL;
             continue;
         }
-        else if(wordStart)
+        else if(isalpha_(c))
         {
+            const char* wordStart = ptr++;
+
             while(!islineend(*ptr) && isalnum_(*ptr)) ptr++;
 
             s32 len = (s32)(ptr - wordStart);
@@ -499,11 +674,12 @@ start:
                     }
             }
 
-            wordStart = NULL;
             continue;
         }
-        else if(numberStart)
+        else if(isdigit(c) || (c == '.' && isdigit(ptr[1])))
         {
+            const char* numberStart = ptr++;
+
             while(!islineend(*ptr))
             {
                 char c = *ptr;
@@ -525,58 +701,13 @@ start:
             }
 
             setCodeState(state, SyntaxTypeNumber, (s32)(numberStart - start), (s32)(ptr - numberStart));
-            numberStart = NULL;
             continue;
         }
-        else
-        {
-            if(config->blockCommentStart && memcmp(ptr, config->blockCommentStart, strlen(config->blockCommentStart)) == 0)
-            {
-                blockCommentStart = ptr;
-                ptr += strlen(config->blockCommentStart);
-                continue;
-            }
-            if(config->blockCommentStart2 && memcmp(ptr, config->blockCommentStart2, strlen(config->blockCommentStart2)) == 0)
-            {
-                blockCommentStart2 = ptr;
-                ptr += strlen(config->blockCommentStart2);
-                continue;
-            }
-            else if(config->blockStringStart && memcmp(ptr, config->blockStringStart, strlen(config->blockStringStart)) == 0)
-            {
-                blockStringStart = ptr;
-                ptr += strlen(config->blockStringStart);
-                continue;
-            }
-            else if(c == '"' || c == '\'')
-            {
-                blockStdStringStart = ptr;
-                ptr++;
-                continue;
-            }
-            else if(config->singleComment && memcmp(ptr, config->singleComment, strlen(config->singleComment)) == 0)
-            {
-                singleCommentStart = ptr;
-                ptr += strlen(config->singleComment);
-                continue;
-            }
-            else if(isalpha_(c))
-            {
-                wordStart = ptr;
-                ptr++;
-                continue;
-            }
-            else if(isdigit(c) || (c == '.' && isdigit(ptr[1])))
-            {
-                numberStart = ptr;
-                ptr++;
-                continue;
-            }
-            else if(ispunct(c)) state[ptr - start].syntax = SyntaxTypeSign;
-            else if(iscntrl(c)) state[ptr - start].syntax = SyntaxTypeOther;
-        }
+        else if(ispunct(c)) state[ptr - start].syntax = SyntaxTypeSign;
+        else if(iscntrl(c)) state[ptr - start].syntax = SyntaxTypeOther;
 
-        if(!c) break;
+        if(islineend(c)) 
+            return LexNone;
 
         ptr++;
     }
@@ -584,26 +715,47 @@ start:
 
 static void parseSyntaxColor(Code* code)
 {
-    for(s32 i = 0; i < TIC_CODE_SIZE; i++)
-        code->state[i].syntax = SyntaxTypeVar;
+    const tic_script_config* config = tic_core_script_config(code->tic);
 
-    tic_mem* tic = code->tic;
+    if(config != code->lines.config)
+    {
+        code->lines.config = config;
+        resetLines(code);
+    }
 
-    const tic_script_config* config = tic_core_script_config(tic);
+    struct CodeLine* items = code->lines.items;
+    s32 count = code->lines.count;
+    s32 i = code->lines.changed;
+
+    if(i >= count)
+        return;
+
+    u8 lexer = items[i].lexer;
+
+    while(i < count)
+    {
+        items[i].lexer = lexer;
+        items[i].changed = false;
+
+        lexer = parseLine(config, code->src, code->state, code->src + items[i].start, lexer);
+        i++;
+
+        // the state converged, the lines up to the next changed one are parsed already
+        if(i < count && !items[i].changed && items[i].lexer == lexer)
+        {
+            while(i < count && !items[i].changed) i++;
 
-    parseCode(config, code->src, code->state);
+            if(i < count)
+                lexer = items[i].lexer;
+        }
+    }
+
+    code->lines.changed = count;
 }
 
 static char* getLineByPos(Code* code, char* pos)
 {
-    char* text = code->src;
-    char* line = text;
-
-    while(text < pos)
-        if(*text++ == '\n')
-            line = text;
-
-    return line;
+    return code->src + code->lines.items[getLineIndex(code, (s32)(pos - code->src))].start;
 }
 
 static char* getLine(Code* code)
@@ -807,6 +959,15 @@ static void pageDown(Code* code)
 
 static void deleteCode(Code* code, char* start, char* end)
 {
+    end = MIN(end, code->src + code->lines.size);
+
+    if(start >= end)
+        return;
+
+    TextCursor cursor = getTextCursor(code);
+    texthistory_remove(code->history, &cursor, (s32)(start - code->src), (s32)(end - start));
+    removeLines(code, (s32)(start - code->src), (s32)(end - start));
+
     s32 size = (s32)strlen(end) + 1;
     memmove(start, end, size);
 
@@ -827,6 +988,10 @@ static void insertCode(Code* code, char* dst, const char* src)
         memmove(pos + size, pos, restSize);
         memset(pos, 0, size);
     }
+
+    TextCursor cursor = getTextCursor(code);
+    texthistory_insert(code->history, &cursor, (s32)(dst - code->src), size);
+    insertLines(code, (s32)(dst - code->src), size);
 }
 
 static bool replaceSelection(Code* code)
@@ -870,8 +1035,9 @@ static void backspaceChar(Code* code)
 {
     if(!replaceSelection(code) && code->cursor.position > code->src)
     {
-        char* pos = --code->cursor.position;
+        char* pos = code->cursor.position - 1;
         deleteCode(code, pos, pos + 1);
+        code->cursor.position = pos;
         history(code);
         parseSyntaxColor(code);
     }
@@ -919,7 +1085,8 @@ static void inputSymbolBase(Code* code, char sym)
     if (strlen(code->src) >= sizeof(tic_code))
         return;
 
-    insertCode(code, code->cursor.position++, (const char[]){sym, '\0'});
+    insertCode(code, code->cursor.position, (const char[]){sym, '\0'});
+    code->cursor.position++;
 
     history(code);
 
@@ -1045,24 +1212,34 @@ static void copyFromClipboard(Code* code)
 
 static void update(Code* code)
 {
+    resetLines(code);
     updateEditor(code);
     parseSyntaxColor(code);
 }
 
+static void setTextCursor(Code* code, const TextCursor* cursor)
+{
+    code->cursor.position = code->src + cursor->position;
+    code->cursor.selection = cursor->selection < 0 ? NULL : code->src + cursor->selection;
+    updateColumn(code);
+}
+
 static void undo(Code* code)
 {
-    history_undo(code->history.code);
-    history_undo(code->history.cursor);
-    history_undo(code->history.state);
+    TextCursor cursor = getTextCursor(code);
+
+    if(texthistory_undo(code->history, &cursor))
+        setTextCursor(code, &cursor);
 
     update(code);
 }
 
 static void redo(Code* code)
 {
-    history_redo(code->history.code);
-    history_redo(code->history.cursor);
-    history_redo(code->history.state);
+    TextCursor cursor = getTextCursor(code);
+
+    if(texthistory_redo(code->history, &cursor))
+        setTextCursor(code, &cursor);
 
     update(code);
 }
@@ -2191,12 +2368,12 @@ static void onStudioEvent(Code* code, StudioEvent event)
 
 void initCode(Code* code, tic_mem* tic, tic_code* src)
 {
-    if(code->state == NULL)
+    if(code->state)
         free(code->state);
 
-    if(code->history.code) history_delete(code->history.code);
-    if(code->history.cursor) history_delete(code->history.cursor);
-    if(code->history.state) history_delete(code->history.state);
+    free(code->lines.items);
+
+    if(code->history) texthistory_delete(code->history);
 
     *code = (Code)
     {
@@ -2208,12 +2385,7 @@ void initCode(Code* code, tic_mem* tic, tic_code* src)
         .scroll = {0, 0, {0, 0}, false},
         .state = calloc(TIC_CODE_SIZE, sizeof(CodeState)),
         .tickCounter = 0,
-        .history = 
-        {
-            .code = NULL,
-            .cursor = NULL,
-            .state = NULL,
-        },
+        .history = NULL,
         .mode = TEXT_EDIT_MODE,
         .jump = {.line = -1},
         .popup =
@@ -2234,9 +2406,7 @@ void initCode(Code* code, tic_mem* tic, tic_code* src)
         .update = update,
     };
 
-    code->history.code = history_create(code->src, sizeof(tic_code));
-    code->history.cursor = history_create(&code->cursor, sizeof code->cursor);
-    code->history.state = history_create(code->state, sizeof(CodeState) * TIC_CODE_SIZE);
+    code->history = texthistory_create(code->src, (u8*)code->state, CODE_HISTORY_LIMIT);
 
     update(code);
 }
@@ -2244,8 +2414,7 @@ void initCode(Code* code, tic_mem* tic, tic_code* src)
 void freeCode(Code* code)
 {
     free(code->state);
-    history_delete(code->history.code);
-    history_delete(code->history.cursor);
-    history_delete(code->history.state);
+    free(code->lines.items);
+    texthistory_delete(code->history);
     free(code);
 }
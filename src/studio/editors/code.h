@@ -63,17 +63,30 @@ struct Code
         u8 temp:4;
     }* state;
 
+    // line starts with the lexer state there, only the changed lines are parsed again
+    struct
+    {
+        struct CodeLine
+        {
+            s32 start;
+            u8 lexer;
+            bool changed;
+        }* items;
+
+        s32 count;
+        s32 capacity;
+        s32 changed;
+        s32 size;
+
+        const tic_script_config* config;
+    } lines;
+
     char statusLine[STUDIO_TEXT_BUFFER_WIDTH];
     char statusSize[STUDIO_TEXT_BUFFER_WIDTH];
 
     u32 tickCounter;
 
-    struct
-    {
-        struct History* code;
-        struct History* cursor;
-        struct History* state;
-    } history;
+    struct TextHistory* history;
 
     enum
     {
@@ -46,6 +46,7 @@
 
 #if defined(__TIC_WINDOWS__)
 #include <direct.h>
+#include <io.h>
 #include <windows.h>
 #else
 #include <unistd.h>
@@ -621,6 +622,59 @@ bool fs_write(const char* name, const void* buffer, s32 size)
 #endif
 }
 
+// writes a temp file and renames it over the target, so the old file
+// stays in place if we crash in the middle of the write
+bool fs_write_atomic(const char* name, const void* buffer, s32 size)
+{
+#if defined(BAREMETALPI)
+    // FatFs can't rename over an existing file
+    return fs_write(name, buffer, size);
+#else
+    char temp[TICNAME_MAX + 4];
+    snprintf(temp, sizeof temp, "%s.tmp", name);
+
+    const FsString* tempString = utf8ToString(temp);
+    FILE* file = tic_fopen(tempString, _S("wb"));
+    bool done = false;
+
+    if(file)
+    {
+        done = fwrite(buffer, 1, size, file) == size && fflush(file) == 0;
+
+#if defined(__TIC_WINDOWS__)
+        done = done && _commit(_fileno(file)) == 0;
+#elif !defined(__EMSCRIPTEN__)
+        done = done && fsync(fileno(file)) == 0;
+#endif
+
+        done = fclose(file) == 0 && done;
+
+        if(done)
+        {
+            const FsString* pathString = utf8ToString(name);
+
+#if defined(__TIC_WINDOWS__)
+            done = MoveFileExW(tempString, pathString, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH);
+#else
+            done = rename(tempString, pathString) == 0;
+#endif
+            freeString(pathString);
+        }
+
+        if(!done)
+            tic_remove(tempString);
+    }
+
+    freeString(tempString);
+
+#if defined(__EMSCRIPTEN__)
+    syncfs();
+#endif
+
+    return done;
+#endif
+}
+
 void* fs_read(const char* path, s32* size)
 {
 #if defined(BAREMETALPI)
@@ -665,6 +719,23 @@ void* fs_read(const char* path, s32* size)
 #endif
 }
 
+FILE* fs_open(const char* path, const char* mode)
+{
+#if defined(BAREMETALPI)
+    dbg("fs_open %s\n", path);
+    // TODO BAREMETALPI
+    return NULL;
+#else
+    const FsString* pathString = utf8ToString(path);
+    const FsString* modeString = utf8ToString(mode);
+    FILE* file = tic_fopen(pathString, modeString);
+    freeString(modeString);
+    freeString(pathString);
+
+    return file;
+#endif
+}
+
 bool fs_exists(const char* name)
 {
 #if defined(BAREMETALPI)
@@ -711,6 +782,25 @@ u64 fs_date(const char* path)
 #endif
 }
 
+s32 fs_size(const char* path)
+{
+#if defined(BAREMETALPI)
+    dbg("fs_size %s\n", path);
+    FILINFO s;
+
+    FRESULT res = f_stat(path, &s);
+    return res == FR_OK ? s.fsize : -1;
+#else
+    struct tic_stat_struct s;
+
+    const FsString* pathString = utf8ToString(path);
+    s32 ret = tic_stat(pathString, &s);
+    freeString(pathString);
+
+    return ret == 0 && S_ISREG(s.st_mode) ? (s32)s.st_size : -1;
+#endif
+}
+
 bool tic_fs_save(tic_fs* fs, const char* name, const void* data, s32 size, bool overwrite)
 {
     if(!overwrite)
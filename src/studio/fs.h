@@ -23,6 +23,7 @@
 #pragma once
 
 #include <tic80_types.h>
+#include <stdio.h>
 #include <string.h>
 
 typedef bool(*fs_list_callback)(const char* name, const char* info, s32 id, void* data, bool dir);
@@ -57,6 +58,9 @@ void    tic_fs_dirback      (tic_fs* fs);
 void    tic_fs_homedir      (tic_fs* fs);
 
 u64     fs_date     (const char* name);
+s32     fs_size     (const char* name);
+FILE*   fs_open     (const char* path, const char* mode);
 bool    fs_exists   (const char* name);
 void*   fs_read     (const char* path, s32* size);
 bool    fs_write    (const char* path, const void* data, s32 size);
+bool    fs_write_atomic(const char* path, const void* data, s32 size);
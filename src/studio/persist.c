@@ -0,0 +1,336 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include "persist.h"
+#include "system.h"
+#include "fs.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+
+#if defined(__EMSCRIPTEN__) || defined(BAREMETALPI) || defined(_3DS)
+
+// no threads here, the pending data is written from the tick
+#define PERSIST_SYNC
+
+#else
+
+#include "ext/thread.h"
+
+#endif
+
+// appended to the data, 'TICP' and crc32 of the data, both little endian
+#define PERSIST_MAGIC 0x50434954
+enum {FooterSize = sizeof(u32) * 2};
+
+typedef struct
+{
+    char path[TICNAME_MAX];
+    u8* data;
+    s32 size;
+    s32 capacity;
+} File;
+
+struct tic_persist
+{
+    u32 interval;
+    u64 last;
+
+    // the latest data, not written yet
+    File pending;
+    bool dirty;
+
+#if !defined(PERSIST_SYNC)
+    Mutex lock;
+    Cond cond;
+    Thread thread;
+
+    // the thread's copy with the footer, written outside the lock
+    File current;
+    bool request;
+    bool busy;
+    bool quit;
+#endif
+};
+
+static void writeU32(u8* ptr, u32 value)
+{
+    for(s32 i = 0; i < 4; i++)
+        ptr[i] = value >> (i * 8);
+}
+
+static u32 readU32(const u8* ptr)
+{
+    return ptr[0] | ptr[1] << 8 | ptr[2] << 16 | (u32)ptr[3] << 24;
+}
+
+static bool reserve(File* file, s32 size)
+{
+    if(size > file->capacity)
+    {
+        u8* data = realloc(file->data, size);
+
+        if(!data)
+            return false;
+
+        file->data = data;
+        file->capacity = size;
+    }
+
+    return true;
+}
+
+static void writeFile(File* file)
+{
+    u8* footer = file->data + file->size;
+
+    writeU32(footer, PERSIST_MAGIC);
+    writeU32(footer + sizeof(u32), crc32(0, file->data, file->size));
+
+    fs_write_atomic(file->path, file->data, file->size + FooterSize);
+}
+
+#if defined(PERSIST_SYNC)
+
+static void writePending(tic_persist* persist)
+{
+    if(persist->dirty)
+    {
+        writeFile(&persist->pending);
+        persist->dirty = false;
+    }
+}
+
+#else
+
+static void work(tic_persist* persist)
+{
+    mutex_lock(&persist->lock);
+
+    for(;;)
+    {
+        while(!persist->request && !persist->quit)
+            cond_wait(&persist->cond, &persist->lock);
+
+        persist->request = false;
+
+        if(persist->dirty)
+        {
+            File* pending = &persist->pending;
+            File* current = &persist->current;
+
+            if(reserve(current, pending->size + FooterSize))
+            {
+                strcpy(current->path, pending->path);
+                memcpy(current->data, pending->data, pending->size);
+                current->size = pending->size;
+
+                persist->dirty = false;
+                persist->busy = true;
+
+                mutex_unlock(&persist->lock);
+                writeFile(current);
+                mutex_lock(&persist->lock);
+
+                persist->busy = false;
+            }
+            else persist->dirty = false;
+
+            cond_broadcast(&persist->cond);
+        }
+        else if(persist->quit) break;
+    }
+
+    mutex_unlock(&persist->lock);
+}
+
+THREAD_ENTRY(persistThread, work)
+
+static bool startThread(tic_persist* persist)
+{
+    return thread_start(&persist->thread, persistThread, persist);
+}
+
+static void joinThread(tic_persist* persist)
+{
+    thread_join(&persist->thread);
+}
+
+// wakes the thread up, the lock must be held
+static void requestWrite(tic_persist* persist)
+{
+    persist->request = true;
+    cond_broadcast(&persist->cond);
+}
+
+#endif
+
+tic_persist* tic_persist_create(u32 interval)
+{
+    tic_persist* persist = calloc(1, sizeof(tic_persist));
+
+    if(persist)
+    {
+        persist->interval = interval;
+
+#if !defined(PERSIST_SYNC)
+        mutex_init(&persist->lock);
+        cond_init(&persist->cond);
+
+        if(!startThread(persist))
+        {
+            cond_destroy(&persist->cond);
+            mutex_destroy(&persist->lock);
+            free(persist);
+            return NULL;
+        }
+#endif
+    }
+
+    return persist;
+}
+
+static inline void lock(tic_persist* persist)
+{
+#if !defined(PERSIST_SYNC)
+    mutex_lock(&persist->lock);
+#endif
+}
+
+static inline void unlock(tic_persist* persist)
+{
+#if !defined(PERSIST_SYNC)
+    mutex_unlock(&persist->lock);
+#endif
+}
+
+void tic_persist_write(tic_persist* persist, const char* path, const void* data, s32 size)
+{
+    lock(persist);
+
+    // another file is going to be replaced, the previous one goes first
+    if(persist->dirty && strcmp(persist->pending.path, path))
+    {
+        unlock(persist);
+        tic_persist_flush(persist);
+        lock(persist);
+    }
+
+    File* pending = &persist->pending;
+
+    if(reserve(pending, size + FooterSize))
+    {
+        snprintf(pending->path, sizeof pending->path, "%s", path);
+        memcpy(pending->data, data, size);
+        pending->size = size;
+        persist->dirty = true;
+    }
+
+    unlock(persist);
+}
+
+void tic_persist_tick(tic_persist* persist)
+{
+    u64 now = tic_sys_counter_get();
+
+    // the interval is counted from the previous write, a single change is written right away
+    if((now - persist->last) * 1000 < persist->interval * tic_sys_freq_get())
+        return;
+
+    lock(persist);
+
+    if(persist->dirty)
+    {
+        persist->last = now;
+
+#if defined(PERSIST_SYNC)
+        writePending(persist);
+#else
+        requestWrite(persist);
+#endif
+    }
+
+    unlock(persist);
+}
+
+void tic_persist_flush(tic_persist* persist)
+{
+#if defined(PERSIST_SYNC)
+    writePending(persist);
+#else
+    mutex_lock(&persist->lock);
+
+    if(persist->dirty)
+        requestWrite(persist);
+
+    while(persist->dirty || persist->busy)
+        cond_wait(&persist->cond, &persist->lock);
+
+    mutex_unlock(&persist->lock);
+#endif
+}
+
+void tic_persist_close(tic_persist* persist)
+{
+    tic_persist_flush(persist);
+
+#if !defined(PERSIST_SYNC)
+    mutex_lock(&persist->lock);
+    persist->quit = true;
+    cond_broadcast(&persist->cond);
+    mutex_unlock(&persist->lock);
+
+    joinThread(persist);
+
+    cond_destroy(&persist->cond);
+    mutex_destroy(&persist->lock);
+    free(persist->current.data);
+#endif
+
+    free(persist->pending.data);
+    free(persist);
+}
+
+void* tic_persist_read(const char* path, s32* size)
+{
+    u8* data = fs_read(path, size);
+
+    if(data && *size >= FooterSize)
+    {
+        const u8* footer = data + *size - FooterSize;
+
+        if(readU32(footer) == PERSIST_MAGIC)
+        {
+            *size -= FooterSize;
+
+            if(readU32(footer + sizeof(u32)) != (u32)crc32(0, data, *size))
+            {
+                free(data);
+                return NULL;
+            }
+        }
+    }
+
+    return data;
+}
@@ -0,0 +1,40 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#pragma once
+
+#include <tic80_types.h>
+
+// write-behind cache for the files rewritten every frame (pmem saves),
+// the latest data is written at most once per interval by a background
+// thread, the file is replaced atomically and carries a checksum
+typedef struct tic_persist tic_persist;
+
+tic_persist*    tic_persist_create  (u32 interval);
+void            tic_persist_write   (tic_persist* persist, const char* path, const void* data, s32 size);
+void            tic_persist_tick    (tic_persist* persist);
+void            tic_persist_flush   (tic_persist* persist);
+void            tic_persist_close   (tic_persist* persist);
+
+// reads a file written by the cache, NULL if the checksum doesn't match,
+// files without a checksum are read as they are
+void*           tic_persist_read    (const char* path, s32* size);
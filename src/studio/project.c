@@ -48,23 +48,69 @@ static void makeTag(const char* tag, char* out, s32 bank)
     else strcpy(out, tag);
 }
 
-static void buf2str(const void* data, s32 size, char* ptr, bool flip)
+typedef struct
 {
-    enum {Len = 2};
+    tic_project_write write;
+    void* data;
+    s32 size;
+    bool failed;
 
-    for(s32 i = 0; i < size; i++, ptr+=Len)
-    {
-        sprintf(ptr, "%02x", ((u8*)data)[i]);
+    s32 pos;
+    char buffer[4096];
+} ProjectWriter;
 
-        if(flip)
-        {
-            char tmp = ptr[0];
-            ptr[0] = ptr[1];
-            ptr[1] = tmp;
-        }
+static void flushWriter(ProjectWriter* writer)
+{
+    if(writer->pos && !writer->failed && !writer->write(writer->buffer, writer->pos, writer->data))
+        writer->failed = true;
+
+    writer->size += writer->pos;
+    writer->pos = 0;
+}
+
+// reserves room for the next len chars, len must fit the buffer
+static char* reserveWriter(ProjectWriter* writer, s32 len)
+{
+    if(writer->pos + len > sizeof writer->buffer)
+        flushWriter(writer);
+
+    char* ptr = writer->buffer + writer->pos;
+    writer->pos += len;
+
+    return ptr;
+}
+
+static void writeString(ProjectWriter* writer, const char* str, s32 len)
+{
+    while(len)
+    {
+        s32 chunk = MIN(len, (s32)sizeof writer->buffer);
+        memcpy(reserveWriter(writer, chunk), str, chunk);
+        str += chunk;
+        len -= chunk;
     }
 }
 
+static void writeText(ProjectWriter* writer, const char* str)
+{
+    writeString(writer, str, (s32)strlen(str));
+}
+
+static void buf2str(const void* data, s32 size, char* ptr, bool flip)
+{
+    static const char Hex[] = "0123456789abcdef";
+
+    const u8* src = data;
+    const u8* end = src + size;
+
+    if(flip)
+        for(; src < end; src++)
+            *ptr++ = Hex[*src & 0xf], *ptr++ = Hex[*src >> 4];
+    else
+        for(; src < end; src++)
+            *ptr++ = Hex[*src >> 4], *ptr++ = Hex[*src & 0xf];
+}
+
 static bool bufferEmpty(const u8* data, s32 size)
 {
     for(s32 i = 0; i < size; i++)
@@ -74,49 +120,61 @@ static bool bufferEmpty(const u8* data, s32 size)
     return true;
 }
 
-static char* saveTextSection(char* ptr, const char* data)
+static void saveTextSection(ProjectWriter* writer, const char* data)
 {
     if(data[0] == '\0')
-        return ptr;
-
-    sprintf(ptr, "%s\n", data);
-    ptr += strlen(ptr);
+        return;
 
-    return ptr;
+    writeText(writer, data);
+    writeString(writer, "\n", 1);
 }
 
-static char* saveBinaryBuffer(char* ptr, const char* comment, const void* data, s32 size, s32 row, bool flip)
+static void saveBinaryBuffer(ProjectWriter* writer, const char* comment, const void* data, s32 size, s32 row, bool flip)
 {
     if(bufferEmpty(data, size)) 
-        return ptr;
+        return;
 
-    sprintf(ptr, "%s %03i:", comment, row);
-    ptr += strlen(ptr);
+    // "-- 999:" row prefix
+    {
+        char* ptr = reserveWriter(writer, sizeof("-- 999:") - 1);
+        ptr[0] = comment[0];
+        ptr[1] = comment[1];
+        ptr[2] = ' ';
+        ptr[3] = '0' + row / 100 % 10;
+        ptr[4] = '0' + row / 10 % 10;
+        ptr[5] = '0' + row % 10;
+        ptr[6] = ':';
+    }
 
-    buf2str(data, size, ptr, flip);
-    ptr += strlen(ptr);
+    // rows longer than the buffer only come from the cover
+    enum {Chunk = sizeof writer->buffer / 2};
 
-    sprintf(ptr, "\n");
-    ptr += strlen(ptr);
+    for(s32 i = 0; i < size; i += Chunk)
+    {
+        s32 len = MIN(size - i, Chunk);
+        buf2str((const u8*)data + i, len, reserveWriter(writer, len * 2), flip);
+    }
 
-    return ptr;
+    writeString(writer, "\n", 1);
 }
 
-static char* saveBinarySection(char* ptr, const char* comment, const char* tag, s32 count, const void* data, s32 size, bool flip)
+static void saveBinarySection(ProjectWriter* writer, const char* comment, const char* tag, s32 count, const void* data, s32 size, bool flip)
 {
     if(bufferEmpty(data, size * count)) 
-        return ptr;
+        return;
 
-    sprintf(ptr, "%s <%s>\n", comment, tag);
-    ptr += strlen(ptr);
+    writeText(writer, comment);
+    writeString(writer, " <", 2);
+    writeText(writer, tag);
+    writeString(writer, ">\n", 2);
 
     for(s32 i = 0; i < count; i++, data = (u8*)data + size)
-        ptr = saveBinaryBuffer(ptr, comment, data, size, i, flip);
-
-    sprintf(ptr, "%s </%s>\n\n", comment, tag);
-    ptr += strlen(ptr);
+        saveBinaryBuffer(writer, comment, data, size, i, flip);
 
-    return ptr;
+    writeText(writer, comment);
+    writeString(writer, " </", 3);
+    writeText(writer, tag);
+    writeString(writer, ">\n\n", 3);
 }
 
 static const char* projectComment(const char* name)
@@ -135,13 +193,14 @@ static const char* projectComment(const char* name)
     return comment;
 }
 
-s32 tic_project_save(const char* name, void* data, const tic_cartridge* cart)
+s32 tic_project_write_stream(const char* name, const tic_cartridge* cart, tic_project_write write, void* data)
 {
-	const char* comment = projectComment(name);
-    char* stream = data;
-    char* ptr = saveTextSection(stream, cart->code.data);
+    const char* comment = projectComment(name);
+    ProjectWriter writer = {.write = write, .data = data};
     char tag[16];
 
+    saveTextSection(&writer, cart->code.data);
+
     for(s32 i = 0; i < COUNT_OF(BinarySections); i++)
     {
         const struct BinarySection* section = &BinarySections[i];
@@ -150,14 +209,34 @@ s32 tic_project_save(const char* name, void* data, const tic_cartridge* cart)
         {
             makeTag(section->tag, tag, b);
 
-            ptr = saveBinarySection(ptr, comment, tag, section->count, 
+            saveBinarySection(&writer, comment, tag, section->count, 
                 (u8*)&cart->banks[b] + section->offset, section->size, section->flip);
         }
     }
 
-    saveBinarySection(ptr, comment, "COVER", 1, &cart->cover, cart->cover.size + sizeof(s32), true);
+    saveBinarySection(&writer, comment, "COVER", 1, &cart->cover, cart->cover.size + sizeof(s32), true);
+
+    flushWriter(&writer);
+
+    return writer.failed ? -1 : writer.size;
+}
+
+static bool writeMemory(const void* buffer, s32 size, void* data)
+{
+    char** ptr = data;
+    memcpy(*ptr, buffer, size);
+    *ptr += size;
 
-    return (s32)strlen(stream);
+    return true;
+}
+
+s32 tic_project_save(const char* name, void* data, const tic_cartridge* cart)
+{
+    char* ptr = data;
+    s32 size = tic_project_write_stream(name, cart, writeMemory, &ptr);
+    *ptr = '\0';
+
+    return size;
 }
 
 static bool loadTextSection(const char* project, const char* comment, char* dst, s32 size)
@@ -193,57 +272,121 @@ static inline const char* getLineEnd(const char* ptr)
     return ptr;
 }
 
-static bool loadBinarySection(const char* project, const char* comment, const char* tag, s32 count, void* dst, s32 size, bool flip)
+static void loadBinarySection(const char* start, const char* end, s32 count, void* dst, s32 size, bool flip)
 {
-    char tagbuf[64];
-    sprintf(tagbuf, "%s <%s>", comment, tag);
+    const char* ptr = start;
 
-    const char* start = strstr(project, tagbuf);
-    bool done = false;
+    if(size > 0)
+    {
+        while(ptr < end)
+        {
+            char lineStr[] = "999";
+            memcpy(lineStr, ptr + sizeof("-- ") - 1, sizeof lineStr - 1);
+
+            s32 index = atoi(lineStr);
+            
+            if(index < count)
+            {
+                ptr += sizeof("-- 999:") - 1;
+                tic_tool_str2buf(ptr, (s32)MIN(size*2, end - ptr), (u8*)dst + size*index, flip);
+                ptr += size*2 + 1;
+
+                if(ptr >= end) break;
+
+                ptr = getLineEnd(ptr);
+            }
+            else break;
+        }               
+    }
+    else
+    {
+        ptr += sizeof("-- 999:") - 1;
+        tic_tool_str2buf(ptr, (s32)(end - ptr), (u8*)dst, flip);
+    }
+}
 
-    if(start)
+// finds the section and the bank by the tag name, the cover is returned as section -1
+static bool findBinarySection(const char* tag, s32 len, s32* section, s32* bank)
+{
+    if(len == sizeof "COVER" - 1 && memcmp(tag, "COVER", len) == 0)
     {
-        start += strlen(tagbuf);
-        start = getLineEnd(start);
+        *section = -1;
+        *bank = 0;
+        return true;
+    }
+
+    *bank = 0;
 
-        sprintf(tagbuf, "\n%s </%s>", comment, tag);
-        const char* end = strstr(start, tagbuf);
+    if(len > 1 && tag[len - 1] >= '1' && tag[len - 1] < '0' + TIC_BANKS)
+        *bank = tag[--len] - '0';
 
-        if(end > start)
+    for(s32 i = 0; i < COUNT_OF(BinarySections); i++)
+    {
+        const char* name = BinarySections[i].tag;
+
+        if(strncmp(name, tag, len) == 0 && name[len] == '\0')
         {
-            const char* ptr = start;
+            *section = i;
+            return true;
+        }
+    }
 
-            if(size > 0)
-            {
-                while(ptr < end)
+    return false;
+}
+
+// loads every <TAG> block in one sweep over the lines,
+// the first block of a tag wins
+static void loadBinarySections(const char* project, const char* comment, tic_cartridge* cart)
+{
+    bool loaded[COUNT_OF(BinarySections)][TIC_BANKS] = {{false}};
+    bool coverLoaded = false;
+    s32 commentLen = (s32)strlen(comment);
+
+    for(const char* ptr = project; *ptr;)
+    {
+        const char* tag = ptr + commentLen + sizeof(" <") - 1;
+        const char* tagEnd = NULL;
+
+        if(strncmp(ptr, comment, commentLen) == 0 && tag[-2] == ' ' && tag[-1] == '<')
+            for(const char* c = tag; *c && *c != '\n' && c - tag < 16; c++)
+                if(*c == '>')
                 {
-                    static char lineStr[] = "999";
-                    memcpy(lineStr, ptr + sizeof("-- ") - 1, sizeof lineStr - 1);
-
-                    s32 index = atoi(lineStr);
-                    
-                    if(index < count)
-                    {
-                        ptr += sizeof("-- 999:") - 1;
-                        tic_tool_str2buf(ptr, size*2, (u8*)dst + size*index, flip);
-                        ptr += size*2 + 1;
-
-                        ptr = getLineEnd(ptr);
-                    }
-                    else break;
-                }               
-            }
-            else
+                    tagEnd = c;
+                    break;
+                }
+
+        s32 section, bank;
+
+        if(tagEnd && findBinarySection(tag, (s32)(tagEnd - tag), &section, &bank)
+            && !(section < 0 ? coverLoaded : loaded[section][bank]))
+        {
+            char tagbuf[64];
+            sprintf(tagbuf, "\n%s </%.*s>", comment, (s32)(tagEnd - tag), tag);
+
+            const char* start = getLineEnd(tagEnd + 1);
+            const char* end = strstr(start, tagbuf);
+
+            if(end > start)
             {
-                ptr += sizeof("-- 999:") - 1;
-                tic_tool_str2buf(ptr, (s32)(end - ptr), (u8*)dst, flip);
-            }
+                if(section < 0)
+                {
+                    loadBinarySection(start, end, 1, &cart->cover, -1, true);
+                    coverLoaded = true;
+                }
+                else
+                {
+                    const struct BinarySection* s = &BinarySections[section];
+                    loadBinarySection(start, end, s->count, (u8*)&cart->banks[bank] + s->offset, s->size, s->flip);
+                    loaded[section][bank] = true;
+                }
 
-            done = true;
+                ptr = end + 1;
+            }
         }
-    }
 
-    return done;
+        // next line
+        while(*ptr && *ptr++ != '\n');
+    }
 }
 
 bool tic_project_load(const char* name, const char* data, s32 size, tic_cartridge* dst)
@@ -268,32 +411,13 @@ bool tic_project_load(const char* name, const char* data, s32 size, tic_cartridg
         if(cart)
         {
             const char* comment = projectComment(name);
-            char tag[16];
 
             if(loadTextSection(project, comment, cart->code.data, sizeof(tic_code)))
-                done = true;
-
-            if(done)
             {
-                for(s32 i = 0; i < COUNT_OF(BinarySections); i++)
-                {
-                    const struct BinarySection* section = &BinarySections[i];
-
-                    for(s32 b = 0; b < TIC_BANKS; b++)
-                    {
-                        makeTag(section->tag, tag, b);
-
-                        if(loadBinarySection(project, comment, tag, section->count, (u8*)&cart->banks[b] + section->offset, section->size, section->flip))
-                            done = true;
-                    }
-                }
-
-                if(loadBinarySection(project, comment, "COVER", 1, &cart->cover, -1, true))
-                    done = true;
-            }
-            
-            if(done)
+                loadBinarySections(project, comment, cart);
                 memcpy(dst, cart, sizeof(tic_cartridge));
+                done = true;
+            }
 
             free(cart);
         }
@@ -33,3 +33,9 @@
 
 bool tic_project_load(const char* name, const char* data, s32 size, tic_cartridge* dst);
 s32 tic_project_save(const char* name, void* data, const tic_cartridge* cart);
+
+// receives the project text in chunks as it's produced, returns false on failure
+typedef bool(*tic_project_write)(const void* buffer, s32 size, void* data);
+
+// returns the project size or -1 if the writer failed
+s32 tic_project_write_stream(const char* name, const tic_cartridge* cart, tic_project_write write, void* data);
@@ -416,7 +416,7 @@ static bool onConsoleLoadSectionCommand(Console* console, const char* param)
                     if(cart)
                     {
                         tic_mem* tic = console->tic;
-                        tic_cart_load(cart, data, size);
+                        tic_cart_load_parts(cart, data, size, i == 0 ? tic_cart_cover : i == 3 ? tic_cart_code : tic_cart_bank0);
 
                         switch(i)
                         {
@@ -2266,6 +2266,22 @@ static void onConsoleRamCommand(Console* console, const char* param)
     commandDone(console);
 }
 
+static void onConsoleAudioCommand(Console* console, const char* param)
+{
+    tic_audio_stats stats;
+
+    if(tic_sys_audio_stats(&stats))
+    {
+        char buf[STUDIO_TEXT_BUFFER_WIDTH * 4];
+        sprintf(buf, "\nlatency: %ims (target %ims)\nunderruns: %u\noverruns: %u", 
+            stats.latency, stats.target, stats.underruns, stats.overruns);
+        printBack(console, buf);
+    }
+    else printBack(console, "\naudio stats aren't available");
+
+    commandDone(console);
+}
+
 static void onConsoleVRamCommand(Console* console, const char* param)
 {
     printLine(console);
@@ -2298,6 +2314,94 @@ static void onConsoleVRamCommand(Console* console, const char* param)
     commandDone(console);
 }
 
+static void printPerfInfo(Console* console, const char* name, const tic_perf_counter* counter, u64 frames)
+{
+    char buf[STUDIO_TEXT_BUFFER_WIDTH * 2];
+    sprintf(buf, "\n| %-6s | %7.0f | %6.2f | %7.0f |", name, (double)counter->calls,
+        frames ? counter->ns / 1e6 / frames : 0.0,
+        counter->calls ? (double)counter->ns / counter->calls : 0.0);
+    printTable(console, buf);
+}
+
+static void onConsolePerfCommand(Console* console, const char* param)
+{
+    tic_mem* tic = console->tic;
+
+    if(param == NULL)
+    {
+        const tic_perf_stats* stats = tic_core_perf_stats(tic);
+
+        if(!stats)
+        {
+            printBack(console, "\nprofiler is off, use 'perf on' and run the cart");
+            commandDone(console);
+            return;
+        }
+
+        printLine(console);
+
+        printTable(console, "\n+-------------------------------------+" \
+                            "\n|   PROFILE (TIMES ARE INCLUSIVE)     |" \
+                            "\n+--------+---------+--------+---------+" \
+                            "\n| NAME   |   CALLS |  MS/FR | NS/CALL |" \
+                            "\n+--------+---------+--------+---------+");
+
+        for(s32 i = 0; i < tic_perf_phases_count; i++)
+            printPerfInfo(console, tic_core_perf_phase_name(i), &stats->phases[i], stats->frames);
+
+        printTable(console, "\n+--------+---------+--------+---------+");
+
+        for(s32 i = 0; i < tic_api_count; i++)
+            if(stats->api[i].calls)
+                printPerfInfo(console, tic_core_perf_api_name(i), &stats->api[i], stats->frames);
+
+        printTable(console, "\n+--------+---------+--------+---------+");
+
+        printLine(console);
+    }
+    else if(strcmp(param, "on") == 0)
+    {
+        tic_core_perf_enable(tic, true);
+        printBack(console, "\nprofiler is on, API calls are counted from the next run");
+    }
+    else if(strcmp(param, "off") == 0)
+    {
+        tic_core_perf_enable(tic, false);
+        printBack(console, "\nprofiler is off");
+    }
+    else if(strcmp(param, "reset") == 0)
+    {
+        tic_core_perf_reset(tic);
+        printBack(console, "\nprofiler counters reset");
+    }
+    else if(strncmp(param, "trace ", sizeof "trace " - 1) == 0)
+    {
+        const char* name = param + sizeof "trace " - 1;
+        s32 size = 0;
+        char* data = tic_core_perf_trace(tic, &size);
+
+        if(data)
+        {
+            if(tic_fs_save(console->fs, name, data, size, true))
+            {
+                printFront(console, "\n");
+                printFront(console, name);
+                printBack(console, " saved, open it in chrome://tracing");
+            }
+            else printError(console, "\ntrace saving error :(");
+
+            free(data);
+        }
+        else printError(console, "\nprofiler is off");
+    }
+    else
+    {
+        printError(console, "\nusage: perf [on|off|reset|trace <file>]");
+    }
+
+    commandDone(console);
+}
+
 #if defined(CAN_ADDGET_FILE)
 
 static void onConsoleAddFile(Console* console, const char* name, const u8* buffer, s32 size)
@@ -2401,6 +2505,8 @@ static const struct
     {"help",    NULL, "show this info",             onConsoleHelpCommand},
     {"ram",     NULL, "show 96KB RAM layout",        onConsoleRamCommand},
     {"vram",    NULL, "show 16KB VRAM layout",       onConsoleVRamCommand},
+    {"perf",    NULL, "profile API calls and frame", onConsolePerfCommand},
+    {"audio",   NULL, "show audio buffer stats",    onConsoleAudioCommand},
     {"exit",    "quit", "exit the application",     onConsoleExitCommand},
     {"new",     NULL, "create new cart",            onConsoleNewCommand},
     {"load",    NULL, "load cart",                  onConsoleLoadCommand},
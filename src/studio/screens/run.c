@@ -26,6 +26,8 @@
 #include "ext/md5.h"
 #include <time.h>
 
+#define PMEM_SAVE_INTERVAL 1000 // ms
+
 static void onTrace(void* data, const char* text, u8 color)
 {
     Run* run = (Run*)data;
@@ -103,16 +105,29 @@ static void tick(Run* run)
 
     tic_mem* tic = run->tic;
 
+    run->rewinding = tic_api_key(tic, tic_key_f10) && tic_core_rewind_step(tic);
+
+    if(run->rewinding)
+        return;
+
     tic_core_tick(tic, &run->tickData);
 
     enum {Size = sizeof(tic_persistent)};
 
     if(memcmp(run->pmem.data, tic->ram.persistent.data, Size))
     {
-        tic_fs_saveroot(run->console->fs, run->saveid, &tic->ram.persistent, Size, true);
+        // without the write-behind thread the save goes to disk right away
+        if(run->persist)
+            tic_persist_write(run->persist, tic_fs_pathroot(run->console->fs, run->saveid), &tic->ram.persistent, Size);
+        else
+            tic_fs_saveroot(run->console->fs, run->saveid, &tic->ram.persistent, Size, true);
+
         memcpy(run->pmem.data, tic->ram.persistent.data, Size);
     }
 
+    if(run->persist)
+        tic_persist_tick(run->persist);
+
     if(run->exit)
         setStudioMode(TIC_CONSOLE_MODE);
 }
@@ -136,14 +151,42 @@ static u64 getCounter(void* data)
     return tic_sys_counter_get();
 }
 
+static void transpiledPath(char* path, s32 size, const char* name)
+{
+    snprintf(path, size, TIC_LOCAL_VERSION "%s.lua", name);
+}
+
+static void* cacheLoad(void* data, const char* name, s32* size)
+{
+    char path[TICNAME_MAX];
+    transpiledPath(path, sizeof path, name);
+
+    return tic_fs_loadroot(((Run*)data)->console->fs, path, size);
+}
+
+static void cacheSave(void* data, const char* name, const void* buffer, s32 size)
+{
+    char path[TICNAME_MAX];
+    transpiledPath(path, sizeof path, name);
+
+    tic_fs_saveroot(((Run*)data)->console->fs, path, buffer, size, true);
+}
+
 void initRun(Run* run, Console* console, tic_mem* tic)
 {
+    tic_persist* persist = run->persist ? run->persist : tic_persist_create(PMEM_SAVE_INTERVAL);
+
+    // the save has to be on disk before it's loaded again
+    if(persist)
+        tic_persist_flush(persist);
+
     *run = (Run)
     {
         .tic = tic,
         .console = console,
         .tick = tick,
         .exit = false,
+        .persist = persist,
         .tickData = 
         {
             .error = onError,
@@ -154,6 +197,8 @@ void initRun(Run* run, Console* console, tic_mem* tic)
             .data = run,
             .exit = onExit,
             .forceExit = forceExit,
+            .cacheLoad = cacheLoad,
+            .cacheSave = cacheSave,
         },
     };
 
@@ -164,7 +209,7 @@ void initRun(Run* run, Console* console, tic_mem* tic)
         initPMemName(run);
 
         s32 size = 0;
-        void* data = tic_fs_loadroot(run->console->fs, run->saveid, &size);
+        void* data = tic_persist_read(tic_fs_pathroot(run->console->fs, run->saveid), &size);
 
         if(data)
         {
@@ -176,10 +221,22 @@ void initRun(Run* run, Console* console, tic_mem* tic)
         memcpy(run->pmem.data, tic->ram.persistent.data, Size);
     }
 
+    // every run starts with an empty history
+    tic_core_rewind_init(tic, getConfig()->rewind << 20);
+
     tic_sys_preseed();
 }
 
+void flushRun(Run* run)
+{
+    if(run->persist)
+        tic_persist_flush(run->persist);
+}
+
 void freeRun(Run* run)
 {
+    if(run->persist)
+        tic_persist_close(run->persist);
+
     free(run);
 }
\ No newline at end of file
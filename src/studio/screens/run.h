@@ -23,6 +23,7 @@
 #pragma once
 
 #include "studio/studio.h"
+#include "studio/persist.h"
 
 typedef struct Run Run;
 
@@ -33,12 +34,19 @@ struct Run
     tic_tick_data tickData;
 
     bool exit;
+
+    // the frame was stepped back instead of run, it isn't pushed to the history
+    bool rewinding;
     
     char saveid[TICNAME_MAX];
     tic_persistent pmem;
 
+    // pmem saves are written behind, survives the run restarts
+    tic_persist* persist;
+
     void(*tick)(Run*);
 };
 
 void initRun(Run*, struct Console*, tic_mem*);
+void flushRun(Run* run);
 void freeRun(Run* run);
@@ -25,6 +25,7 @@
 #include "studio/net.h"
 #include "console.h"
 #include "studio/project.h"
+#include "studio/covers.h"
 
 #include "ext/gif.h"
 
@@ -38,6 +39,10 @@
 #define COVER_Y 5
 #define COVER_X (TIC80_WIDTH - COVER_WIDTH - COVER_Y)
 
+// local covers are decoded around the cursor
+#define COVERS_AHEAD 8
+#define COVERS_BEHIND 2
+
 #if defined(__TIC_WINDOWS__) || defined(__TIC_LINUX__) || defined(__TIC_MACOSX__)
 #define CAN_OPEN_URL 1
 #endif
@@ -153,8 +158,7 @@ struct MenuItem
     const char* name;
     const char* hash;
     s32 id;
-    tic_screen* cover;
-    tic_palette* palettes;
+    tic_cover* cover;
 
     bool coverLoading;
     bool dir;
@@ -269,12 +273,12 @@ static void drawCover(Surf* surf, s32 pos, s32 x, s32 y)
 
     enum{Width = TIC80_WIDTH, Height = TIC80_HEIGHT};
 
-    tic_screen* cover = surf->menu.items[pos].cover;
+    tic_cover* cover = surf->menu.items[pos].cover;
 
     if(cover)
     {
         for(s32 yc = 0; yc < Height; yc++)
-            memcpy(tic->ram.vram.screen.data + (yc * TIC80_WIDTH)/2, cover->data + (yc * Width)/2, Width/2);
+            memcpy(tic->ram.vram.screen.data + (yc * TIC80_WIDTH)/2, cover->screen.data + (yc * Width)/2, Width/2);
     }
 }
 
@@ -372,14 +376,11 @@ static void resetMenu(Surf* surf)
             const char* hash = surf->menu.items[i].hash;
             if(hash) free((void*)hash);
 
-            tic_screen* cover = surf->menu.items[i].cover;
+            tic_cover* cover = surf->menu.items[i].cover;
             if(cover) free(cover);
 
             const char* label = surf->menu.items[i].label;
             if(label) free((void*)label);
-
-            tic_palette* palettes = surf->menu.items[i].palettes;
-            if(palettes) free(palettes);
         }
 
         free(surf->menu.items);
@@ -396,64 +397,10 @@ static void updateMenuItemCover(Surf* surf, s32 pos, const u8* cover, s32 size)
 {
     MenuItem* item = &surf->menu.items[pos];
 
-    if((item->cover = malloc(sizeof(tic_screen))))
-    {
-        if((item->palettes = malloc(TIC80_HEIGHT * sizeof(tic_palette))))
-        {
-            gif_image* image = gif_read_data(cover, size);
+    if(item->cover)
+        free(item->cover);
 
-            if(image)
-            {
-                if (image->width == TIC80_WIDTH && image->height == TIC80_HEIGHT)
-                {
-                    for(s32 r = 0; r < TIC80_HEIGHT; r++)
-                    {
-                        tic_palette* palette = &item->palettes[r];
-                        s32 colorIndex = 0;
-
-                        // init first color with default background
-                        palette->colors[0] = *getConfig()->cart->bank0.palette.scn.colors;
-
-                        for(s32 c = 0; c < TIC80_WIDTH; c++)
-                        {
-                            s32 pixel = r * TIC80_WIDTH + c;
-                            const gif_color* rgb = &image->palette[image->buffer[pixel]];
-
-                            s32 color = -1;
-                            for(s32 i = 0; i <= colorIndex; i++)
-                            {
-                                const tic_rgb* palColor = &palette->colors[i];
-                                if(palColor->r == rgb->r
-                                    && palColor->g == rgb->g
-                                    && palColor->b == rgb->b)
-                                {
-                                    color = i;
-                                    break;
-                                }
-                            }
-
-                            if(color < 0)
-                            {
-                                if(colorIndex < TIC_PALETTE_SIZE-1)
-                                {
-                                    tic_rgb* palColor = &palette->colors[color = ++colorIndex];
-
-                                    palColor->r = rgb->r;
-                                    palColor->g = rgb->g;
-                                    palColor->b = rgb->b;
-                                }
-                                else color = tic_tool_find_closest_color(palette->colors, rgb);
-                            }
-
-                            tic_tool_poke4(item->cover->data, pixel, color);
-                        }
-                    }
-                }
-
-                gif_close(image);
-            }           
-        }
-    }
+    item->cover = tic_cover_decode(cover, size, getConfig()->cart->bank0.palette.scn.colors);
 }
 
 typedef struct
@@ -514,53 +461,82 @@ static void requestCover(Surf* surf, MenuItem* item)
     tic_net_get(surf->net, path, coverLoaded, OBJCOPY(coverLoadingData));
 }
 
-static void loadCover(Surf* surf)
+static void loadLocalCovers(Surf* surf)
 {
-    tic_mem* tic = surf->tic;
-    
-    MenuItem* item = &surf->menu.items[surf->menu.pos];
-    
-    if(item->coverLoading)
-        return;
+    s32 pos = surf->menu.pos;
 
-    item->coverLoading = true;
+    tic_covers_focus(surf->covers, pos);
 
-    if(!tic_fs_ispubdir(surf->fs))
+    for(s32 i = MAX(pos - COVERS_BEHIND, 0); i <= MIN(pos + COVERS_AHEAD, surf->menu.count - 1); i++)
     {
+        MenuItem* item = &surf->menu.items[i];
 
-        s32 size = 0;
-        void* data = tic_fs_load(surf->fs, item->name, &size);
-
-        if(data)
+        if(!item->dir && !item->coverLoading)
         {
-            tic_cartridge* cart = (tic_cartridge*)malloc(sizeof(tic_cartridge));
-
-            if(cart)
-            {
+            item->coverLoading = true;
+            tic_covers_request(surf->covers, i, tic_fs_path(surf->fs, item->name));
+        }
+    }
 
-                if(hasProjectExt(item->name))
-                    tic_project_load(item->name, data, size, cart);
-                else
-                    tic_cart_load(cart, data, size);
+    s32 id;
+    tic_cover* cover;
 
-                if(cart->cover.size)
-                    updateMenuItemCover(surf, surf->menu.pos, cart->cover.data, cart->cover.size);
+    if(tic_covers_take(surf->covers, &id, &cover))
+    {
+        if(id < surf->menu.count)
+        {
+            MenuItem* item = &surf->menu.items[id];
 
-                free(cart);
-            }
+            if(item->cover)
+                free(item->cover);
 
-            free(data);
+            item->cover = cover;
         }
+        else free(cover);
     }
-    else if(item->hash && !item->cover)
+}
+
+static void loadCover(Surf* surf)
+{
+    MenuItem* item = &surf->menu.items[surf->menu.pos];
+
+    if(!tic_fs_ispubdir(surf->fs))
+    {
+        if(surf->covers)
+            loadLocalCovers(surf);
+    }
+    else if(!item->coverLoading)
     {
-        requestCover(surf, item);    
+        item->coverLoading = true;
+
+        if(item->hash && !item->cover)
+            requestCover(surf, item);
     }
 }
 
+static void openCovers(Surf* surf)
+{
+    if(!surf->covers)
+        return;
+
+    char dir[TICNAME_MAX];
+    tic_fs_dir(surf->fs, dir);
+
+    // FNV-1a
+    u64 hash = 0xcbf29ce484222325ull;
+    for(const char* ptr = dir; *ptr; ptr++)
+        hash = (hash ^ (u8)*ptr) * 0x100000001b3ull;
+
+    char name[TICNAME_MAX];
+    sprintf(name, TIC_CACHE "covers-%016llx.dat", (unsigned long long)hash);
+
+    tic_covers_open(surf->covers, tic_fs_pathroot(surf->fs, name), getConfig()->cart->bank0.palette.scn.colors);
+}
+
 static void initMenuAsync(Surf* surf, fs_done_callback callback, void* calldata)
 {
     resetMenu(surf);
+    openCovers(surf);
 
     surf->loading = true;
 
@@ -876,8 +852,8 @@ static void scanline(tic_mem* tic, s32 row, void* data)
     {
         const MenuItem* item = &surf->menu.items[surf->menu.pos];
 
-        if(item->palettes)
-            memcpy(&tic->ram.vram.palette, item->palettes + row, sizeof(tic_palette));
+        if(item->cover)
+            memcpy(&tic->ram.vram.palette, item->cover->palettes + row, sizeof(tic_palette));
     }
 }
 
@@ -902,12 +878,18 @@ static void overline(tic_mem* tic, void* data)
 
 void initSurf(Surf* surf, tic_mem* tic, struct Console* console)
 {
+    // the covers thread and its index survive the reinit
+    tic_covers* covers = surf->covers
+        ? surf->covers
+        : tic_covers_create();
+
     *surf = (Surf)
     {
         .tic = tic,
         .console = console,
         .fs = console->fs,
         .net = console->net,
+        .covers = covers,
         .tick = tick,
         .ticks = 0,
         .state = &EmptyState,
@@ -931,5 +913,9 @@ void initSurf(Surf* surf, tic_mem* tic, struct Console* console)
 void freeSurf(Surf* surf)
 {
     resetMenu(surf);
+
+    if(surf->covers)
+        tic_covers_close(surf->covers);
+
     free(surf);
 }
\ No newline at end of file
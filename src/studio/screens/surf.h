@@ -31,6 +31,7 @@ struct Surf
     tic_mem* tic;
     struct tic_fs* fs;
     struct tic_net* net;
+    struct tic_covers* covers;
     struct Console* console;
     struct Movie* state;
 
@@ -54,6 +54,7 @@
 
 #define FRAME_SIZE (TIC80_FULLWIDTH * TIC80_FULLHEIGHT * sizeof(u32))
 #define POPUP_DUR (TIC80_FRAMERATE*2)
+#define MUSIC_EXPORT_FRAMES (TIC80_FRAMERATE * 60 * 10) // tracks with jumps can loop forever
 
 #if defined(TIC80_PRO)
 #define TIC_EDITOR_BANKS (TIC_BANKS)
@@ -329,10 +330,13 @@ const char* studioExportSfx(s32 index, const char* filename)
     return NULL;
 }
 
-const char* studioExportMusic(s32 track, const char* filename)
+static void writeWave(const s16* samples, s32 count, void* data)
 {
-    tic_mem* tic = impl.studio.tic;
+    wave_write(samples, count);
+}
 
+const char* studioExportMusic(s32 track, const char* filename)
+{
     const char* path = tic_fs_path(impl.fs, filename);
 
     if(wave_open( impl.samplerate, path ))
@@ -341,31 +345,26 @@ const char* studioExportMusic(s32 track, const char* filename)
         wave_enable_stereo();
 #endif
 
-        const tic_sfx* sfx = getSfxSrc();
-        const tic_music* music = getMusicSrc();
-
-        sfx2ram(&tic->ram, sfx);
-        music2ram(&tic->ram, music);
-
-        const tic_sound_state* state = &tic->ram.sound_state;
         const Music* editor = impl.banks.music[impl.bank.index.music];
 
-        tic_api_music(tic, track, -1, -1, false, editor->sustain);
-
-        while(state->flag.music_state == tic_music_play)
+        tic_music_render params =
         {
-            tic_core_tick_start(tic);
+            .sfx = getSfxSrc(),
+            .music = getMusicSrc(),
+            .track = track,
+            .sustain = editor->sustain,
+            .frames = MUSIC_EXPORT_FRAMES,
+            .samplerate = impl.samplerate,
+            .write = writeWave,
+        };
 
-            for (s32 i = 0; i < TIC_SOUND_CHANNELS; i++)
-                if(!editor->on[i])
-                    tic->ram.registers[i].volume = 0;
+        for (s32 i = 0; i < TIC_SOUND_CHANNELS; i++)
+            if(!editor->on[i])
+                params.mute |= 1 << i;
 
-            tic_core_tick_end(tic);
+        tic_core_render_music(&params);
 
-            wave_write(tic->samples.buffer, tic->samples.size / sizeof(s16));
-        }
-
-        wave_close();        
+        wave_close();
         return path;
     }
 
@@ -1151,7 +1150,10 @@ void setStudioMode(EditorMode mode)
         EditorMode prev = impl.mode;
 
         if(prev == TIC_RUN_MODE)
+        {
             tic_core_pause(impl.studio.tic);
+            flushRun(impl.run);
+        }
 
         if(mode != TIC_RUN_MODE)
             tic_api_reset(impl.studio.tic);
@@ -1685,8 +1687,12 @@ static void recordFrame(u32* pixels)
 
             if(impl.video.frame % TIC80_FRAMERATE < TIC80_FRAMERATE / 2)
             {
-                const u32* pal = tic_tool_palette_blit(&impl.config->cart.bank0.palette.scn, TIC80_PIXEL_COLOR_RGBA8888);
+                u32 pal[TIC_PALETTE_SIZE];
+                tic_tool_palette_blit(pal, &impl.config->cart.bank0.palette.scn, TIC80_PIXEL_COLOR_RGBA8888);
                 drawRecordLabel(pixels, TIC80_WIDTH-24, 8, &pal[tic_color_red]);
+
+                // the label isn't part of the frame, so the next blit has to cover it again
+                tic_core_invalidate_rows(impl.studio.tic, 8, 5);
             }
 
             impl.video.frame++;
@@ -1803,6 +1809,9 @@ static void renderStudio()
 
     tic_core_tick_end(impl.studio.tic);
 
+    if(impl.mode == TIC_RUN_MODE && !impl.run->rewinding)
+        tic_core_rewind_push(impl.studio.tic);
+
     switch(impl.mode)
     {
     case TIC_RUN_MODE: break;
@@ -2023,6 +2032,7 @@ static StartArgs parseArgs(s32 argc, const char **argv)
         OPT_BOOLEAN('\0',   "crt",          &args.crt,          "enable CRT monitor effect"),
 #endif
         OPT_STRING('\0',    "cmd",          &args.cmd,          "run commands in the console"),
+        OPT_INTEGER('\0',   "rewind",       &args.rewind,       "rewind history size in MB, hold F10 in a game to rewind"),
         OPT_END(),
     };
 
@@ -2101,6 +2111,7 @@ Studio* studioInit(s32 argc, const char **argv, s32 samplerate, const char* fold
 
     impl.config->data.goFullscreen = args.fullscreen;
     impl.config->data.noSound = args.nosound;
+    impl.config->data.rewind = MAX(args.rewind, 0);
 
     impl.studio.tick = studioTick;
     impl.studio.close = studioClose;
@@ -80,6 +80,7 @@ typedef struct
     bool crt;
 #endif
     const char *cmd;
+    s32 rewind;
 } StartArgs;
 
 typedef enum
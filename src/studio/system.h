@@ -64,6 +64,16 @@ void    tic_sys_poll();
 bool    tic_sys_keyboard_text(char* text);
 void    tic_sys_update_config();
 
+typedef struct
+{
+    s32 latency;    // ms of queued audio
+    s32 target;     // ms
+    u32 underruns;
+    u32 overruns;
+} tic_audio_stats;
+
+bool    tic_sys_audio_stats(tic_audio_stats* stats);
+
 typedef struct
 {
     struct
@@ -128,6 +138,9 @@ typedef struct
     
     bool goFullscreen;
 
+    // rewind history size in MB, 0 turns it off
+    s32 rewind;
+
     const tic_cartridge* cart;
 
     s32 uiScale;
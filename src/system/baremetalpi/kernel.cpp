@@ -152,6 +152,11 @@ void tic_sys_update_config()
 
 }
 
+bool tic_sys_audio_stats(tic_audio_stats* stats)
+{
+	return false;
+}
+
 bool tic_sys_keyboard_text(char* text)
 {
 	return false;
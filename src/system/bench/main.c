@@ -0,0 +1,745 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "api.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#define TIC80_EXECUTABLE_NAME "tic80-bench"
+
+// bump it when workloads change, results with different versions aren't comparable
+#define BENCH_VERSION 1
+
+typedef struct
+{
+	s32 i[6];
+	float f[12];
+} Op;
+
+typedef struct
+{
+	const char* name;
+	s32 count;
+
+	// fills the ops and returns pixels they touch, runs before the timer starts
+	double(*prepare)(Op* ops, s32 count);
+	void(*run)(tic_mem* tic, const Op* ops, s32 count);
+} Workload;
+
+static struct
+{
+	u32 seed;
+	s32 repeat;
+	double scale;
+
+	// script bindings mode, per API breakdown from the profiler with calls
+	bool script;
+	bool calls;
+	bool error;
+
+	// the C reference frame state, the scripts keep the same in their globals
+	struct
+	{
+		s32 t;
+		double s;
+	} native;
+} state =
+{
+	.repeat = 5,
+	.scale = 1.0,
+};
+
+static double getTime()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER counter, freq;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&freq);
+	return (double)counter.QuadPart / freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+// LCG with a fixed seed, workloads are the same on every machine and run
+static s32 rnd(s32 from, s32 to)
+{
+	state.seed = state.seed * 1664525 + 1013904223;
+	return from + (s32)((state.seed >> 8) % (u32)(to - from + 1));
+}
+
+static double triangleArea(const float* v)
+{
+	return fabs((v[2] - v[0]) * (v[5] - v[1]) - (v[4] - v[0]) * (v[3] - v[1])) / 2;
+}
+
+static double prepareSprites(Op* ops, s32 count)
+{
+	for(Op* op = ops, *end = ops + count; op != end; op++)
+	{
+		op->i[0] = rnd(0, TIC_BANK_SPRITES * 2 - 1);
+		op->i[1] = rnd(-TIC_SPRITESIZE / 2, TIC80_WIDTH - TIC_SPRITESIZE / 2);
+		op->i[2] = rnd(-TIC_SPRITESIZE / 2, TIC80_HEIGHT - TIC_SPRITESIZE / 2);
+		op->i[3] = rnd(tic_no_flip, tic_horz_flip | tic_vert_flip);
+		op->i[4] = rnd(tic_no_rotate, tic_270_rotate);
+	}
+
+	return (double)count * TIC_SPRITESIZE * TIC_SPRITESIZE;
+}
+
+static void runSprites(tic_mem* tic, const Op* ops, s32 count)
+{
+	u8 colorkey = 0;
+
+	for(const Op* op = ops, *end = ops + count; op != end; op++)
+		tic_api_spr(tic, op->i[0], op->i[1], op->i[2], 1, 1, &colorkey, 1, 1, op->i[3], op->i[4]);
+}
+
+// 2x2 sprites at scale 2, 32x32 pixels each
+static double prepareBigSprites(Op* ops, s32 count)
+{
+	for(Op* op = ops, *end = ops + count; op != end; op++)
+	{
+		op->i[0] = rnd(0, TIC_BANK_SPRITES - 1);
+		op->i[1] = rnd(-16, TIC80_WIDTH - 16);
+		op->i[2] = rnd(-16, TIC80_HEIGHT - 16);
+		op->i[3] = rnd(tic_no_flip, tic_horz_flip | tic_vert_flip);
+		op->i[4] = rnd(tic_no_rotate, tic_270_rotate);
+	}
+
+	return (double)count * 32 * 32;
+}
+
+static void runBigSprites(tic_mem* tic, const Op* ops, s32 count)
+{
+	u8 colorkey = 0;
+
+	for(const Op* op = ops, *end = ops + count; op != end; op++)
+		tic_api_spr(tic, op->i[0], op->i[1], op->i[2], 2, 2, &colorkey, 1, 2, op->i[3], op->i[4]);
+}
+
+// full screen of tiles scrolled by a pixel every op
+static double prepareMap(Op* ops, s32 count)
+{
+	for(s32 i = 0; i < count; i++)
+	{
+		Op* op = ops + i;
+		op->i[0] = i / TIC_SPRITESIZE % (TIC_MAP_WIDTH - TIC_MAP_SCREEN_WIDTH);
+		op->i[1] = i / TIC_SPRITESIZE % (TIC_MAP_HEIGHT - TIC_MAP_SCREEN_HEIGHT);
+		op->i[2] = -(i % TIC_SPRITESIZE);
+	}
+
+	return (double)count * TIC80_WIDTH * TIC80_HEIGHT;
+}
+
+static void runMap(tic_mem* tic, const Op* ops, s32 count)
+{
+	u8 colorkey = 0;
+
+	for(const Op* op = ops, *end = ops + count; op != end; op++)
+		tic_api_map(tic, op->i[0], op->i[1], TIC_MAP_SCREEN_WIDTH + 1, TIC_MAP_SCREEN_HEIGHT + 1, 
+			op->i[2], op->i[2], &colorkey, 1, 1, NULL, NULL);
+}
+
+static double prepareTextri(Op* ops, s32 count)
+{
+	double pixels = 0;
+
+	for(Op* op = ops, *end = ops + count; op != end; op++)
+	{
+		s32 x = rnd(0, TIC80_WIDTH - 1), y = rnd(0, TIC80_HEIGHT - 1);
+
+		for(s32 v = 0; v < 3; v++)
+		{
+			op->f[v * 2 + 0] = (float)(x + rnd(-32, 32));
+			op->f[v * 2 + 1] = (float)(y + rnd(-32, 32));
+			op->f[6 + v * 2 + 0] = (float)rnd(0, TIC_SPRITESHEET_SIZE - 1);
+			op->f[6 + v * 2 + 1] = (float)rnd(0, TIC_SPRITESHEET_SIZE - 1);
+		}
+
+		pixels += triangleArea(op->f);
+	}
+
+	return pixels;
+}
+
+static void runTextri(tic_mem* tic, const Op* ops, s32 count)
+{
+	u8 colorkey = 0;
+
+	for(const Op* op = ops, *end = ops + count; op != end; op++)
+	{
+		const float* f = op->f;
+		tic_api_textri(tic, f[0], f[1], f[2], f[3], f[4], f[5], f[6], f[7], f[8], f[9], f[10], f[11], false, &colorkey, 1);
+	}
+}
+
+static double prepareCirc(Op* ops, s32 count)
+{
+	double pixels = 0;
+
+	for(Op* op = ops, *end = ops + count; op != end; op++)
+	{
+		op->i[0] = rnd(0, TIC80_WIDTH - 1);
+		op->i[1] = rnd(0, TIC80_HEIGHT - 1);
+		op->i[2] = rnd(1, 40);
+		op->i[3] = rnd(1, TIC_PALETTE_SIZE - 1);
+
+		pixels += 3.14159265 * op->i[2] * op->i[2];
+	}
+
+	return pixels;
+}
+
+static void runCirc(tic_mem* tic, const Op* ops, s32 count)
+{
+	for(const Op* op = ops, *end = ops + count; op != end; op++)
+		tic_api_circ(tic, op->i[0], op->i[1], op->i[2], op->i[3]);
+}
+
+static const char PrintText[] = "HELLO WORLD! 0123456789";
+
+static double preparePrint(Op* ops, s32 count)
+{
+	for(Op* op = ops, *end = ops + count; op != end; op++)
+	{
+		op->i[0] = rnd(-TIC80_WIDTH / 2, TIC80_WIDTH - 1);
+		op->i[1] = rnd(0, TIC80_HEIGHT - 1);
+		op->i[2] = rnd(1, TIC_PALETTE_SIZE - 1);
+	}
+
+	return (double)count * (sizeof PrintText - 1) * TIC_FONT_WIDTH * TIC_FONT_HEIGHT;
+}
+
+static void runPrint(tic_mem* tic, const Op* ops, s32 count)
+{
+	for(const Op* op = ops, *end = ops + count; op != end; op++)
+		tic_api_print(tic, PrintText, op->i[0], op->i[1], op->i[2], false, 1, false);
+}
+
+static double prepareLine(Op* ops, s32 count)
+{
+	double pixels = 0;
+
+	for(Op* op = ops, *end = ops + count; op != end; op++)
+	{
+		op->i[0] = rnd(0, TIC80_WIDTH - 1);
+		op->i[1] = rnd(0, TIC80_HEIGHT - 1);
+		op->i[2] = rnd(0, TIC80_WIDTH - 1);
+		op->i[3] = rnd(0, TIC80_HEIGHT - 1);
+		op->i[4] = rnd(1, TIC_PALETTE_SIZE - 1);
+
+		s32 dx = abs(op->i[2] - op->i[0]), dy = abs(op->i[3] - op->i[1]);
+		pixels += (dx > dy ? dx : dy) + 1;
+	}
+
+	return pixels;
+}
+
+static void runLine(tic_mem* tic, const Op* ops, s32 count)
+{
+	for(const Op* op = ops, *end = ops + count; op != end; op++)
+		tic_api_line(tic, op->i[0], op->i[1], op->i[2], op->i[3], op->i[4]);
+}
+
+static double prepareBlit(Op* ops, s32 count)
+{
+	return (double)count * TIC80_FULLWIDTH * TIC80_FULLHEIGHT;
+}
+
+// a palette change makes the core convert every row again
+static void runBlit(tic_mem* tic, const Op* ops, s32 count)
+{
+	for(s32 i = 0; i < count; i++)
+	{
+		tic->ram.vram.palette.data[0] ^= 1;
+		tic_core_blit(tic, TIC80_PIXEL_COLOR_RGBA8888);
+	}
+}
+
+// nothing changed since the last frame, measures the rows check only
+static void runBlitStatic(tic_mem* tic, const Op* ops, s32 count)
+{
+	for(s32 i = 0; i < count; i++)
+		tic_core_blit(tic, TIC80_PIXEL_COLOR_RGBA8888);
+}
+
+static const Workload Workloads[] =
+{
+	{"spr",         10000,  prepareSprites,     runSprites},
+	{"spr32",       2000,   prepareBigSprites,  runBigSprites},
+	{"map",         200,    prepareMap,         runMap},
+	{"textri",      1000,   prepareTextri,      runTextri},
+	{"circ",        1000,   prepareCirc,        runCirc},
+	{"print",       1000,   preparePrint,       runPrint},
+	{"line",        10000,  prepareLine,        runLine},
+	{"blit",        500,    prepareBlit,        runBlit},
+	{"blit-static", 500,    prepareBlit,        runBlitStatic},
+};
+
+#include "scripts.inl"
+
+enum
+{
+	ScriptMath = 500,
+	ScriptPix = 2000,
+	ScriptSpr = 300,
+	ScriptPoke = 1000,
+	ScriptPrint = 20,
+
+	// API calls of a frame, the remap callbacks aren't counted
+	ScriptCalls = 1 + ScriptPix + ScriptSpr + 1 + ScriptPoke * 2 + ScriptPrint,
+};
+
+typedef struct
+{
+	const char* name;
+
+	// NULL runs the frame from C, the bindings overhead is measured against it
+	const char* code;
+} Binding;
+
+static const Binding Bindings[] =
+{
+	{"c",           NULL},
+#if defined(TIC_BUILD_WITH_LUA)
+	{"lua",         LuaWorkload},
+#endif
+#if defined(TIC_BUILD_WITH_MOON)
+	{"moon",        MoonWorkload},
+#endif
+#if defined(TIC_BUILD_WITH_FENNEL)
+	{"fennel",      FennelWorkload},
+#endif
+#if defined(TIC_BUILD_WITH_JS)
+	{"js",          JsWorkload},
+#endif
+#if defined(TIC_BUILD_WITH_WREN)
+	{"wren",        WrenWorkload},
+#endif
+#if defined(TIC_BUILD_WITH_SQUIRREL)
+	{"squirrel",    SquirrelWorkload},
+#endif
+};
+
+static void remapNative(void* data, s32 x, s32 y, RemapResult* result)
+{
+	result->index = (result->index + 1) % 256;
+}
+
+static void runNativeFrame(tic_mem* tic)
+{
+	u8 colorkey = 0;
+	s32 t = state.native.t++;
+
+	tic_api_cls(tic, 0);
+
+	double s = 0;
+	for(s32 i = 0; i < ScriptMath; i++)
+		s += sin(i * 0.01) * cos(i * 0.02);
+	state.native.s = s;
+
+	for(s32 i = 0; i < ScriptPix; i++)
+		tic_api_pix(tic, (i * 7 + t) % 240, i * 13 % 136, i % 16, false);
+
+	for(s32 i = 0; i < ScriptSpr; i++)
+		tic_api_spr(tic, i % 256, (i * 17 + t) % 240, i * 29 % 136, 1, 1, &colorkey, 1, 1, tic_no_flip, i % 4);
+
+	tic_api_map(tic, t % 30, 0, 31, 18, 0, 0, &colorkey, 1, 1, remapNative, NULL);
+
+	for(s32 i = 0; i < ScriptPoke; i++)
+		tic_api_poke(tic, 0x8000 + i, tic_api_peek(tic, 0x8000 + i) + 1);
+
+	for(s32 i = 0; i < ScriptPrint; i++)
+		tic_api_print(tic, "HELLO WORLD", i * 11 % 240, i * 7 % 136, i % 16, false, 1, false);
+}
+
+static void onScriptError(void* data, const char* info)
+{
+	fprintf(stderr, "%s: %s\n", ((const Binding*)data)->name, info);
+	state.error = true;
+}
+
+static void onScriptTrace(void* data, const char* text, u8 color) {}
+static void onScriptExit(void* data) {}
+
+static u64 getCounter(void* data)
+{
+	return (u64)(getTime() * 1e9);
+}
+
+static u64 getFreq(void* data)
+{
+	return 1000000000;
+}
+
+// random tiles and map in the cart, the scripts get them in RAM when the VM starts
+static tic_mem* createBindingCore(const Binding* binding)
+{
+	tic_mem* tic = tic_core_create(TIC80_SAMPLERATE);
+
+	if(!tic)
+		return NULL;
+
+	state.seed = 0x80;
+	tic_bank* bank = &tic->cart.bank0;
+
+	for(s32 i = 0; i < sizeof bank->tiles; i++)
+		((u8*)&bank->tiles)[i] = rnd(0, 0xff);
+
+	for(s32 i = 0; i < sizeof bank->sprites; i++)
+		((u8*)&bank->sprites)[i] = rnd(0, 0xff);
+
+	for(s32 i = 0; i < sizeof bank->map; i++)
+		((u8*)&bank->map)[i] = rnd(0, 0xff);
+
+	for(s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+	{
+		tic_rgb* color = &bank->palette.scn.colors[i];
+		color->r = color->g = color->b = i * 0x11;
+	}
+
+	if(binding->code)
+		strncpy(tic->cart.code.data, binding->code, sizeof tic->cart.code.data - 1);
+	else
+	{
+		// what the core does on the first tick of a cart
+		static const u8 Font[] =
+		{
+			#include "core/font.inl"
+		};
+
+		memcpy(tic->ram.font.data, Font, sizeof Font);
+		tic_api_sync(tic, 0, 0, false);
+	}
+
+	state.native.t = 0;
+
+	return tic;
+}
+
+static double runFrames(tic_mem* tic, const Binding* binding, tic_tick_data* data, s32 frames)
+{
+	double start = getTime();
+
+	for(s32 i = 0; i < frames && !state.error; i++)
+	{
+		tic_core_tick_start(tic);
+
+		if(binding->code)
+			tic_core_tick(tic, data);
+		else runNativeFrame(tic);
+
+		tic_core_tick_end(tic);
+	}
+
+	return getTime() - start;
+}
+
+static void printCalls(const Binding* binding, tic_mem* tic, s32 frames)
+{
+	const tic_perf_stats* stats = tic_core_perf_stats(tic);
+
+	if(!stats)
+		return;
+
+	for(s32 i = 0; i < tic_api_count; i++)
+	{
+		const tic_perf_counter* counter = &stats->api[i];
+
+		if(counter->calls)
+			printf("%s\t%s\t%.1f\t%.1f\n", binding->name, tic_core_perf_api_name(i), 
+				(double)counter->calls / frames, (double)counter->ns / counter->calls);
+	}
+}
+
+// frames of the same workload through the init/tick path of the binding,
+// the C reference goes first and the bindings report their time per call above it
+static bool runBinding(const Binding* binding, double* reference)
+{
+	s32 frames = (s32)(TIC80_FRAMERATE * state.scale);
+	if(frames < 1) frames = 1;
+
+	tic_mem* tic = createBindingCore(binding);
+
+	if(!tic)
+	{
+		fprintf(stderr, "can't create the core\n");
+		exit(1);
+	}
+
+	tic_tick_data data =
+	{
+		.error = onScriptError,
+		.trace = onScriptTrace,
+		.exit = onScriptExit,
+		.counter = getCounter,
+		.freq = getFreq,
+		.data = (void*)binding,
+	};
+
+	state.error = false;
+
+	// the bindings pick the profiled API wrappers when the VM starts
+	if(state.calls)
+		tic_core_perf_enable(tic, true);
+
+	// the first frame starts the VM and isn't timed, then warm up
+	runFrames(tic, binding, &data, 1);
+	runFrames(tic, binding, &data, frames);
+	tic_core_perf_reset(tic);
+
+	double best = 0;
+	for(s32 r = 0; r < state.repeat; r++)
+	{
+		double seconds = runFrames(tic, binding, &data, frames);
+
+		if(r == 0 || seconds < best)
+			best = seconds;
+	}
+
+	if(state.error)
+		printf("%s\terror\n", binding->name);
+	else if(state.calls)
+		printCalls(binding, tic, frames * state.repeat);
+	else
+	{
+		double ns = best * 1e9 / frames;
+
+		if(!binding->code)
+			*reference = ns;
+
+		// FNV-1a, equal for the bindings drawing the same frames
+		u64 hash = 0xcbf29ce484222325ull;
+		for(s32 i = 0; i < sizeof tic->ram.vram.screen.data; i++)
+			hash = (hash ^ tic->ram.vram.screen.data[i]) * 0x100000001b3ull;
+
+		printf("%s\t%i\t%.1f\t%.0f\t%i\t%.1f\t%016llx\n", binding->name, frames, best > 0 ? frames / best : 0, 
+			ns, ScriptCalls, (ns - *reference) / ScriptCalls, (unsigned long long)hash);
+	}
+
+	fflush(stdout);
+	tic_core_close(tic);
+
+	return !state.error;
+}
+
+// random tiles, map and a gray ramp palette, the same for every workload
+static void initMemory(tic_mem* tic)
+{
+	state.seed = 0x80;
+
+	for(s32 i = 0; i < sizeof tic->ram.tiles; i++)
+		((u8*)&tic->ram.tiles)[i] = rnd(0, 0xff);
+
+	for(s32 i = 0; i < sizeof tic->ram.sprites; i++)
+		((u8*)&tic->ram.sprites)[i] = rnd(0, 0xff);
+
+	for(s32 i = 0; i < sizeof tic->ram.map; i++)
+		((u8*)&tic->ram.map)[i] = rnd(0, 0xff);
+
+	for(s32 i = 0; i < TIC_PALETTE_SIZE; i++)
+	{
+		tic_rgb* color = &tic->ram.vram.palette.colors[i];
+		color->r = color->g = color->b = i * 0x11;
+	}
+
+	tic_api_cls(tic, 0);
+}
+
+static bool selected(const char* name, char** names, s32 count)
+{
+	if(count == 0)
+		return true;
+
+	for(s32 i = 0; i < count; i++)
+		if(strcmp(name, names[i]) == 0)
+			return true;
+
+	return false;
+}
+
+static void runWorkload(tic_mem* tic, const Workload* workload)
+{
+	s32 count = (s32)(workload->count * state.scale);
+	if(count < 1) count = 1;
+
+	Op* ops = calloc(count, sizeof(Op));
+
+	if(!ops)
+	{
+		fprintf(stderr, "out of memory\n");
+		exit(1);
+	}
+
+	initMemory(tic);
+	double pixels = workload->prepare(ops, count);
+
+	// warm up caches and the blit state, then take the best run
+	workload->run(tic, ops, count);
+
+	double best = 0;
+	for(s32 r = 0; r < state.repeat; r++)
+	{
+		double start = getTime();
+		workload->run(tic, ops, count);
+		double seconds = getTime() - start;
+
+		if(r == 0 || seconds < best)
+			best = seconds;
+	}
+
+	printf("%s\t%i\t%.1f\t%.0f\n", workload->name, count, best * 1e9 / count, best > 0 ? pixels / best : 0);
+	fflush(stdout);
+
+	free(ops);
+}
+
+static void printUsage()
+{
+	printf("usage: " TIC80_EXECUTABLE_NAME " [options] [workload...]\n"
+		"  --repeat <n>  timed runs per workload, the best one is reported (default 5)\n"
+		"  --scale <f>   multiply ops count of every workload (default 1)\n"
+		"  --script      run one frame workload through every script binding instead,\n"
+		"                the names select the bindings\n"
+		"  --calls       with --script, print the time of every API call from the profiler\n"
+		"  --list        print workload names\n"
+		"output: tab separated <workload> <ops> <ns/op> <pixels/s>, '#' lines are comments\n"
+		"script output: <binding> <frames> <fps> <ns/frame> <calls/frame> <ns/call over c> <screen hash>\n"
+		"calls output: <binding> <api> <calls/frame> <ns/call>\n");
+}
+
+int main(int argc, char** argv)
+{
+	char** names = calloc(argc, sizeof(char*));
+	s32 namesCount = 0;
+	bool list = false;
+
+	for(s32 i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+
+		if(strcmp(arg, "--repeat") == 0 && i + 1 < argc)
+			state.repeat = atoi(argv[++i]);
+		else if(strcmp(arg, "--scale") == 0 && i + 1 < argc)
+			state.scale = atof(argv[++i]);
+		else if(strcmp(arg, "--script") == 0)
+			state.script = true;
+		else if(strcmp(arg, "--calls") == 0)
+			state.script = state.calls = true;
+		else if(strcmp(arg, "--list") == 0)
+			list = true;
+		else if(strncmp(arg, "--", 2) == 0)
+		{
+			printUsage();
+			return strcmp(arg, "--help") == 0 ? 0 : 1;
+		}
+		else names[namesCount++] = argv[i];
+	}
+
+	if(list)
+	{
+		if(state.script)
+			for(s32 b = 0; b < COUNT_OF(Bindings); b++)
+				printf("%s\n", Bindings[b].name);
+		else
+			for(s32 w = 0; w < COUNT_OF(Workloads); w++)
+				printf("%s\n", Workloads[w].name);
+		return 0;
+	}
+
+	if(state.repeat < 1)
+		state.repeat = 1;
+
+	for(s32 i = 0; i < namesCount; i++)
+	{
+		bool found = false;
+
+		if(state.script)
+		{
+			for(s32 b = 0; b < COUNT_OF(Bindings); b++)
+				if(strcmp(Bindings[b].name, names[i]) == 0)
+					found = true;
+		}
+		else
+		{
+			for(s32 w = 0; w < COUNT_OF(Workloads); w++)
+				if(strcmp(Workloads[w].name, names[i]) == 0)
+					found = true;
+		}
+
+		if(!found)
+		{
+			fprintf(stderr, "unknown %s: %s\n", state.script ? "binding" : "workload", names[i]);
+			return 1;
+		}
+	}
+
+	if(state.script)
+	{
+		printf("# " TIC80_EXECUTABLE_NAME " %i script repeat=%i scale=%g\n", BENCH_VERSION, state.repeat, state.scale);
+		printf(state.calls 
+			? "# binding\tapi\tcalls/frame\tns/call\n"
+			: "# binding\tframes\tfps\tns/frame\tcalls/frame\tns/call\tscreen\n");
+
+		// the C reference always runs, it's what the bindings are compared to,
+		// there is nothing to profile in it though
+		double reference = 0;
+		bool done = true;
+		for(s32 b = 0; b < COUNT_OF(Bindings); b++)
+			if((!Bindings[b].code && !state.calls) || selected(Bindings[b].name, names, namesCount))
+				done &= runBinding(&Bindings[b], &reference);
+
+		free(names);
+		return done ? 0 : 1;
+	}
+
+	tic_mem* tic = tic_core_create(TIC80_SAMPLERATE);
+
+	if(!tic)
+	{
+		fprintf(stderr, "can't create the core\n");
+		return 1;
+	}
+
+	printf("# " TIC80_EXECUTABLE_NAME " %i repeat=%i scale=%g\n", BENCH_VERSION, state.repeat, state.scale);
+	printf("# workload\tops\tns/op\tpixels/s\n");
+
+	for(s32 w = 0; w < COUNT_OF(Workloads); w++)
+		if(selected(Workloads[w].name, names, namesCount))
+			runWorkload(tic, &Workloads[w]);
+
+	tic_core_close(tic);
+	free(names);
+
+	return 0;
+}
@@ -0,0 +1,131 @@
+// the same frame in every language, it has to stay in sync with runNativeFrame:
+// cls, sin/cos loop x500, pix x2000, spr x300, map with remap, peek/poke x1000, print x20
+
+#if defined(TIC_BUILD_WITH_LUA)
+static const char LuaWorkload[] =
+	"-- script: lua\n"
+	"t=0\n"
+	"s=0\n"
+	"function remap(tile,x,y)\n"
+	"\treturn (tile+1)%256,0,0\n"
+	"end\n"
+	"function TIC()\n"
+	"\tcls(0)\n"
+	"\ts=0\n"
+	"\tfor i=0,499 do s=s+math.sin(i*0.01)*math.cos(i*0.02) end\n"
+	"\tfor i=0,1999 do pix((i*7+t)%240,(i*13)%136,i%16) end\n"
+	"\tfor i=0,299 do spr(i%256,(i*17+t)%240,(i*29)%136,0,1,0,i%4) end\n"
+	"\tmap(t%30,0,31,18,0,0,0,1,remap)\n"
+	"\tfor i=0,999 do poke(0x8000+i,(peek(0x8000+i)+1)%256) end\n"
+	"\tfor i=0,19 do print(\"HELLO WORLD\",(i*11)%240,(i*7)%136,i%16) end\n"
+	"\tt=t+1\n"
+	"end\n";
+#endif
+
+#if defined(TIC_BUILD_WITH_MOON)
+static const char MoonWorkload[] =
+	"-- script: moon\n"
+	"t=0\n"
+	"s=0\n"
+	"remap=(tile,x,y)->\n"
+	"\treturn (tile+1)%256,0,0\n"
+	"export TIC=->\n"
+	"\tcls 0\n"
+	"\ts=0\n"
+	"\tfor i=0,499\n"
+	"\t\ts+=math.sin(i*0.01)*math.cos(i*0.02)\n"
+	"\tfor i=0,1999\n"
+	"\t\tpix (i*7+t)%240,(i*13)%136,i%16\n"
+	"\tfor i=0,299\n"
+	"\t\tspr i%256,(i*17+t)%240,(i*29)%136,0,1,0,i%4\n"
+	"\tmap t%30,0,31,18,0,0,0,1,remap\n"
+	"\tfor i=0,999\n"
+	"\t\tpoke 0x8000+i,(peek(0x8000+i)+1)%256\n"
+	"\tfor i=0,19\n"
+	"\t\tprint \"HELLO WORLD\",(i*11)%240,(i*7)%136,i%16\n"
+	"\tt+=1\n";
+#endif
+
+#if defined(TIC_BUILD_WITH_FENNEL)
+static const char FennelWorkload[] =
+	";; script: fennel\n"
+	"(var t 0)\n"
+	"(var s 0)\n"
+	"(fn remap [tile x y] (values (% (+ tile 1) 256) 0 0))\n"
+	"(global TIC\n"
+	" (fn tic []\n"
+	"  (cls 0)\n"
+	"  (set s 0)\n"
+	"  (for [i 0 499] (set s (+ s (* (math.sin (* i 0.01)) (math.cos (* i 0.02))))))\n"
+	"  (for [i 0 1999] (pix (% (+ (* i 7) t) 240) (% (* i 13) 136) (% i 16)))\n"
+	"  (for [i 0 299] (spr (% i 256) (% (+ (* i 17) t) 240) (% (* i 29) 136) 0 1 0 (% i 4)))\n"
+	"  (map (% t 30) 0 31 18 0 0 0 1 remap)\n"
+	"  (for [i 0 999] (poke (+ 32768 i) (% (+ (peek (+ 32768 i)) 1) 256)))\n"
+	"  (for [i 0 19] (print \"HELLO WORLD\" (% (* i 11) 240) (% (* i 7) 136) (% i 16)))\n"
+	"  (set t (+ t 1))))\n";
+#endif
+
+#if defined(TIC_BUILD_WITH_JS)
+static const char JsWorkload[] =
+	"// script: js\n"
+	"var t=0\n"
+	"var s=0\n"
+	"function remap(tile,x,y){\n"
+	"\treturn (tile+1)%256\n"
+	"}\n"
+	"function TIC(){\n"
+	"\tcls(0)\n"
+	"\ts=0\n"
+	"\tfor(var i=0;i<500;i++)s+=Math.sin(i*0.01)*Math.cos(i*0.02)\n"
+	"\tfor(var i=0;i<2000;i++)pix((i*7+t)%240,(i*13)%136,i%16)\n"
+	"\tfor(var i=0;i<300;i++)spr(i%256,(i*17+t)%240,(i*29)%136,0,1,0,i%4)\n"
+	"\tmap(t%30,0,31,18,0,0,0,1,remap)\n"
+	"\tfor(var i=0;i<1000;i++)poke(0x8000+i,(peek(0x8000+i)+1)%256)\n"
+	"\tfor(var i=0;i<20;i++)print(\"HELLO WORLD\",(i*11)%240,(i*7)%136,i%16)\n"
+	"\tt++\n"
+	"}\n";
+#endif
+
+#if defined(TIC_BUILD_WITH_WREN)
+static const char WrenWorkload[] =
+	"// script: wren\n"
+	"class Game is TIC{\n"
+	"\tconstruct new(){\n"
+	"\t\t_t=0\n"
+	"\t\t_s=0\n"
+	"\t\t_remap=Fn.new{|tile,x,y| (tile+1)%256 }\n"
+	"\t}\n"
+	"\tTIC(){\n"
+	"\t\tTIC.cls(0)\n"
+	"\t\t_s=0\n"
+	"\t\tfor(i in 0...500) _s=_s+(i*0.01).sin*(i*0.02).cos\n"
+	"\t\tfor(i in 0...2000) TIC.pix((i*7+_t)%240,(i*13)%136,i%16)\n"
+	"\t\tfor(i in 0...300) TIC.spr(i%256,(i*17+_t)%240,(i*29)%136,0,1,0,i%4)\n"
+	"\t\tTIC.map(_t%30,0,31,18,0,0,0,1,_remap)\n"
+	"\t\tfor(i in 0...1000) TIC.poke(0x8000+i,(TIC.peek(0x8000+i)+1)%256)\n"
+	"\t\tfor(i in 0...20) TIC.print(\"HELLO WORLD\",(i*11)%240,(i*7)%136,i%16)\n"
+	"\t\t_t=_t+1\n"
+	"\t}\n"
+	"}\n";
+#endif
+
+#if defined(TIC_BUILD_WITH_SQUIRREL)
+static const char SquirrelWorkload[] =
+	"// script: squirrel\n"
+	"t<-0\n"
+	"s<-0\n"
+	"function remap(tile,x,y){\n"
+	"\treturn [(tile+1)%256,0,0]\n"
+	"}\n"
+	"function TIC(){\n"
+	"\tcls(0)\n"
+	"\ts=0\n"
+	"\tfor(local i=0;i<500;i++)s+=sin(i*0.01)*cos(i*0.02)\n"
+	"\tfor(local i=0;i<2000;i++)pix((i*7+t)%240,(i*13)%136,i%16)\n"
+	"\tfor(local i=0;i<300;i++)spr(i%256,(i*17+t)%240,(i*29)%136,0,1,0,i%4)\n"
+	"\tmap(t%30,0,31,18,0,0,0,1,remap)\n"
+	"\tfor(local i=0;i<1000;i++)poke(0x8000+i,(peek(0x8000+i)+1)%256)\n"
+	"\tfor(local i=0;i<20;i++)print(\"HELLO WORLD\",(i*11)%240,(i*7)%136,i%16)\n"
+	"\tt++\n"
+	"}\n";
+#endif
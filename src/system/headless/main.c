@@ -0,0 +1,603 @@
+// MIT License
+
+// Copyright (c) 2020 Vadim Grigoruk @nesbox // grigoruk@gmail.com
+
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <tic80.h>
+
+#include "ext/pool.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#endif
+
+#define TIC80_EXECUTABLE_NAME "tic80-headless"
+#define TIC80_DEFAULT_FRAMES (TIC80_FRAMERATE * 60)
+#define TIC80_MUSIC_FRAMES (TIC80_FRAMERATE * 60 * 10)
+#define TIC80_MUSIC_TRACKS 8
+
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+// input script line: <frame> <gamepads> [<keyboard> [<mouse x> <mouse y> <mouse buttons>]]
+// numbers are hex, the input is held until the next line, '#' starts a comment
+typedef struct
+{
+	s32 frame;
+	tic80_input input;
+} InputEvent;
+
+typedef struct
+{
+	const char* path;
+
+	// output is collected per cart when running in parallel
+	bool stream;
+	char* text;
+	size_t size;
+	size_t capacity;
+
+	s32 frames;
+	double seconds;
+	bool quit;
+	bool error;
+} Run;
+
+enum {NoMusic = -2, AllMusic = -1};
+
+static struct
+{
+	s32 frames;
+	s32 hashEvery;
+	bool trace;
+
+	// music export, runs nothing but the sound of the carts
+	struct
+	{
+		s32 track;
+		s32 samplerate;
+		bool raw;
+		const char* dir;
+	} music;
+
+	InputEvent* events;
+	s32 eventsCount;
+
+	Run* runs;
+	s32 count;
+} state =
+{
+	.frames = TIC80_DEFAULT_FRAMES,
+	.hashEvery = 1,
+	.trace = true,
+	.music =
+	{
+		.track = NoMusic,
+		.samplerate = TIC80_SAMPLERATE,
+	},
+};
+
+// tic80 callbacks have no user data, every run stays on its thread
+static THREAD_LOCAL Run* current = NULL;
+
+static double getTime()
+{
+#if defined(_WIN32)
+	LARGE_INTEGER counter, freq;
+	QueryPerformanceCounter(&counter);
+	QueryPerformanceFrequency(&freq);
+	return (double)counter.QuadPart / freq.QuadPart;
+#else
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+#endif
+}
+
+static void output(Run* run, const char* format, ...)
+{
+	va_list args;
+
+	if(run->stream)
+	{
+		va_start(args, format);
+		vprintf(format, args);
+		va_end(args);
+		return;
+	}
+
+	va_start(args, format);
+	s32 length = vsnprintf(NULL, 0, format, args);
+	va_end(args);
+
+	if(length < 0) return;
+
+	if(run->size + length + 1 > run->capacity)
+	{
+		size_t capacity = run->capacity ? run->capacity : 1024;
+		while(run->size + length + 1 > capacity)
+			capacity *= 2;
+
+		char* text = realloc(run->text, capacity);
+		if(!text) return;
+
+		run->text = text;
+		run->capacity = capacity;
+	}
+
+	va_start(args, format);
+	vsnprintf(run->text + run->size, run->capacity - run->size, format, args);
+	va_end(args);
+
+	run->size += length;
+}
+
+static void startRun(Run* run)
+{
+	current = run;
+
+	// buffered runs get their header when the output is printed
+	if(run->stream && state.count > 1)
+		printf("cart %s\n", run->path);
+}
+
+static void onTrace(const char* text, u8 color)
+{
+	if(state.trace)
+		output(current, "trace %s\n", text);
+}
+
+static void onError(const char* info)
+{
+	output(current, "error %s\n", info);
+	current->error = true;
+}
+
+static void onExit()
+{
+	current->quit = true;
+}
+
+static void* loadFile(const char* path, s32* size)
+{
+	FILE* file = fopen(path, "rb");
+	void* data = NULL;
+
+	if(file)
+	{
+		fseek(file, 0, SEEK_END);
+		*size = ftell(file);
+		fseek(file, 0, SEEK_SET);
+
+		if((data = malloc(*size + 1)))
+		{
+			if(fread(data, *size, 1, file) == 1 || *size == 0)
+				((char*)data)[*size] = '\0';
+			else
+			{
+				free(data);
+				data = NULL;
+			}
+		}
+
+		fclose(file);
+	}
+
+	return data;
+}
+
+static InputEvent* loadInput(const char* path, s32* count)
+{
+	s32 size = 0;
+	char* text = loadFile(path, &size);
+
+	if(!text) return NULL;
+
+	InputEvent* events = NULL;
+	s32 capacity = 0;
+	*count = 0;
+
+	for(char* line = strtok(text, "\r\n"); line; line = strtok(NULL, "\r\n"))
+	{
+		char* comment = strchr(line, '#');
+		if(comment) *comment = '\0';
+
+		s32 frame;
+		u32 gamepads = 0, keyboard = 0, x = 0, y = 0, buttons = 0;
+
+		if(sscanf(line, "%d %x %x %x %x %x", &frame, &gamepads, &keyboard, &x, &y, &buttons) < 2)
+			continue;
+
+		if(*count == capacity)
+		{
+			InputEvent* items = realloc(events, (capacity ? capacity * 2 : 64) * sizeof(InputEvent));
+
+			if(!items) break;
+
+			events = items;
+			capacity = capacity ? capacity * 2 : 64;
+		}
+
+		InputEvent* event = &events[(*count)++];
+		memset(event, 0, sizeof(InputEvent));
+
+		event->frame = frame;
+		event->input.gamepads.data = gamepads;
+		event->input.keyboard.data = keyboard;
+		event->input.mouse.x = x;
+		event->input.mouse.y = y;
+		event->input.mouse.btns = buttons;
+	}
+
+	free(text);
+
+	// an empty script is still a valid one
+	return events ? events : calloc(1, sizeof(InputEvent));
+}
+
+// FNV-1a
+static u64 hashScreen(const tic80* tic)
+{
+	const u8* ptr = (const u8*)tic->screen;
+	const u8* end = ptr + TIC80_FULLWIDTH * TIC80_FULLHEIGHT * sizeof(u32);
+	u64 hash = 0xcbf29ce484222325ull;
+
+	while(ptr < end)
+		hash = (hash ^ *ptr++) * 0x100000001b3ull;
+
+	return hash;
+}
+
+static void runCart(void* data, s32 index)
+{
+	Run* run = &state.runs[index];
+	startRun(run);
+
+	s32 size = 0;
+	void* cart = loadFile(run->path, &size);
+
+	if(!cart)
+	{
+		output(run, "error could not load %s\n", run->path);
+		run->error = true;
+		return;
+	}
+
+	tic80* tic = tic80_create(TIC80_SAMPLERATE);
+
+	if(!tic)
+	{
+		output(run, "error could not create the core\n");
+		run->error = true;
+		free(cart);
+		return;
+	}
+
+	tic->callback.trace = onTrace;
+	tic->callback.error = onError;
+	tic->callback.exit = onExit;
+
+	tic80_load(tic, cart, size);
+
+	tic80_input input;
+	memset(&input, 0, sizeof input);
+
+	s32 frame = 0;
+	s32 event = 0;
+	double start = getTime();
+
+	for(; frame < state.frames && !run->quit && !run->error; frame++)
+	{
+		while(event < state.eventsCount && state.events[event].frame <= frame)
+			input = state.events[event++].input;
+
+		tic80_tick(tic, &input);
+
+		if(state.hashEvery > 0 && (frame + 1) % state.hashEvery == 0)
+			output(run, "frame %d %016llx\n", frame, (unsigned long long)hashScreen(tic));
+	}
+
+	run->seconds = getTime() - start;
+	run->frames = frame;
+
+	if(frame)
+		output(run, "last %d %016llx\n", frame - 1, (unsigned long long)hashScreen(tic));
+
+	output(run, "time %d frames %.3f s %.1f fps\n", frame, run->seconds, run->seconds > 0 ? frame / run->seconds : 0);
+
+	tic80_delete(tic);
+	free(cart);
+}
+
+typedef struct
+{
+	FILE* file;
+	u32 size;
+} SoundFile;
+
+static void writeU32(u8* ptr, u32 value)
+{
+	for(s32 i = 0; i < 4; i++)
+		ptr[i] = value >> (i * 8);
+}
+
+static void writeU16(u8* ptr, u16 value)
+{
+	ptr[0] = value;
+	ptr[1] = value >> 8;
+}
+
+// 16 bit stereo PCM, the sizes are updated when the track is done
+static void writeWaveHeader(FILE* file, s32 samplerate, u32 size)
+{
+	enum {Channels = 2, Bytes = sizeof(s16)};
+	u8 header[44];
+
+	memcpy(header, "RIFF", 4);
+	writeU32(header + 4, 36 + size);
+	memcpy(header + 8, "WAVEfmt ", 8);
+	writeU32(header + 16, 16);
+	writeU16(header + 20, 1);
+	writeU16(header + 22, Channels);
+	writeU32(header + 24, samplerate);
+	writeU32(header + 28, samplerate * Channels * Bytes);
+	writeU16(header + 32, Channels * Bytes);
+	writeU16(header + 34, Bytes * 8);
+	memcpy(header + 36, "data", 4);
+	writeU32(header + 40, size);
+
+	fseek(file, 0, SEEK_SET);
+	fwrite(header, sizeof header, 1, file);
+}
+
+static void onSound(const s16* samples, s32 count, void* data)
+{
+	SoundFile* sound = data;
+
+	// samples are little endian on every platform we run on
+	sound->size += (u32)fwrite(samples, sizeof(s16), count, sound->file) * sizeof(s16);
+}
+
+static void getMusicPath(char* path, size_t size, const char* cart, s32 track)
+{
+	const char* name = cart;
+
+	for(const char* ptr = cart; *ptr; ptr++)
+		if(*ptr == '/' || *ptr == '\\')
+			name = ptr + 1;
+
+	const char* ext = state.music.raw ? "raw" : "wav";
+
+	if(state.music.dir)
+		snprintf(path, size, "%s/%s.%d.%s", state.music.dir, name, track, ext);
+	else
+		snprintf(path, size, "%s.%d.%s", cart, track, ext);
+}
+
+static s32 exportTrack(Run* run, const void* cart, s32 size, s32 track)
+{
+	char path[1024];
+	getMusicPath(path, sizeof path, run->path, track);
+
+	SoundFile sound = {fopen(path, "wb"), 0};
+
+	if(!sound.file)
+	{
+		output(run, "error could not open %s\n", path);
+		run->error = true;
+		return -1;
+	}
+
+	if(!state.music.raw)
+		writeWaveHeader(sound.file, state.music.samplerate, 0);
+
+	double start = getTime();
+	s32 frames = tic80_music(cart, size, track, state.music.samplerate, state.frames, onSound, &sound);
+	double seconds = getTime() - start;
+
+	if(frames > 0 && !state.music.raw)
+		writeWaveHeader(sound.file, state.music.samplerate, sound.size);
+
+	fclose(sound.file);
+
+	if(frames <= 0)
+	{
+		remove(path);
+		return frames;
+	}
+
+	run->frames += frames;
+	output(run, "music %d %d frames %.3f s %s\n", track, frames, seconds, path);
+
+	return frames;
+}
+
+static void exportMusic(void* data, s32 index)
+{
+	Run* run = &state.runs[index];
+	startRun(run);
+
+	s32 size = 0;
+	void* cart = loadFile(run->path, &size);
+
+	if(!cart)
+	{
+		output(run, "error could not load %s\n", run->path);
+		run->error = true;
+		return;
+	}
+
+	double start = getTime();
+
+	if(state.music.track == AllMusic)
+	{
+		for(s32 track = 0; track < TIC80_MUSIC_TRACKS; track++)
+			exportTrack(run, cart, size, track);
+	}
+	else
+	{
+		s32 frames = exportTrack(run, cart, size, state.music.track);
+
+		if(frames == 0)
+			output(run, "music %d empty\n", state.music.track);
+		else if(frames < 0 && !run->error)
+		{
+			output(run, "error track %d not found\n", state.music.track);
+			run->error = true;
+		}
+	}
+
+	run->seconds = getTime() - start;
+
+	free(cart);
+}
+
+static void printUsage(const char* executable)
+{
+	printf("Usage: %s <cart> [<cart> ...] [options]\n\n"
+		"  --frames <n>     frames to run (default %d)\n"
+		"  --input <file>   input script, lines of '<frame> <gamepads> [<keyboard> [<x> <y> <buttons>]]'\n"
+		"  --hash <n>       print the screen hash every n frames (default 1, 0 prints only the last one)\n"
+		"  --jobs <n>       carts to run in parallel (default is the number of CPUs)\n"
+		"  --notrace        don't print trace() output\n"
+		"  --music <n|all>  export the music track(s) of the first bank to <cart>.<n>.wav, the carts aren't run\n"
+		"  --samplerate <n> samplerate of the exported music (default %d)\n"
+		"  --raw            export raw 16 bit stereo PCM instead of WAV\n"
+		"  --out <dir>      directory for the exported music (default is next to the cart)\n",
+		executable, TIC80_DEFAULT_FRAMES, TIC80_SAMPLERATE);
+}
+
+s32 main(s32 argc, char **argv)
+{
+	const char* executable = argc > 0 ? argv[0] : TIC80_EXECUTABLE_NAME;
+	const char* inputPath = NULL;
+	s32 jobs = pool_cpus();
+	s32 count = 0;
+	bool framesSet = false;
+
+	state.runs = calloc(argc, sizeof(Run));
+
+	if(!state.runs) return 1;
+
+	for(s32 i = 1; i < argc; i++)
+	{
+		const char* arg = argv[i];
+
+		if(strcmp(arg, "--help") == 0 || strcmp(arg, "-h") == 0)
+		{
+			printUsage(executable);
+			return 0;
+		}
+		else if(strcmp(arg, "--frames") == 0 && i + 1 < argc)
+		{
+			state.frames = atoi(argv[++i]);
+			framesSet = true;
+		}
+		else if(strcmp(arg, "--input") == 0 && i + 1 < argc)
+			inputPath = argv[++i];
+		else if(strcmp(arg, "--hash") == 0 && i + 1 < argc)
+			state.hashEvery = atoi(argv[++i]);
+		else if(strcmp(arg, "--jobs") == 0 && i + 1 < argc)
+			jobs = atoi(argv[++i]);
+		else if(strcmp(arg, "--notrace") == 0)
+			state.trace = false;
+		else if(strcmp(arg, "--music") == 0 && i + 1 < argc)
+		{
+			const char* track = argv[++i];
+			state.music.track = strcmp(track, "all") == 0 ? AllMusic : atoi(track);
+		}
+		else if(strcmp(arg, "--samplerate") == 0 && i + 1 < argc)
+			state.music.samplerate = atoi(argv[++i]);
+		else if(strcmp(arg, "--raw") == 0)
+			state.music.raw = true;
+		else if(strcmp(arg, "--out") == 0 && i + 1 < argc)
+			state.music.dir = argv[++i];
+		else if(arg[0] != '-')
+			state.runs[count++].path = arg;
+		else
+		{
+			fprintf(stderr, "Error: unknown option %s.\n\n", arg);
+			printUsage(executable);
+			return 1;
+		}
+	}
+
+	if(!count)
+	{
+		printUsage(executable);
+		return 1;
+	}
+
+	if(inputPath && !(state.events = loadInput(inputPath, &state.eventsCount)))
+	{
+		fprintf(stderr, "Error: Could not load %s.\n", inputPath);
+		return 1;
+	}
+
+	state.count = count;
+
+	if(count == 1 || jobs <= 1)
+		for(s32 i = 0; i < count; i++)
+			state.runs[i].stream = true;
+
+	bool music = state.music.track != NoMusic;
+
+	if(music && !framesSet)
+		state.frames = TIC80_MUSIC_FRAMES;
+
+	double start = getTime();
+	pool_run(jobs, count, music ? exportMusic : runCart, NULL);
+	double seconds = getTime() - start;
+
+	s32 errors = 0;
+	s64 frames = 0;
+
+	for(s32 i = 0; i < count; i++)
+	{
+		Run* run = &state.runs[i];
+
+		if(count > 1)
+		{
+			if(!run->stream)
+				printf("cart %s\n%s", run->path, run->text ? run->text : "");
+
+			free(run->text);
+		}
+
+		frames += run->frames;
+		if(run->error) errors++;
+	}
+
+	if(count > 1)
+		printf("total %d carts %d errors %lld frames %.3f s %.1f fps\n", count, errors, (long long)frames, seconds, seconds > 0 ? frames / seconds : 0);
+
+	free(state.events);
+	free(state.runs);
+
+	return errors ? 1 : 0;
+}
@@ -93,6 +93,20 @@ struct retro_core_option_definition option_defs_us[] = {
       },
       "5"
    },
+   {
+      "tic80_rewind",
+      "Rewind Buffer (MB)",
+      "Memory for the core's own rewind history. Hold L2 on the first controller to step the game back.",
+      {
+         { "disabled", NULL },
+         { "16",       NULL },
+         { "32",       NULL },
+         { "64",       NULL },
+         { "128",      NULL },
+         { NULL, NULL },
+      },
+      "disabled"
+   },
    { NULL, NULL, NULL, {{0}}, NULL },
 };
 
@@ -40,6 +40,7 @@ struct tic80_state
 	u16 mousePreviousY;
 	int mouseHideTimer;
 	int mouseHideTimerStart;
+	int rewindSize;
 	tic80* tic;
 };
 static struct tic80_state* state;
@@ -113,6 +114,7 @@ RETRO_API void retro_init(void)
 	state->mousePreviousX = 0;
 	state->mousePreviousY = 0;
 	state->mouseHideTimer = state->mouseHideTimerStart;
+	state->rewindSize = 0;
 
 	// Initialize the keyboard mappings.
 	state->keymap[RETROK_UNKNOWN] = tic_key_unknown;
@@ -370,6 +372,7 @@ void tic80_libretro_input_descriptors()
 		{ 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_A, "B" },
 		{ 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_X, "Y" },
 		{ 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_Y, "X" },
+		{ 0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2, "Rewind" },
 #endif
 
 #if TIC_MAXPLAYERS >= 2
@@ -592,8 +595,14 @@ void tic80_libretro_update(tic80* game)
 	// Keyboard
 	tic80_libretro_update_keyboard(&state->input.keyboard);
 
-	// Update the game state.
-	tic80_tick(game, &state->input);
+	// Holding L2 steps back through the rewind history instead of running the frame.
+	if (state->rewindSize > 0 && input_state_cb(0, RETRO_DEVICE_JOYPAD, 0, RETRO_DEVICE_ID_JOYPAD_L2)
+		&& tic80_rewind(game)) {
+		return;
+	}
+
+	// Update the game state, the frame is rendered in tic80_libretro_draw().
+	tic80_update(game, &state->input);
 }
 
 /**
@@ -604,7 +613,21 @@ void tic80_libretro_draw(tic80* game)
 	// Render the mouse cursor if needed.
 	tic80_libretro_mousecursor((tic80_local*)game, &state->input.mouse, state->mouseCursor);
 
-	// Render to the screen.
+	// Render straight into the frontend's framebuffer when it provides one.
+	struct retro_framebuffer fb = {0};
+	fb.width = TIC80_FULLWIDTH;
+	fb.height = TIC80_FULLHEIGHT;
+	fb.access_flags = RETRO_MEMORY_ACCESS_WRITE;
+
+	if (environ_cb(RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER, &fb) && fb.data
+		&& fb.format == RETRO_PIXEL_FORMAT_XRGB8888 && fb.pitch >= TIC80_FULLWIDTH << 2) {
+		tic80_blit(game, fb.data, (s32)fb.pitch, true);
+		video_cb(fb.data, TIC80_FULLWIDTH, TIC80_FULLHEIGHT, fb.pitch);
+		return;
+	}
+
+	// Otherwise render to the TIC-80 screen buffer.
+	tic80_blit(game, game->screen, TIC80_FULLWIDTH << 2, true);
 	video_cb(game->screen, TIC80_FULLWIDTH, TIC80_FULLHEIGHT, TIC80_FULLWIDTH << 2);
 }
 
@@ -666,6 +689,19 @@ void tic80_libretro_variables(void)
 			state->mouseHideTimerStart = -1;
 		}
 	}
+
+	// Rewind Buffer, reinitializing drops the history, so only do it when the size changes.
+	int rewindSize = 0;
+	var.key = "tic80_rewind";
+	var.value = NULL;
+	if (environ_cb(RETRO_ENVIRONMENT_GET_VARIABLE, &var) && var.value) {
+		rewindSize = atoi(var.value) * 1024 * 1024;
+	}
+
+	if (rewindSize != state->rewindSize) {
+		state->rewindSize = rewindSize;
+		tic80_rewind_init(state->tic, rewindSize);
+	}
 }
 
 /**
@@ -707,7 +743,6 @@ RETRO_API void retro_run(void)
 RETRO_API bool retro_load_game(const struct retro_game_info *info)
 {
 	// TODO: Warn that Audio Synchronization required to run at a proper speed.
-	// TODO: Warn that the core doesn't support Runahead.
 
 	// Initialize the core if it hasn't been yet.
 	if (state == NULL) {
@@ -750,6 +785,7 @@ RETRO_API bool retro_load_game(const struct retro_game_info *info)
 	state->quit = false;
 	state->input.mouse.x = 0;
 	state->input.mouse.y = 0;
+	state->rewindSize = 0;
 
 	// Load the content.
 	// TODO: Allow loading code files directly.
@@ -760,6 +796,12 @@ RETRO_API bool retro_load_game(const struct retro_game_info *info)
 		return false;
 	}
 
+	// Snapshots keep the script VM heap as is, so they only work within one session.
+	uint64_t quirks = RETRO_SERIALIZATION_QUIRK_SINGLE_SESSION
+		| RETRO_SERIALIZATION_QUIRK_ENDIAN_DEPENDENT
+		| RETRO_SERIALIZATION_QUIRK_PLATFORM_DEPENDENT;
+	environ_cb(RETRO_ENVIRONMENT_SET_SERIALIZATION_QUIRKS, &quirks);
+
 	// Set up the input descriptors.
 	tic80_libretro_input_descriptors();
 
@@ -800,15 +842,23 @@ RETRO_API bool retro_load_game_special(unsigned type, const struct retro_game_in
 }
 
 /**
- * libretro callback; Retrieve the size of the serialized memory.
+ * libretro callback; Retrieve the size of the serialized machine state.
+ *
+ * The state holds the RAM, the core and sound state and the script VM heap,
+ * its size doesn't change while the cart is loaded. Zero means the cart's
+ * script language doesn't support snapshots.
  */
 size_t retro_serialize_size(void)
 {
-	return TIC_PERSISTENT_SIZE * sizeof(u32);
+	if (state == NULL || state->tic == NULL) {
+		return 0;
+	}
+
+	return tic80_state_size(state->tic);
 }
 
 /**
- * libretro callback; Get the current persistent memory.
+ * libretro callback; Take a snapshot of the whole machine.
  */
 RETRO_API bool retro_serialize(void *data, size_t size)
 {
@@ -816,31 +866,19 @@ RETRO_API bool retro_serialize(void *data, size_t size)
 		return false;
 	}
 
-	tic80_local* tic80 = (tic80_local*)state->tic;
-	u32* udata = (u32*)data;
-	for (int i = 0; i < TIC_PERSISTENT_SIZE; i++) {
-		udata[i] = tic80->memory->ram.persistent.data[i];
-	}
-
-	return true;
+	return tic80_state_save(state->tic, data, (s32)size) > 0;
 }
 
 /**
- * libretro callback; Given the serialized data, load it into the persistent memory.
+ * libretro callback; Given the serialized data, restore the machine state.
  */
 RETRO_API bool retro_unserialize(const void *data, size_t size)
 {
-	if (state == NULL || state->tic == NULL || size != retro_serialize_size() || data == NULL) {
+	if (state == NULL || state->tic == NULL || data == NULL) {
 		return false;
 	}
 
-	tic80_local* tic80 = (tic80_local*)state->tic;
-	u32* uData = (u32*)data;
-	for (int i = 0; i < TIC_PERSISTENT_SIZE; i++) {
-		tic80->memory->ram.persistent.data[i] = uData[i];
-	}
-
-	return true;
+	return tic80_state_load(state->tic, data, (s32)size);
 }
 
 /**
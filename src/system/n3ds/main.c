@@ -220,6 +220,11 @@ void tic_sys_update_config()
 
 }
 
+bool tic_sys_audio_stats(tic_audio_stats* stats)
+{
+    return false;
+}
+
 bool tic_sys_keyboard_text(char* text)
 {
     return false;
@@ -431,7 +436,8 @@ void n3ds_sound_init(int sample_rate)
     float mix[12];
     int buffer_size;
 
-    platform.audio.samples = platform.studio->tic->samples.size / (TIC_STEREO_CHANNELS * sizeof(u16));
+    // a frame is one sample longer now and then, the rate doesn't divide by the frame rate
+    platform.audio.samples = platform.studio->tic->samples.size / (TIC_STEREO_CHANNELS * sizeof(u16)) + 1;
     buffer_size = platform.audio.samples * (TIC_STEREO_CHANNELS * sizeof(u16));
 
     platform.audio.buffer = linearAlloc(buffer_size * AUDIO_BLOCKS);
@@ -471,8 +477,11 @@ static void audio_update(void) {
 
     if (wave_buf->status == NDSP_WBUF_DONE) {
         u16 *audio_ptr = wave_buf->data_pcm16;
-        memcpy(audio_ptr, platform.studio->tic->samples.buffer, platform.audio.buffer_size);
-        DSP_FlushDataCache(audio_ptr, platform.audio.buffer_size);
+        u32 size = MIN(platform.studio->tic->samples.size, platform.audio.buffer_size);
+
+        memcpy(audio_ptr, platform.studio->tic->samples.buffer, size);
+        DSP_FlushDataCache(audio_ptr, size);
+        wave_buf->nsamples = size / (TIC_STEREO_CHANNELS * sizeof(u16));
 
         ndspChnWaveBufAdd(0, wave_buf);
         platform.audio.curr_block = (platform.audio.curr_block + 1) % AUDIO_BLOCKS;
@@ -45,10 +45,26 @@
 
 #define TEXTURE_SIZE (TIC80_FULLWIDTH)
 
+// ms of audio kept in the ring ahead of the device buffer
+#define AUDIO_LATENCY 40
+#define AUDIO_DEVICE_SAMPLES 512
+
+// the most the resampling ratio deviates from 1, about 9 cents
+#define AUDIO_MAX_DRIFT 0.005
+
 #if defined(__TIC_WINDOWS__)
 #include <windows.h>
 #endif
 
+// the studio ticks on its own thread, the main one only polls events, uploads and presents frames
+#if !defined(__EMSCRIPTEN__)
+#define EMU_THREAD_SUPPORT
+#endif
+
+// a triple buffer keeps its latest slot index with a flag telling the slot wasn't taken yet
+#define SWAP_SLOTS 3
+#define SWAP_FRESH 4
+
 #if defined(__TIC_ANDROID__)
 #include <sys/stat.h>
 #define TOUCH_INPUT_SUPPORT
@@ -74,6 +90,48 @@ static const SDL_SystemCursor SystemCursors[] =
     [ArrowCursor] = SDL_SYSTEM_CURSOR_ARROW
 };
 
+// lock-free handoff between one producer and one consumer thread
+typedef struct
+{
+    SDL_atomic_t latest;
+    s32 back;
+    s32 front;
+} Swap;
+
+// input polled on the main thread for the next tick
+typedef struct
+{
+    tic80_input input;
+    char text;
+} InputSlot;
+
+// a ticked frame with what the main thread draws over it, the config values
+// are copied too, the tick can reload the config while the frame is drawn
+typedef struct
+{
+    u32 screen[TIC80_FULLWIDTH * TIC80_FULLHEIGHT];
+
+    // rows changed since the frame published before, all of them are
+    // uploaded when the sequence shows a frame was skipped
+    u32 seq;
+    bool dirty[TIC80_FULLHEIGHT];
+
+    bool mouse;
+    bool gamepad;
+    bool crtMonitor;
+
+    struct
+    {
+        // the SDL cursor of the type is shown instead of the tile when the
+        // theme has no sprite for the system cursor
+        CursorType type;
+        bool system;
+        bool pixelPerfect;
+        tic_tile tile;
+        u32 palette[TIC_PALETTE_SIZE];
+    } cursor;
+} FrameSlot;
+
 static struct
 {
     Studio* studio;
@@ -90,6 +148,9 @@ static struct
         u32 shader;
         GPU_ShaderBlock block;
 
+        // of the frame presented last
+        bool crtMonitor;
+
 #else
 
         SDL_Renderer* renderer;
@@ -134,6 +195,8 @@ static struct
     struct
     {
         bool state[tic_keys_count];
+
+        // text input of the current tick
         char text;
 
 #if defined(TOUCH_INPUT_SUPPORT)
@@ -158,15 +221,94 @@ static struct
 #else
         SDL_Texture* texture;
 #endif
-        const u8* src;
+        u32 pixels[TIC_SPRITESIZE * TIC_SPRITESIZE];
         SDL_Cursor* cursors[COUNT_OF(SystemCursors)];
     } mouse;
 
+    // the main thread polls to the back slot, the tick takes the front one
+    struct
+    {
+        InputSlot slots[SWAP_SLOTS];
+        Swap swap;
+
+        // scroll and text of the slots the tick missed, added to the next one
+        InputSlot carry;
+    } input;
+
+    // the tick publishes to the back slot, the main thread presents the front one
+    struct
+    {
+        FrameSlot slots[SWAP_SLOTS];
+        Swap swap;
+
+        // last published by the tick and last uploaded by the main thread
+        u32 seq;
+        u32 uploaded;
+        bool taken;
+    } frame;
+
+    struct
+    {
+        // requests from the event loop, the tick handles them
+        SDL_atomic_t exit;
+        SDL_atomic_t focus;
+
+#if defined(CRT_SHADER_SUPPORT)
+        // the tick has asked the main thread to load the CRT shader
+        bool shader;
+#endif
+
+#if defined(EMU_THREAD_SUPPORT)
+        SDL_Thread* thread;
+        SDL_threadID main;
+        SDL_atomic_t running;
+
+        // posted on a new frame or a call, the main thread waits on it
+        SDL_sem* wake;
+
+        // SDL video calls are made on the main thread, the tick waits for them
+        struct
+        {
+            void (*fn)(void*);
+            void* data;
+            SDL_atomic_t pending;
+            SDL_sem* done;
+        } call;
+#endif
+    } emu;
+
     struct
     {
         SDL_AudioSpec       spec;
         SDL_AudioDeviceID   device;
-        SDL_AudioCVT        cvt;
+
+        // stereo frames, the main thread writes at head and the audio callback reads at tail
+        struct
+        {
+            s16* data;
+            u32 mask;
+            SDL_atomic_t head;
+            SDL_atomic_t tail;
+        } ring;
+
+        // frames the ring holds normally and the most it can hold
+        s32 target;
+        s32 limit;
+
+        // audio callback state: smoothed ring fill, accumulated clock drift, fractional read position
+        double fill;
+        double drift;
+        double pos;
+        bool primed;
+
+        SDL_atomic_t underruns;
+        u32 overruns;
+
+        // held by the tick and by the callback while it continues the sound on an underrun,
+        // the callback only tries it, so it never waits for a frame to finish
+        SDL_SpinLock synth;
+        tic_mem* tic;
+        s32 rendered;
     } audio;
 } platform
 #if defined(TOUCH_INPUT_SUPPORT)
@@ -179,10 +321,140 @@ static struct
 #if defined(CRT_SHADER_SUPPORT)
 static inline bool crtMonitorEnabled()
 {
-    return platform.studio->config()->crtMonitor && platform.gpu.shader;
+    return platform.gpu.crtMonitor && platform.gpu.shader;
 }
 #endif
 
+static void initSwap(Swap* swap)
+{
+    SDL_AtomicSet(&swap->latest, 0);
+    swap->back = 1;
+    swap->front = 2;
+}
+
+// publishes the back slot and takes a free one, returns true if the slot got back wasn't taken by the consumer
+static bool swapPublish(Swap* swap)
+{
+    s32 prev = SDL_AtomicSet(&swap->latest, swap->back | SWAP_FRESH);
+    swap->back = prev & ~SWAP_FRESH;
+
+    return prev & SWAP_FRESH;
+}
+
+// takes the latest published slot to the front if there is a new one
+static bool swapTake(Swap* swap)
+{
+    if(!(SDL_AtomicGet(&swap->latest) & SWAP_FRESH))
+        return false;
+
+    swap->front = SDL_AtomicSet(&swap->latest, swap->front) & ~SWAP_FRESH;
+
+    return true;
+}
+
+// runs the function on the main thread and waits for it
+static void callMain(void(*fn)(void*), void* data)
+{
+#if defined(EMU_THREAD_SUPPORT)
+    if(SDL_ThreadID() != platform.emu.main)
+    {
+        platform.emu.call.fn = fn;
+        platform.emu.call.data = data;
+        SDL_AtomicSet(&platform.emu.call.pending, 1);
+        SDL_SemPost(platform.emu.wake);
+        SDL_SemWait(platform.emu.call.done);
+        return;
+    }
+#endif
+
+    fn(data);
+}
+
+// a late frame is covered by continuing the last one, up to a frame long, so the
+// underrun doesn't click, after that the device plays silence until the ring is refilled
+static s32 continueSound(s16* out, s32 frames)
+{
+    s32 count = 0;
+
+    if(SDL_AtomicTryLock(&platform.audio.synth))
+    {
+        if(platform.audio.tic)
+        {
+            frames = MIN(frames, platform.audio.spec.freq / TIC80_FRAMERATE - platform.audio.rendered);
+
+            if(frames > 0)
+                count = tic_core_sound_render(platform.audio.tic, out, frames);
+
+            platform.audio.rendered += count;
+        }
+
+        SDL_AtomicUnlock(&platform.audio.synth);
+    }
+
+    return count;
+}
+
+// the device pulls samples from the ring, its fill is kept around the target by resampling
+// a little faster or slower, so the latency doesn't creep when the frame pacing drifts
+static void audioCallback(void* userdata, u8* stream, s32 len)
+{
+    s16* out = (s16*)stream;
+    s16* end = out + len / sizeof(s16);
+
+    const s16* data = platform.audio.ring.data;
+    u32 mask = platform.audio.ring.mask;
+    u32 tail = SDL_AtomicGet(&platform.audio.ring.tail);
+    u32 avail = (u32)SDL_AtomicGet(&platform.audio.ring.head) - tail;
+
+    // after an underrun wait until the ring is filled up to the target again
+    if(!platform.audio.primed && avail >= (u32)platform.audio.target)
+    {
+        platform.audio.primed = true;
+        platform.audio.fill = avail;
+    }
+
+    if(platform.audio.primed)
+    {
+        const double Target = platform.audio.target;
+
+        platform.audio.fill += (avail - platform.audio.fill) / 16;
+
+        // the proportional part follows the fill, the integral one settles on the device clock drift
+        double error = CLAMP((platform.audio.fill - Target) / Target, -1.0, 1.0);
+        platform.audio.drift = CLAMP(platform.audio.drift + error * AUDIO_MAX_DRIFT / 256, -AUDIO_MAX_DRIFT, AUDIO_MAX_DRIFT);
+
+        double ratio = 1.0 + CLAMP(error * AUDIO_MAX_DRIFT + platform.audio.drift, -AUDIO_MAX_DRIFT, AUDIO_MAX_DRIFT);
+        double pos = platform.audio.pos;
+
+        for(; out != end; out += TIC_STEREO_CHANNELS, pos += ratio)
+        {
+            u32 index = (u32)pos;
+
+            if(index + 1 >= avail)
+            {
+                platform.audio.primed = false;
+                SDL_AtomicIncRef(&platform.audio.underruns);
+                out += TIC_STEREO_CHANNELS * continueSound(out, (s32)(end - out) / TIC_STEREO_CHANNELS);
+                break;
+            }
+
+            const s16* a = data + ((tail + index) & mask) * TIC_STEREO_CHANNELS;
+            const s16* b = data + ((tail + index + 1) & mask) * TIC_STEREO_CHANNELS;
+            double frac = pos - index;
+
+            for(s32 c = 0; c < TIC_STEREO_CHANNELS; c++)
+                out[c] = (s16)(a[c] + (b[c] - a[c]) * frac);
+        }
+
+        u32 consumed = (u32)pos;
+        platform.audio.pos = pos - consumed;
+        SDL_AtomicSet(&platform.audio.ring.tail, tail + consumed);
+    }
+
+    if(out != end)
+        SDL_memset(out, 0, (end - out) * sizeof(s16));
+}
+
 static void initSound()
 {
     SDL_AudioSpec want =
@@ -190,18 +462,25 @@ static void initSound()
         .freq = TIC80_SAMPLERATE,
         .format = AUDIO_S16,
         .channels = TIC_STEREO_CHANNELS,
+        .samples = AUDIO_DEVICE_SAMPLES,
+        .callback = audioCallback,
         .userdata = NULL,
     };
 
-    platform.audio.device = SDL_OpenAudioDevice(NULL, 0, &want, &platform.audio.spec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
+    // SDL converts format and channels, the core synthesizes at the device rate
+    platform.audio.device = SDL_OpenAudioDevice(NULL, 0, &want, &platform.audio.spec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
 
-    SDL_BuildAudioCVT(&platform.audio.cvt, want.format, want.channels, platform.audio.spec.freq, platform.audio.spec.format, platform.audio.spec.channels, platform.audio.spec.freq);
+    platform.audio.target = platform.audio.spec.freq * AUDIO_LATENCY / 1000;
+    platform.audio.limit = platform.audio.target * 2;
 
-    if(platform.audio.cvt.needed)
-    {
-        platform.audio.cvt.len = platform.audio.spec.freq * platform.audio.spec.channels * sizeof(s16) / TIC80_FRAMERATE;
-        platform.audio.cvt.buf = SDL_malloc(platform.audio.cvt.len * platform.audio.cvt.len_mult);
-    }
+    u32 capacity = 1;
+    while(capacity < (u32)platform.audio.limit)
+        capacity <<= 1;
+
+    platform.audio.ring.data = SDL_calloc(capacity * TIC_STEREO_CHANNELS, sizeof(s16));
+    platform.audio.ring.mask = capacity - 1;
+
+    SDL_PauseAudioDevice(platform.audio.device, 0);
 }
 
 static const u8* getSpritePtr(const tic_tile* tiles, s32 x, s32 y)
@@ -222,7 +501,8 @@ static void setWindowIcon()
 
     u32* pixels = SDL_malloc(Size * Size * sizeof(u32));
 
-    const u32* pal = tic_tool_palette_blit(&platform.studio->config()->cart->bank0.palette.scn, platform.studio->tic->screen_format);
+    u32 pal[TIC_PALETTE_SIZE];
+    tic_tool_palette_blit(pal, &platform.studio->config()->cart->bank0.palette.scn, platform.studio->tic->screen_format);
 
     for(s32 j = 0, index = 0; j < Size; j++)
         for(s32 i = 0; i < Size; i++, index++)
@@ -287,6 +567,26 @@ void updateTextureBytes(GPU_Image* texture, const void* data, s32 height)
     GPU_UpdateImageBytes(texture, NULL, (const u8*)data, height * sizeof(u32));
 }
 
+// uploads the screen rows changed since the previous frame, or all of them
+static void updateScreenTexture(GPU_Image* texture, const FrameSlot* frame, bool all)
+{
+    for(s32 y = 0; y < TIC80_FULLHEIGHT;)
+    {
+        if(!all && !frame->dirty[y])
+        {
+            y++;
+            continue;
+        }
+
+        s32 start = y;
+        while(y < TIC80_FULLHEIGHT && (all || frame->dirty[y]))
+            y++;
+
+        GPU_Rect rect = {0, start, TIC80_FULLWIDTH, y - start};
+        GPU_UpdateImageBytes(texture, &rect, (const u8*)(frame->screen + start * TIC80_FULLWIDTH), TIC80_FULLWIDTH * sizeof(u32));
+    }
+}
+
 #else
 
 void updateTextureBytes(SDL_Texture* texture, const void* data, s32 height)
@@ -298,6 +598,35 @@ void updateTextureBytes(SDL_Texture* texture, const void* data, s32 height)
     SDL_UnlockTexture(texture);
 }
 
+// uploads the screen rows changed since the previous frame, or all of them
+static void updateScreenTexture(SDL_Texture* texture, const FrameSlot* frame, bool all)
+{
+    for(s32 y = 0; y < TIC80_FULLHEIGHT;)
+    {
+        if(!all && !frame->dirty[y])
+        {
+            y++;
+            continue;
+        }
+
+        s32 start = y;
+        while(y < TIC80_FULLHEIGHT && (all || frame->dirty[y]))
+            y++;
+
+        SDL_Rect rect = {0, start, TIC80_FULLWIDTH, y - start};
+
+        void* pixels = NULL;
+        s32 pitch = 0;
+        SDL_LockTexture(texture, &rect, &pixels, &pitch);
+
+        const u32* src = frame->screen + start * TIC80_FULLWIDTH;
+        for(s32 row = 0; row < rect.h; row++, src += TIC80_FULLWIDTH)
+            SDL_memcpy((u8*)pixels + row * pitch, src, TIC80_FULLWIDTH * sizeof(u32));
+
+        SDL_UnlockTexture(texture);
+    }
+}
+
 #endif
 
 #if defined(TOUCH_INPUT_SUPPORT)
@@ -317,7 +646,8 @@ static void initTouchGamepad()
 
             const u8* in = platform.studio->tic->ram.vram.screen.data;
             const u8* end = in + sizeof(platform.studio->tic->ram.vram.screen);
-            const u32* pal = tic_tool_palette_blit(&platform.studio->config()->cart->bank0.palette.scn, platform.studio->tic->screen_format);
+            u32 pal[TIC_PALETTE_SIZE];
+            tic_tool_palette_blit(pal, &platform.studio->config()->cart->bank0.palette.scn, platform.studio->tic->screen_format);
             const u32 Delta = ((TIC80_FULLWIDTH*sizeof(u32))/sizeof *out - TIC80_WIDTH);
 
             s32 col = 0;
@@ -422,8 +752,6 @@ static void destroyGPU()
         platform.mouse.texture = NULL;
     }
 
-    platform.mouse.src = NULL;
-
     GPU_Quit();
 #else
 
@@ -507,14 +835,11 @@ static void calcTextureRect(SDL_Rect* rect)
     }
 }
 
-static void processMouse()
+static void processMouse(tic80_input* input)
 {
     s32 mx = 0, my = 0;
     s32 mb = SDL_GetMouseState(&mx, &my);
 
-    tic_mem* tic = platform.studio->tic;
-    tic80_input* input = &tic->ram.input;
-
     {
         input->mouse.x = input->mouse.y = 0;
 
@@ -558,11 +883,8 @@ static void processMouse()
     }
 }
 
-static void processKeyboard()
+static void processKeyboard(tic80_input* input)
 {
-    tic_mem* tic = platform.studio->tic;
-    tic80_input* input = &tic->ram.input;
-
     {
         SDL_Keymod mod = SDL_GetModState();
 
@@ -623,7 +945,7 @@ static bool checkTouch(const SDL_Rect* rect, s32* x, s32* y)
 
 static bool isGamepadVisible()
 {
-    return platform.studio->tic->input.gamepad;
+    return platform.frame.slots[platform.frame.swap.front].gamepad;
 }
 
 static void processTouchKeyboard()
@@ -748,9 +1070,8 @@ static s32 getJoystickHatMask(s32 hat)
     return gamepad.data;
 }
 
-static void processJoysticks()
+static void processJoysticks(tic80_input* input)
 {
-    tic_mem* tic = platform.studio->tic;
     platform.gamepad.joystick.data = 0;
     s32 index = 0;
 
@@ -796,10 +1117,7 @@ static void processJoysticks()
                             s32 back = SDL_JoystickGetButton(joystick, 7);
 
                             if(back)
-                            {
-                                tic80_input* input = &tic->ram.input;
                                 input->keyboard.keys[0] = tic_key_escape;
-                            }
                         }
                     }
                 }
@@ -810,14 +1128,11 @@ static void processJoysticks()
     }
 }
 
-static void processGamepad()
+static void processGamepad(tic80_input* input)
 {
-    processJoysticks();
+    processJoysticks(input);
     
     {
-        tic_mem* tic = platform.studio->tic;
-        tic80_input* input = &tic->ram.input;
-
         input->gamepads.data = 0;
 
 #if defined(TOUCH_INPUT_SUPPORT)
@@ -868,12 +1183,31 @@ static void handleKeydown(SDL_Keycode keycode, bool down, bool* state)
 #endif
 }
 
-void tic_sys_poll()
+// hands the polled input to the tick, the scroll and text of a slot it didn't take go with the next one
+static void publishInput()
 {
-    tic_mem* tic = platform.studio->tic;
-    tic80_input* input = &tic->ram.input;
+    InputSlot* slot = &platform.input.slots[platform.input.swap.back];
+    const InputSlot* carry = &platform.input.carry;
+
+    slot->input.mouse.scrollx = CLAMP(slot->input.mouse.scrollx + carry->input.mouse.scrollx, -32, 31);
+    slot->input.mouse.scrolly = CLAMP(slot->input.mouse.scrolly + carry->input.mouse.scrolly, -32, 31);
 
-    SDL_memset(input, 0, sizeof(tic80_input));
+    if(!slot->text)
+        slot->text = carry->text;
+
+    if(swapPublish(&platform.input.swap))
+        platform.input.carry = platform.input.slots[platform.input.swap.back];
+    else
+        ZEROMEM(platform.input.carry);
+}
+
+// main thread: reads the events and devices to the back input slot
+static void pollEvents()
+{
+    InputSlot* slot = &platform.input.slots[platform.input.swap.back];
+    tic80_input* input = &slot->input;
+
+    SDL_memset(slot, 0, sizeof(InputSlot));
 
 #if defined(TOUCH_INPUT_SUPPORT)
     ZEROMEM(platform.gamepad.touch.joystick);
@@ -943,7 +1277,7 @@ void tic_sys_poll()
                 }
                 break;
             case SDL_WINDOWEVENT_FOCUS_GAINED: 
-                platform.studio->updateProject();
+                SDL_AtomicSet(&platform.emu.focus, 1);
                 break;
             }
             break;
@@ -961,24 +1295,45 @@ void tic_sys_poll()
             break;
         case SDL_TEXTINPUT:
             if(strlen(event.text.text) == 1)
-                platform.keyboard.text = event.text.text[0];
+                slot->text = event.text.text[0];
             break;
         case SDL_QUIT:
-            platform.studio->exit();
+            SDL_AtomicSet(&platform.emu.exit, 1);
             break;
         default:
             break;
         }
     }
 
-    processMouse();
+    processMouse(input);
 
 #if defined(TOUCH_INPUT_SUPPORT)
     processTouchInput();
 #endif
 
-    processKeyboard();
-    processGamepad();
+    processKeyboard(input);
+    processGamepad(input);
+
+    publishInput();
+}
+
+// the tick takes the latest input, when there is nothing new the keys are held and the scroll and text are gone
+void tic_sys_poll()
+{
+    tic80_input* input = &platform.studio->tic->ram.input;
+
+    if(swapTake(&platform.input.swap))
+    {
+        const InputSlot* slot = &platform.input.slots[platform.input.swap.front];
+
+        *input = slot->input;
+        platform.keyboard.text = slot->text;
+    }
+    else
+    {
+        input->mouse.scrollx = input->mouse.scrolly = 0;
+        platform.keyboard.text = '\0';
+    }
 }
 
 bool tic_sys_keyboard_text(char* text)
@@ -1028,15 +1383,45 @@ static void blitSound()
 {
     tic_mem* tic = platform.studio->tic;
 
-    SDL_PauseAudioDevice(platform.audio.device, 0);
-    
-    if(platform.audio.cvt.needed)
+    s16* data = platform.audio.ring.data;
+    u32 capacity = platform.audio.ring.mask + 1;
+    u32 head = SDL_AtomicGet(&platform.audio.ring.head);
+    u32 used = head - (u32)SDL_AtomicGet(&platform.audio.ring.tail);
+
+    s32 frames = tic->samples.size / (TIC_STEREO_CHANNELS * sizeof(s16));
+    s32 space = platform.audio.limit - (s32)used;
+
+    // the device fell behind, drop the new samples instead of growing the latency
+    if(frames > space)
     {
-        SDL_memcpy(platform.audio.cvt.buf, tic->samples.buffer, tic->samples.size);
-        SDL_ConvertAudio(&platform.audio.cvt);
-        SDL_QueueAudio(platform.audio.device, platform.audio.cvt.buf, platform.audio.cvt.len_cvt);
+        platform.audio.overruns++;
+        frames = MAX(space, 0);
     }
-    else SDL_QueueAudio(platform.audio.device, tic->samples.buffer, tic->samples.size);
+
+    if(!data || !frames) return;
+
+    u32 start = head & platform.audio.ring.mask;
+    u32 first = MIN((u32)frames, capacity - start);
+
+    SDL_memcpy(data + start * TIC_STEREO_CHANNELS, tic->samples.buffer, first * TIC_STEREO_CHANNELS * sizeof(s16));
+    SDL_memcpy(data, tic->samples.buffer + first * TIC_STEREO_CHANNELS, (frames - first) * TIC_STEREO_CHANNELS * sizeof(s16));
+
+    SDL_AtomicSet(&platform.audio.ring.head, head + frames);
+}
+
+bool tic_sys_audio_stats(tic_audio_stats* stats)
+{
+    if(!platform.audio.device)
+        return false;
+
+    u32 used = (u32)SDL_AtomicGet(&platform.audio.ring.head) - (u32)SDL_AtomicGet(&platform.audio.ring.tail);
+
+    stats->latency = (used + platform.audio.spec.samples) * 1000 / platform.audio.spec.freq;
+    stats->target = AUDIO_LATENCY;
+    stats->underruns = SDL_AtomicGet(&platform.audio.underruns);
+    stats->overruns = platform.audio.overruns;
+
+    return true;
 }
 
 #if defined(TOUCH_INPUT_SUPPORT)
@@ -1070,18 +1455,19 @@ static void renderGamepad()
     const s32 tileSize = platform.gamepad.touch.button.size;
     const SDL_Point axis = platform.gamepad.touch.button.axis;
     typedef struct { bool press; s32 x; s32 y;} Tile;
-    const tic80_input* input = &platform.studio->tic->ram.input;
+    const tic80_gamepads gamepads = {.data = platform.gamepad.touch.joystick.data | platform.gamepad.joystick.data};
+    const tic80_gamepads* input = &gamepads;
     const Tile Tiles[] =
     {
-        {input->gamepads.first.up,     axis.x + 1*tileSize, axis.y + 0*tileSize},
-        {input->gamepads.first.down,   axis.x + 1*tileSize, axis.y + 2*tileSize},
-        {input->gamepads.first.left,   axis.x + 0*tileSize, axis.y + 1*tileSize},
-        {input->gamepads.first.right,  axis.x + 2*tileSize, axis.y + 1*tileSize},
+        {input->first.up,     axis.x + 1*tileSize, axis.y + 0*tileSize},
+        {input->first.down,   axis.x + 1*tileSize, axis.y + 2*tileSize},
+        {input->first.left,   axis.x + 0*tileSize, axis.y + 1*tileSize},
+        {input->first.right,  axis.x + 2*tileSize, axis.y + 1*tileSize},
 
-        {input->gamepads.first.a,      platform.gamepad.touch.button.a.x, platform.gamepad.touch.button.a.y},
-        {input->gamepads.first.b,      platform.gamepad.touch.button.b.x, platform.gamepad.touch.button.b.y},
-        {input->gamepads.first.x,      platform.gamepad.touch.button.x.x, platform.gamepad.touch.button.x.y},
-        {input->gamepads.first.y,      platform.gamepad.touch.button.y.x, platform.gamepad.touch.button.y.y},
+        {input->first.a,      platform.gamepad.touch.button.a.x, platform.gamepad.touch.button.a.y},
+        {input->first.b,      platform.gamepad.touch.button.b.x, platform.gamepad.touch.button.b.y},
+        {input->first.x,      platform.gamepad.touch.button.x.x, platform.gamepad.touch.button.x.y},
+        {input->first.y,      platform.gamepad.touch.button.y.x, platform.gamepad.touch.button.y.y},
     };
 
     for(s32 i = 0; i < COUNT_OF(Tiles); i++)
@@ -1104,8 +1490,9 @@ static void renderGamepad()
 
 #endif
 
-static void blitCursor(const u8* in)
+static void blitCursor(const u8* in, const u32* pal, bool pixelPerfect)
 {
+    bool created = false;
 
     if(!platform.mouse.texture)
     {
@@ -1117,15 +1504,12 @@ static void blitCursor(const u8* in)
         platform.mouse.texture = SDL_CreateTexture(platform.gpu.renderer, STUDIO_PIXEL_FORMAT, SDL_TEXTUREACCESS_STREAMING, TIC_SPRITESIZE, TIC_SPRITESIZE);
         SDL_SetTextureBlendMode(platform.mouse.texture, SDL_BLENDMODE_BLEND);
 #endif
+        created = true;
     }
 
-    if(platform.mouse.src != in)
     {
-        platform.mouse.src = in;
-
         const u8* end = in + sizeof(tic_tile);
-        const u32* pal = tic_tool_palette_blit(&platform.studio->tic->ram.vram.palette, platform.studio->tic->screen_format);
-        static u32 data[TIC_SPRITESIZE*TIC_SPRITESIZE];
+        u32 data[TIC_SPRITESIZE*TIC_SPRITESIZE];
         u32* out = data;
 
         while(in != end)
@@ -1138,11 +1522,12 @@ static void blitCursor(const u8* in)
             in++;
         }
 
-#if defined(CRT_SHADER_SUPPORT)
-        updateTextureBytes(platform.mouse.texture, data, TIC_SPRITESIZE);
-#else
-        updateTextureBytes(platform.mouse.texture, data, TIC_SPRITESIZE);
-#endif
+        // the sprite comes with every frame, the texture is updated when it looks different
+        if(created || SDL_memcmp(data, platform.mouse.pixels, sizeof data))
+        {
+            SDL_memcpy(platform.mouse.pixels, data, sizeof data);
+            updateTextureBytes(platform.mouse.texture, data, TIC_SPRITESIZE);
+        }
     }
 
     SDL_Rect rect = {0, 0, 0, 0};
@@ -1152,7 +1537,7 @@ static void blitCursor(const u8* in)
     s32 mx, my;
     SDL_GetMouseState(&mx, &my);
 
-    if(platform.studio->config()->theme.cursor.pixelPerfect)
+    if(pixelPerfect)
     {
         mx -= (mx - rect.x) % scale;
         my -= (my - rect.y) % scale;
@@ -1169,68 +1554,23 @@ static void blitCursor(const u8* in)
     }
 }
 
-static void renderCursor()
+static void renderCursor(const FrameSlot* frame)
 {
-    if(!platform.studio->tic->input.mouse)
+    if(!frame->mouse)
     {
         SDL_ShowCursor(SDL_DISABLE);
         return;
     }
 
-    if(platform.studio->tic->ram.vram.vars.cursor.system)
+    if(frame->cursor.system)
     {
-        const StudioConfig* config = platform.studio->config();
-        const tic_tiles* tiles = &config->cart->bank0.tiles;
-
-        switch(platform.studio->tic->ram.vram.vars.cursor.sprite)
-        {
-        case tic_cursor_hand: 
-            {
-                if(config->theme.cursor.hand >= 0)
-                {
-                    SDL_ShowCursor(SDL_DISABLE);
-                    blitCursor(tiles->data[config->theme.cursor.hand].data);
-                }
-                else
-                {
-                    SDL_ShowCursor(SDL_ENABLE);
-                    SDL_SetCursor(platform.mouse.cursors[HandCursor]);
-                }
-            }
-            break;
-        case tic_cursor_ibeam:
-            {
-                if(config->theme.cursor.ibeam >= 0)
-                {
-                    SDL_ShowCursor(SDL_DISABLE);
-                    blitCursor(tiles->data[config->theme.cursor.ibeam].data);
-                }
-                else
-                {
-                    SDL_ShowCursor(SDL_ENABLE);
-                    SDL_SetCursor(platform.mouse.cursors[IBeamCursor]);
-                }
-            }
-            break;
-        default:
-            {
-                if(config->theme.cursor.arrow >= 0)
-                {
-                    SDL_ShowCursor(SDL_DISABLE);
-                    blitCursor(tiles->data[config->theme.cursor.arrow].data);
-                }
-                else
-                {
-                    SDL_ShowCursor(SDL_ENABLE);
-                    SDL_SetCursor(platform.mouse.cursors[ArrowCursor]);
-                }
-            }
-        }
+        SDL_ShowCursor(SDL_ENABLE);
+        SDL_SetCursor(platform.mouse.cursors[frame->cursor.type]);
     }
     else
     {
         SDL_ShowCursor(SDL_DISABLE);
-        blitCursor(platform.studio->tic->ram.sprites.data[platform.studio->tic->ram.vram.vars.cursor.sprite].data);
+        blitCursor(frame->cursor.tile.data, frame->cursor.palette, frame->cursor.pixelPerfect);
     }
 }
 
@@ -1260,19 +1600,38 @@ static const char* getAppFolder()
     return appFolder;
 }
 
+static void setClipboard(void* data)
+{
+    SDL_SetClipboardText(data);
+}
+
+static void hasClipboard(void* data)
+{
+    *(bool*)data = SDL_HasClipboardText();
+}
+
+static void getClipboard(void* data)
+{
+    *(char**)data = SDL_GetClipboardText();
+}
+
 void tic_sys_clipboard_set(const char* text)
 {
-    SDL_SetClipboardText(text);
+    callMain(setClipboard, (void*)text);
 }
 
 bool tic_sys_clipboard_has()
 {
-    return SDL_HasClipboardText();
+    bool has = false;
+    callMain(hasClipboard, &has);
+    return has;
 }
 
 char* tic_sys_clipboard_get()
 {
-    return SDL_GetClipboardText();
+    char* text = NULL;
+    callMain(getClipboard, &text);
+    return text;
 }
 
 void tic_sys_clipboard_free(const char* text)
@@ -1290,7 +1649,7 @@ u64 tic_sys_freq_get()
     return SDL_GetPerformanceFrequency();
 }
 
-void tic_sys_fullscreen()
+static void toggleFullscreen(void* data)
 {
 #if defined(CRT_SHADER_SUPPORT)
     GPU_SetFullscreen(GPU_GetFullscreen() ? false : true, true);
@@ -1305,10 +1664,20 @@ void tic_sys_message(const char* title, const char* message)
     SDL_ShowSimpleMessageBox(SDL_MESSAGEBOX_WARNING, title, message, NULL);
 }
 
-void tic_sys_title(const char* title)
+void tic_sys_fullscreen()
+{
+    callMain(toggleFullscreen, NULL);
+}
+
+static void setTitle(void* data)
 {
     if(platform.window)
-        SDL_SetWindowTitle(platform.window, title);
+        SDL_SetWindowTitle(platform.window, data);
+}
+
+void tic_sys_title(const char* title)
+{
+    callMain(setTitle, (void*)title);
 }
 
 #if defined(__WINDOWS__) || defined(__LINUX__) || defined(__MACOSX__)
@@ -1358,7 +1727,7 @@ void tic_sys_preseed()
 
 #if defined(CRT_SHADER_SUPPORT)
 
-static void loadCrtShader()
+static void loadCrtShader(void* data)
 {
     const char* vertextShader = platform.studio->config()->shader.vertex;
     const char* pixelShader = platform.studio->config()->shader.pixel;
@@ -1402,7 +1771,7 @@ static void loadCrtShader()
 }
 #endif
 
-void tic_sys_update_config()
+static void updateConfig(void* data)
 {
 #if defined(TOUCH_INPUT_SUPPORT)
     if(platform.gpu.renderer)
@@ -1410,33 +1779,138 @@ void tic_sys_update_config()
 #endif
 }
 
-static void gpuTick()
+void tic_sys_update_config()
+{
+    callMain(updateConfig, NULL);
+}
+
+// copies the ticked frame to the back slot and hands it to the main thread
+static void publishFrame()
 {
     tic_mem* tic = platform.studio->tic;
+    FrameSlot* frame = &platform.frame.slots[platform.frame.swap.back];
 
-    tic_sys_poll();
+    SDL_memcpy(frame->screen, tic->screen, sizeof frame->screen);
+    frame->seq = ++platform.frame.seq;
+    SDL_memset(frame->dirty, 0, sizeof frame->dirty);
 
-    if(platform.studio->quit)
     {
-#if defined __EMSCRIPTEN__
-        emscripten_cancel_main_loop();
+        tic_rect rects[TIC80_FULLHEIGHT];
+        s32 count = tic_core_dirty_rects(tic, rects, COUNT_OF(rects));
+
+        for(s32 i = 0; i < count; i++)
+            SDL_memset(frame->dirty + rects[i].y, true, rects[i].h);
+    }
+
+    frame->mouse = tic->input.mouse;
+    frame->gamepad = tic->input.gamepad;
+
+    {
+        const StudioConfig* config = platform.studio->config();
+        u8 sprite = tic->ram.vram.vars.cursor.sprite;
+
+        frame->crtMonitor = config->crtMonitor;
+        frame->cursor.pixelPerfect = config->theme.cursor.pixelPerfect;
+        frame->cursor.system = false;
+
+        if(tic->ram.vram.vars.cursor.system)
+        {
+            s32 index;
+
+            switch(sprite)
+            {
+            case tic_cursor_hand:
+                frame->cursor.type = HandCursor;
+                index = config->theme.cursor.hand;
+                break;
+            case tic_cursor_ibeam:
+                frame->cursor.type = IBeamCursor;
+                index = config->theme.cursor.ibeam;
+                break;
+            default:
+                frame->cursor.type = ArrowCursor;
+                index = config->theme.cursor.arrow;
+            }
+
+            // the theme sprite if there is one, the SDL cursor otherwise
+            if(index >= 0)
+                frame->cursor.tile = config->cart->bank0.tiles.data[index];
+            else
+                frame->cursor.system = true;
+        }
+        else frame->cursor.tile = tic->ram.sprites.data[sprite];
+
+#if defined(CRT_SHADER_SUPPORT)
+        // the shader source is read from the config, so it's compiled on the
+        // main thread while the tick waits
+        if(config->crtMonitor && !platform.emu.shader)
+        {
+            platform.emu.shader = true;
+            callMain(loadCrtShader, NULL);
+        }
 #endif
-        return;
     }
 
+    tic_tool_palette_blit(frame->cursor.palette, &tic->ram.vram.palette, tic->screen_format);
+
+    swapPublish(&platform.frame.swap);
+
+#if defined(EMU_THREAD_SUPPORT)
+    SDL_SemPost(platform.emu.wake);
+#endif
+}
+
+static void emuTick()
+{
+    if(SDL_AtomicSet(&platform.emu.focus, 0))
+        platform.studio->updateProject();
+
+    if(SDL_AtomicSet(&platform.emu.exit, 0))
+        platform.studio->exit();
+
+    tic_sys_poll();
+
+    if(platform.studio->quit)
+        return;
+
+    SDL_AtomicLock(&platform.audio.synth);
     platform.studio->tick();
+    platform.audio.rendered = 0;
+    SDL_AtomicUnlock(&platform.audio.synth);
+
+    blitSound();
+    publishFrame();
+}
+
+// main thread: uploads the latest frame and presents it
+static void presentFrame()
+{
+    if(swapTake(&platform.frame.swap))
+    {
+        const FrameSlot* frame = &platform.frame.slots[platform.frame.swap.front];
+
+        // the dirty rows are relative to the frame before, which the texture
+        // doesn't have if that one was dropped
+        updateScreenTexture(platform.gpu.texture, frame,
+            !platform.frame.taken || frame->seq != platform.frame.uploaded + 1);
+
+        platform.frame.uploaded = frame->seq;
+        platform.frame.taken = true;
+    }
+
+    if(!platform.frame.taken)
+        return;
+
+    const FrameSlot* frame = &platform.frame.slots[platform.frame.swap.front];
 
 #if defined(CRT_SHADER_SUPPORT)
+    platform.gpu.crtMonitor = frame->crtMonitor;
+
     GPU_Clear(platform.gpu.renderer);
 
     {
-        updateTextureBytes(platform.gpu.texture, tic->screen, TIC80_FULLWIDTH);
-
-        if(platform.studio->config()->crtMonitor)
+        if(frame->crtMonitor && platform.gpu.shader)
         {
-            if(platform.gpu.shader == 0)
-                loadCrtShader();
-
             SDL_Rect rect = {0, 0, 0, 0};
             calcTextureRect(&rect);
 
@@ -1463,7 +1937,7 @@ static void gpuTick()
             blitGpuTexture(platform.gpu.renderer, platform.gpu.texture);
         }
 
-        renderCursor();
+        renderCursor(frame);
 
 #if defined(TOUCH_INPUT_SUPPORT)
 
@@ -1480,8 +1954,6 @@ static void gpuTick()
     SDL_RenderClear(platform.gpu.renderer);
 
     {
-        updateTextureBytes(platform.gpu.texture, tic->screen, TIC80_FULLHEIGHT);
-
         {
             SDL_Rect rect = {0, 0, 0, 0};
             calcTextureRect(&rect);
@@ -1517,7 +1989,7 @@ static void gpuTick()
         }
     }
 
-    renderCursor();
+    renderCursor(frame);
 
 #if defined(TOUCH_INPUT_SUPPORT)
 
@@ -1529,12 +2001,107 @@ static void gpuTick()
 
     SDL_RenderPresent(platform.gpu.renderer);
 #endif
+}
 
-    blitSound();
+// polls, ticks and presents in turn on the calling thread
+static void gpuTick()
+{
+    pollEvents();
+    emuTick();
+
+    if(platform.studio->quit)
+    {
+#if defined __EMSCRIPTEN__
+        emscripten_cancel_main_loop();
+#endif
+        return;
+    }
+
+    presentFrame();
+}
+
+#if defined(EMU_THREAD_SUPPORT)
+
+static s32 emuThread(void* data)
+{
+    u64 nextTick = SDL_GetPerformanceCounter();
+    const u64 Delta = SDL_GetPerformanceFrequency() / TIC80_FRAMERATE;
 
-    platform.keyboard.text = '\0';
+    while (!platform.studio->quit)
+    {
+        nextTick += Delta;
+
+        emuTick();
+
+        {
+            s64 delay = nextTick - SDL_GetPerformanceCounter();
+
+            if(delay < 0)
+                nextTick -= delay;
+            else
+                SDL_Delay((u32)(delay * 1000 / SDL_GetPerformanceFrequency()));
+        }
+    }
+
+    SDL_AtomicSet(&platform.emu.running, 0);
+    SDL_SemPost(platform.emu.wake);
+
+    return 0;
+}
+
+static void runMainCall()
+{
+    if(SDL_AtomicGet(&platform.emu.call.pending))
+    {
+        platform.emu.call.fn(platform.emu.call.data);
+        SDL_AtomicSet(&platform.emu.call.pending, 0);
+        SDL_SemPost(platform.emu.call.done);
+    }
+}
+
+// the tick runs on its own thread, a slow present doesn't eat into the next frame,
+// returns false if the thread can't be started
+static bool runThreaded()
+{
+    bool started = false;
+
+    platform.emu.wake = SDL_CreateSemaphore(0);
+    platform.emu.call.done = SDL_CreateSemaphore(0);
+    SDL_AtomicSet(&platform.emu.running, 1);
+
+    if(platform.emu.wake && platform.emu.call.done)
+        platform.emu.thread = SDL_CreateThread(emuThread, "tic80 emulation", NULL);
+
+    if(platform.emu.thread)
+    {
+        started = true;
+
+        while(SDL_AtomicGet(&platform.emu.running))
+        {
+            // woken by a new frame or a call, events are polled at the frame rate anyway
+            SDL_SemWaitTimeout(platform.emu.wake, 1000 / TIC80_FRAMERATE);
+            while(SDL_SemTryWait(platform.emu.wake) == 0);
+
+            runMainCall();
+            pollEvents();
+            presentFrame();
+        }
+
+        SDL_WaitThread(platform.emu.thread, NULL);
+        platform.emu.thread = NULL;
+    }
+
+    if(platform.emu.wake)
+        SDL_DestroySemaphore(platform.emu.wake);
+
+    if(platform.emu.call.done)
+        SDL_DestroySemaphore(platform.emu.call.done);
+
+    return started;
 }
 
+#endif
+
 #if defined(__EMSCRIPTEN__)
 
 static void emsGpuTick()
@@ -1583,8 +2150,19 @@ static s32 start(s32 argc, const char **argv, const char* folder)
 
     initSound();
 
+    initSwap(&platform.input.swap);
+    initSwap(&platform.frame.swap);
+
+#if defined(EMU_THREAD_SUPPORT)
+    platform.emu.main = SDL_ThreadID();
+#endif
+
     platform.studio = studioInit(argc, argv, platform.audio.spec.freq, folder);
 
+    SDL_AtomicLock(&platform.audio.synth);
+    platform.audio.tic = platform.studio->tic;
+    SDL_AtomicUnlock(&platform.audio.synth);
+
     {
         const s32 Width = TIC80_FULLWIDTH * platform.studio->config()->uiScale;
         const s32 Height = TIC80_FULLHEIGHT * platform.studio->config()->uiScale;
@@ -1613,6 +2191,10 @@ static s32 start(s32 argc, const char **argv, const char* folder)
 #if defined(__EMSCRIPTEN__)
     emscripten_set_main_loop(emsGpuTick, 0, 1);
 #else
+
+#if defined(EMU_THREAD_SUPPORT)
+    if(!runThreaded())
+#endif
     {
         u64 nextTick = SDL_GetPerformanceCounter();
         const u64 Delta = SDL_GetPerformanceFrequency() / TIC80_FRAMERATE;
@@ -1641,10 +2223,11 @@ static s32 start(s32 argc, const char **argv, const char* folder)
         SDL_StopTextInput();
 #endif
 
-    platform.studio->close();
+    SDL_AtomicLock(&platform.audio.synth);
+    platform.audio.tic = NULL;
+    SDL_AtomicUnlock(&platform.audio.synth);
 
-    if(platform.audio.cvt.buf)
-        SDL_free(platform.audio.cvt.buf);
+    platform.studio->close();
 
     {
         destroyGPU();
@@ -1657,6 +2240,9 @@ static s32 start(s32 argc, const char **argv, const char* folder)
         SDL_DestroyWindow(platform.window);
         SDL_CloseAudioDevice(platform.audio.device);
 
+        if(platform.audio.ring.data)
+            SDL_free(platform.audio.ring.data);
+
         for(s32 i = 0; i < COUNT_OF(platform.mouse.cursors); i++)
             SDL_FreeCursor(platform.mouse.cursors[i]);
     }
@@ -53,7 +53,6 @@ s32 runCart(void* cart, s32 size)
 
 	SDL_AudioDeviceID audioDevice = 0;
 	SDL_AudioSpec audioSpec;
-	SDL_AudioCVT cvt;
 	bool audioStarted = false;
 	s32 output = 0;
 
@@ -66,15 +65,7 @@ s32 runCart(void* cart, s32 size)
 			.userdata = NULL,
 		};
 
-		audioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &audioSpec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_FORMAT_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
-
-		SDL_BuildAudioCVT(&cvt, want.format, want.channels, audioSpec.freq, audioSpec.format, audioSpec.channels, audioSpec.freq);
-
-		if (cvt.needed)
-		{
-			cvt.len = audioSpec.freq * audioSpec.channels * sizeof(s16) / TIC80_FRAMERATE;
-			cvt.buf = SDL_malloc(cvt.len * cvt.len_mult);
-		}
+		audioDevice = SDL_OpenAudioDevice(NULL, 0, &want, &audioSpec, SDL_AUDIO_ALLOW_FREQUENCY_CHANGE | SDL_AUDIO_ALLOW_SAMPLES_CHANGE);
 	}
 
 	tic80_input input;
@@ -142,24 +133,14 @@ s32 runCart(void* cart, s32 size)
 
 			nextTick += Delta;
 
-			tic80_tick(tic, &input);
+			tic80_update(tic, &input);
 
 			if (!audioStarted && audioDevice)
 				audioStarted = true;
 
 			SDL_PauseAudioDevice(audioDevice, 0);
 
-			{
-				s32 size = tic->sound.count * sizeof(tic->sound.samples[0]);
-
-				if (cvt.needed)
-				{
-					SDL_memcpy(cvt.buf, tic->sound.samples, size);
-					SDL_ConvertAudio(&cvt);
-					SDL_QueueAudio(audioDevice, cvt.buf, cvt.len_cvt);
-				}
-				else SDL_QueueAudio(audioDevice, tic->sound.samples, size);
-			}
+			SDL_QueueAudio(audioDevice, tic->sound.samples, tic->sound.count * sizeof(tic->sound.samples[0]));
 
 			SDL_RenderClear(renderer);
 
@@ -168,7 +149,7 @@ s32 runCart(void* cart, s32 size)
 				s32 pitch = 0;
 				SDL_Rect destination;
 				SDL_LockTexture(texture, NULL, &pixels, &pitch);
-				SDL_memcpy(pixels, tic->screen, pitch * TIC80_FULLHEIGHT);
+				tic80_blit(tic, pixels, pitch, true);
 				SDL_UnlockTexture(texture);
 
 				// Render the image in the proper aspect ratio.
@@ -57,7 +57,7 @@ static void app_frame(void)
 
     sokol_gfx_draw(tic->screen);
 
-    static float floatSamples[TIC80_SAMPLERATE / TIC80_FRAMERATE * 2];
+    static float floatSamples[(TIC80_SAMPLERATE / TIC80_FRAMERATE + 1) * 2];
 
     for(s32 i = 0; i < tic->sound.count; i++)
         floatSamples[i] = (float)tic->sound.samples[i] / SHRT_MAX;
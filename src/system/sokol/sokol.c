@@ -127,6 +127,11 @@ void tic_sys_update_config()
 
 }
 
+bool tic_sys_audio_stats(tic_audio_stats* stats)
+{
+    return false;
+}
+
 bool tic_sys_keyboard_text(char* text)
 {
     *text = platform.keyboard.text;
@@ -139,7 +144,7 @@ static void app_init(void)
 
     stm_setup();
 
-    platform.audio.samples = calloc(sizeof platform.audio.samples[0], saudio_sample_rate() / TIC80_FRAMERATE * TIC_STEREO_CHANNELS);
+    platform.audio.samples = calloc(sizeof platform.audio.samples[0], (saudio_sample_rate() / TIC80_FRAMERATE + 1) * TIC_STEREO_CHANNELS);
 }
 
 static void handleKeyboard()
@@ -104,12 +104,15 @@ TIC80_API void tic80_load(tic80* tic, void* cart, s32 size)
     }
 
     {
-        tic_cart_load(&tic80->memory->cart, cart, size);
+        tic_core_load_cart(tic80->memory, cart, size);
         tic_api_reset(tic80->memory);
+
+        // the history belongs to the previous cart
+        tic_core_rewind_reset(tic80->memory);
     }
 }
 
-TIC80_API void tic80_tick(tic80* tic, const tic80_input* input)
+TIC80_API void tic80_update(tic80* tic, const tic80_input* input)
 {
     tic80_local* tic80 = (tic80_local*)tic;
 
@@ -119,12 +122,30 @@ TIC80_API void tic80_tick(tic80* tic, const tic80_input* input)
     tic_core_tick_start(tic80->memory);
     tic_core_tick(tic80->memory, &tic80->tickData);
     tic_core_tick_end(tic80->memory);
+    tic_core_rewind_push(tic80->memory);
 
-    tic_core_blit(tic80->memory, tic80->memory->screen_format);
+    // the frame length in samples varies when the samplerate isn't a multiple of the framerate
+    tic80->tic.sound.count = tic80->memory->samples.size/sizeof(s16);
 
     tic80->tick_counter++;
 }
 
+TIC80_API void tic80_tick(tic80* tic, const tic80_input* input)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    tic80_update(tic, input);
+    tic_core_blit(tic80->memory, tic80->memory->screen_format);
+}
+
+TIC80_API void tic80_blit(tic80* tic, void* pixels, s32 pitch, bool border)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    tic80->memory->screen_format = tic80->tic.screen_format;
+    tic_core_blit_to(tic80->memory, tic80->memory->screen_format, pixels, pitch, border);
+}
+
 TIC80_API void tic80_delete(tic80* tic)
 {
     tic80_local* tic80 = (tic80_local*)tic;
@@ -133,3 +154,122 @@ TIC80_API void tic80_delete(tic80* tic)
 
     free(tic80);
 }
+
+TIC80_API s32 tic80_state_size(tic80* tic)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+    u32 size = tic_core_state_size(tic80->memory);
+
+    return size ? sizeof tic80->tick_counter + size : 0;
+}
+
+TIC80_API s32 tic80_state_save(tic80* tic, void* buffer, s32 size)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+    enum { Counter = sizeof tic80->tick_counter };
+
+    if(size < Counter)
+        return 0;
+
+    memcpy(buffer, &tic80->tick_counter, Counter);
+
+    u32 saved = tic_core_state_save(tic80->memory, (u8*)buffer + Counter, size - Counter);
+
+    return saved ? Counter + saved : 0;
+}
+
+TIC80_API bool tic80_state_load(tic80* tic, const void* buffer, s32 size)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+    enum { Counter = sizeof tic80->tick_counter };
+
+    if(size < Counter)
+        return false;
+
+    u64 counter = tic80->tick_counter;
+    memcpy(&tic80->tick_counter, buffer, Counter);
+
+    if(tic_core_state_load(tic80->memory, (const u8*)buffer + Counter, size - Counter))
+        return true;
+
+    tic80->tick_counter = counter;
+    return false;
+}
+
+TIC80_API void tic80_rewind_init(tic80* tic, s32 size)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    tic_core_rewind_init(tic80->memory, size > 0 ? size : 0);
+}
+
+TIC80_API bool tic80_rewind(tic80* tic)
+{
+    tic80_local* tic80 = (tic80_local*)tic;
+
+    if(!tic_core_rewind_step(tic80->memory))
+        return false;
+
+    tic_core_blit(tic80->memory, tic80->memory->screen_format);
+    memset(tic80->memory->samples.buffer, 0, tic80->memory->samples.size);
+
+    if(tic80->tick_counter)
+        tic80->tick_counter--;
+
+    return true;
+}
+
+static bool isTrackEmpty(const tic_track* track)
+{
+    for(s32 i = 0; i < COUNT_OF(track->data); i++)
+        if(track->data[i])
+            return false;
+
+    return true;
+}
+
+TIC80_API s32 tic80_music(const void* cart, s32 size, s32 track, s32 samplerate, s32 frames, tic80_sound_write write, void* data)
+{
+    if(track < 0 || track >= MUSIC_TRACKS)
+        return -1;
+
+    tic_cart_index index;
+
+    // a buffer without a single chunk isn't a cart
+    if(!tic_cart_index_create(&index, cart, size))
+        return -1;
+
+    tic_cartridge* rom = index.count ? malloc(sizeof(tic_cartridge)) : NULL;
+
+    if(!rom)
+    {
+        tic_cart_index_free(&index);
+        return -1;
+    }
+
+    tic_cart_load_index(rom, &index, tic_cart_bank0);
+    tic_cart_index_free(&index);
+
+    const tic_bank* bank = &rom->bank0;
+    s32 result = 0;
+
+    if(!isTrackEmpty(&bank->music.tracks.data[track]))
+    {
+        tic_music_render params =
+        {
+            .sfx = &bank->sfx,
+            .music = &bank->music,
+            .track = track,
+            .frames = frames,
+            .samplerate = samplerate,
+            .write = write,
+            .data = data,
+        };
+
+        result = tic_core_render_music(&params);
+    }
+
+    free(rom);
+
+    return result;
+}
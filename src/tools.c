@@ -93,10 +93,8 @@ u32 tic_tool_find_closest_color(const tic_rgb* palette, const gif_color* color)
     return closetColor;
 }
 
-u32* tic_tool_palette_blit(const tic_palette* srcpal, tic80_pixel_color_format fmt)
+void tic_tool_palette_blit(u32* pal, const tic_palette* srcpal, tic80_pixel_color_format fmt)
 {
-    static u32 pal[TIC_PALETTE_SIZE];
-
     const tic_rgb* src = srcpal->colors;
     const tic_rgb* end = src + TIC_PALETTE_SIZE;
     u8* dst = (u8*)pal;
@@ -131,8 +129,6 @@ u32* tic_tool_palette_blit(const tic_palette* srcpal, tic80_pixel_color_format f
         }
         src++;
     }
-
-    return pal;
 }
 
 bool tic_tool_has_ext(const char* name, const char* ext)
@@ -162,25 +158,26 @@ bool tic_tool_is_noise(const tic_waveform* wave)
     return true;
 }
 
+// hex digit values plus one, zero marks a non hex char
+static const u8 HexDigits[256] =
+{
+    ['0'] = 1,  ['1'] = 2,  ['2'] = 3,  ['3'] = 4,  ['4'] = 5,
+    ['5'] = 6,  ['6'] = 7,  ['7'] = 8,  ['8'] = 9,  ['9'] = 10,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+};
+
 void tic_tool_str2buf(const char* str, s32 size, void* buf, bool flip)
 {
-    char val[] = "0x00";
-    const char* ptr = str;
+    const u8* ptr = (const u8*)str;
 
-    for(s32 i = 0; i < size/2; i++)
+    for(s32 i = 0; i < size/2; i++, ptr += 2)
     {
-        if(flip)
-        {
-            val[3] = *ptr++;
-            val[2] = *ptr++;
-        }
-        else
-        {
-            val[2] = *ptr++;
-            val[3] = *ptr++;
-        }
+        u8 hi = HexDigits[ptr[flip ? 1 : 0]];
+        u8 lo = HexDigits[ptr[flip ? 0 : 1]];
 
-        ((u8*)buf)[i] = (u8)strtol(val, NULL, 16);
+        // parsed like strtol does, it stops at the first non hex char
+        ((u8*)buf)[i] = hi ? lo ? (hi - 1) << 4 | (lo - 1) : hi - 1 : 0;
     }
 }
 